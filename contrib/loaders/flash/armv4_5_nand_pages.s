@@ -0,0 +1,123 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.           *
+ ***************************************************************************/
+
+	.text
+	.syntax unified
+	.arch armv4
+	.arm
+
+	.align 4
+
+/* Batched NAND page read, used by src/flash/nand/arm_io.c.
+ *
+ * Inputs:
+ *  r0	parameter block address
+ *  r1	buffer address
+ *
+ * Parameter block (32-bit words):
+ *  0	NAND data address (byte wide)
+ *  4	NAND command latch address
+ *  8	NAND address latch address
+ * 12	ready register address, or zero to rely on the delay alone
+ * 16	ready register mask
+ * 20	first page
+ * 24	page step
+ * 28	page count
+ * 32	bytes to copy per page
+ * 36	column address
+ * 40	bits 7..0 read command, bit 8 two column cycles,
+ *	bit 9 issue READSTART, bits 23..16 row address cycles
+ * 44	delay loop count after the address cycles
+ * 48	ready register poll count
+ *
+ * Output:
+ *  r0	pages left unread; non-zero only when the chip never became ready
+ */
+
+start:
+	ldr	r6, [r0, #0]
+	ldr	r7, [r0, #4]
+	ldr	r8, [r0, #8]
+	ldr	r2, [r0, #20]
+	ldr	r3, [r0, #28]
+	ldr	r9, [r0, #40]
+
+page_loop:
+	cmp	r3, #0
+	beq	done
+
+	/* read command, then column address cycles */
+	strb	r9, [r7]
+	ldr	r10, [r0, #36]
+	strb	r10, [r8]
+	tst	r9, #0x100
+	movne	r10, r10, lsr #8
+	strbne	r10, [r8]
+
+	/* row address cycles */
+	mov	r10, r2
+	mov	r11, r9, lsr #16
+	and	r11, r11, #0xff
+row_loop:
+	strb	r10, [r8]
+	mov	r10, r10, lsr #8
+	subs	r11, r11, #1
+	bne	row_loop
+
+	/* large page chips need a start command */
+	tst	r9, #0x200
+	movne	r10, #0x30
+	strbne	r10, [r7]
+
+	/* let R/B# go busy, or wait out tR without a ready register */
+	ldr	r10, [r0, #44]
+delay:
+	subs	r10, r10, #1
+	bhs	delay
+
+	ldr	r10, [r0, #12]
+	cmp	r10, #0
+	beq	read_page
+	ldr	r11, [r0, #16]
+	ldr	r12, [r0, #48]
+poll:
+	ldr	r4, [r10]
+	tst	r4, r11
+	bne	read_page
+	subs	r12, r12, #1
+	bne	poll
+	b	done			/* timed out, r3 counts this page */
+
+read_page:
+	ldr	r5, [r0, #32]
+copy:
+	ldrb	r4, [r6]
+	strb	r4, [r1], #1
+	subs	r5, r5, #1
+	bne	copy
+
+	/* next page */
+	ldr	r4, [r0, #24]
+	add	r2, r2, r4
+	sub	r3, r3, #1
+	b	page_loop
+
+done:
+	mov	r0, r3
+	bkpt	#0
+
+	.end
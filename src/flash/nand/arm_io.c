@@ -73,6 +73,20 @@ static int arm_code_to_working_area(struct target *target,
 	return retval;
 }
 
+/**
+ * The batched page reader sizes its working area for its own code and
+ * buffer, so the single-transfer loops must not inherit it.
+ */
+static void arm_nand_drop_pages_area(struct arm_nand_data *nand)
+{
+	if (nand->op != ARM_NAND_READ_PAGES || !nand->copy_area)
+		return;
+
+	target_free_working_area(nand->target, nand->copy_area);
+	nand->copy_area = NULL;
+	nand->op = ARM_NAND_NONE;
+}
+
 /**
  * ARM-specific bulk write from buffer to address of 8-bit wide NAND.
  * For now this supports ARMv4,ARMv5 and ARMv7-M cores.
@@ -148,6 +162,8 @@ int arm_nandwrite(struct arm_nand_data *nand, uint8_t *data, int size)
 		target_code_src = code_armv4_5;
 	}
 
+	arm_nand_drop_pages_area(nand);
+
 	if (nand->op != ARM_NAND_WRITE || !nand->copy_area) {
 		retval = arm_code_to_working_area(target, target_code_src, target_code_size,
 				nand->chunk_size, &nand->copy_area);
@@ -258,6 +274,8 @@ int arm_nandread(struct arm_nand_data *nand, uint8_t *data, uint32_t size)
 		target_code_src = code_armv4_5;
 	}
 
+	arm_nand_drop_pages_area(nand);
+
 	/* create the copy area if not yet available */
 	if (nand->op != ARM_NAND_READ || !nand->copy_area) {
 		retval = arm_code_to_working_area(target, target_code_src, target_code_size,
@@ -297,3 +315,247 @@ int arm_nandread(struct arm_nand_data *nand, uint8_t *data, uint32_t size)
 
 	return retval;
 }
+
+/* parameter block words shared with the batched page read loop */
+enum arm_nand_pages_param {
+	PAGES_DATA,		/* NAND data address (byte wide) */
+	PAGES_CMD,		/* NAND command latch address */
+	PAGES_ADDR,		/* NAND address latch address */
+	PAGES_READY,		/* ready register, or zero */
+	PAGES_READY_MASK,	/* ready register bits */
+	PAGES_FIRST,		/* first page (row address) */
+	PAGES_STEP,		/* pages between reads */
+	PAGES_COUNT,		/* number of pages */
+	PAGES_SIZE,		/* bytes copied per page */
+	PAGES_COLUMN,		/* column address */
+	PAGES_CONTROL,		/* command, column/row cycles, READSTART */
+	PAGES_DELAY,		/* spin count after the address cycles */
+	PAGES_TIMEOUT,		/* ready register poll count */
+	PAGES_NUM_PARAMS,
+};
+
+/* target buffer budget for one batched page read */
+#define ARM_NAND_PAGES_BUFFER	(16 * 1024)
+
+/**
+ * Uses an on-chip algorithm for an ARM device to read the same span of
+ * many NAND pages in one call: per page it issues the read command and
+ * address cycles, waits for the chip, then copies the bytes out.  This
+ * needs the command and address latch addresses to be set up; without
+ * them, or for 16-bit wide chips, it returns ERROR_NAND_NO_BUFFER.
+ *
+ * @param nand Pointer to the arm_nand_data struct that defines the I/O
+ * @param device The NAND device, giving page size and address cycles
+ * @param page First page to read
+ * @param step Pages to advance between reads
+ * @param count Number of pages to read
+ * @param oob_only Read from the spare area instead of the page data
+ * @param data Buffer receiving @a size bytes per page
+ * @param size Bytes to read from each page
+ * @return Success or failure of the operation
+ */
+int arm_nandread_pages(struct arm_nand_data *nand, struct nand_device *device,
+	uint32_t page, uint32_t step, uint32_t count, bool oob_only,
+	uint8_t *data, uint32_t size)
+{
+	struct target *target = nand->target;
+	struct arm_algorithm armv4_5_algo;
+	struct armv7m_algorithm armv7m_algo;
+	void *arm_algo;
+	struct arm *arm = target->arch_info;
+	struct reg_param reg_params[2];
+	uint32_t params[PAGES_NUM_PARAMS];
+	uint8_t params_buf[sizeof(params)];
+	uint32_t params_addr, target_buf, batch, done, left;
+	uint32_t exit_var = 0;
+	bool small_page;
+	int retval = ERROR_OK;
+
+	/* Inputs:
+	 *  r0	parameter block address
+	 *  r1	buffer address
+	 * Output:
+	 *  r0	pages left unread (non-zero after a ready timeout)
+	 *
+	 * see contrib/loaders/flash/armv4_5_nand_pages.s for src
+	 */
+	static const uint32_t code_armv4_5[] = {
+		0xe5906000, 0xe5907004, 0xe5908008, 0xe5902014,
+		0xe590301c, 0xe5909028, 0xe3530000, 0x0a000026,
+		0xe5c79000, 0xe590a024, 0xe5c8a000, 0xe3190c01,
+		0x11a0a42a, 0x15c8a000, 0xe1a0a002, 0xe1a0b829,
+		0xe20bb0ff, 0xe5c8a000, 0xe1a0a42a, 0xe25bb001,
+		0x1afffffb, 0xe3190c02, 0x13a0a030, 0x15c7a000,
+		0xe590a02c, 0xe25aa001, 0x2afffffd, 0xe590a00c,
+		0xe35a0000, 0x0a000007, 0xe590b010, 0xe590c030,
+		0xe59a4000, 0xe114000b, 0x1a000002, 0xe25cc001,
+		0x1afffffa, 0xea000008, 0xe5905020, 0xe5d64000,
+		0xe4c14001, 0xe2555001, 0x1afffffb, 0xe5904018,
+		0xe0822004, 0xe2433001, 0xeaffffd6, 0xe1a00003,
+
+		/* exit: ARMv4 needs hardware breakpoint */
+		0xe1200070,	/* e: bkpt  #0           */
+	};
+
+	/* Same inputs and output.
+	 *
+	 * see contrib/loaders/flash/armv7m_nand_pages.s for src
+	 */
+	static const uint32_t code_armv7m[] = {
+		0x68476806, 0x8008f8d0, 0x69c36942, 0x9028f8d0,
+		0xd03e2b00, 0x9000f887, 0xa024f8d0, 0xa000f888,
+		0x7f80f419, 0xea4fbf1c, 0xf8882a1a, 0x4692a000,
+		0x4b07f3c9, 0xa000f888, 0x2a1aea4f, 0x0b01f1bb,
+		0xf419d1f8, 0xbf1c7f00, 0x0a30f04f, 0xa000f887,
+		0xa02cf8d0, 0x0a01f1ba, 0xf8d0d2fc, 0xf1baa00c,
+		0xd00c0f00, 0xb010f8d0, 0xc030f8d0, 0x4000f8da,
+		0x0f0bea14, 0xf1bcd103, 0xd1f70c01, 0x6a05e009,
+		0xf8017834, 0x1e6d4b01, 0x6984d1fa, 0x1e5b4422,
+		0x4618e7be, 0xbf00be00,
+	};
+
+	int target_code_size = 0;
+	const uint32_t *target_code_src = NULL;
+
+	if (!nand->cmd || !nand->addr)
+		return ERROR_NAND_NO_BUFFER;
+	if (device->device->options & NAND_BUSWIDTH_16)
+		return ERROR_NAND_NO_BUFFER;
+	if (!count || !size)
+		return ERROR_OK;
+
+	/* set up algorithm */
+	if (is_armv7m(target_to_armv7m(target))) {  /* armv7m target */
+		armv7m_algo.common_magic = ARMV7M_COMMON_MAGIC;
+		armv7m_algo.core_mode = ARM_MODE_THREAD;
+		arm_algo = &armv7m_algo;
+		target_code_size = sizeof(code_armv7m);
+		target_code_src = code_armv7m;
+	} else {
+		armv4_5_algo.common_magic = ARM_COMMON_MAGIC;
+		armv4_5_algo.core_mode = ARM_MODE_SVC;
+		armv4_5_algo.core_state = ARM_STATE_ARM;
+		arm_algo = &armv4_5_algo;
+		target_code_size = sizeof(code_armv4_5);
+		target_code_src = code_armv4_5;
+	}
+
+	batch = ARM_NAND_PAGES_BUFFER / size;
+	if (batch == 0)
+		batch = 1;
+	if (batch > count)
+		batch = count;
+
+	/* reuse the area from an earlier batch if it is big enough,
+	 * else settle for fewer pages per call when memory is tight
+	 */
+	if (nand->op == ARM_NAND_READ_PAGES && nand->copy_area
+			&& (nand->copy_area->size - target_code_size - sizeof(params))
+				/ size >= batch) {
+		batch = (nand->copy_area->size - target_code_size - sizeof(params))
+				/ size;
+	} else {
+		if (nand->copy_area) {
+			target_free_working_area(target, nand->copy_area);
+			nand->copy_area = NULL;
+		}
+		nand->op = ARM_NAND_NONE;
+
+		for (;;) {
+			retval = arm_code_to_working_area(target, target_code_src,
+					target_code_size, sizeof(params) + batch * size,
+					&nand->copy_area);
+			if (retval == ERROR_OK)
+				break;
+			if (retval != ERROR_NAND_NO_BUFFER || batch == 1)
+				return retval;
+			batch /= 2;
+		}
+		nand->op = ARM_NAND_READ_PAGES;
+	}
+
+	params_addr = nand->copy_area->address + target_code_size;
+	target_buf = params_addr + sizeof(params);
+
+	small_page = device->page_size <= 512;
+
+	params[PAGES_DATA] = nand->data;
+	params[PAGES_CMD] = nand->cmd;
+	params[PAGES_ADDR] = nand->addr;
+	params[PAGES_READY] = nand->ready;
+	params[PAGES_READY_MASK] = nand->ready_mask;
+	params[PAGES_STEP] = step;
+	params[PAGES_SIZE] = size;
+
+	/* Small page chips reach the spare area through READOOB, large
+	 * page ones by a column address past the data plus READSTART.
+	 */
+	if (small_page) {
+		params[PAGES_COLUMN] = 0;
+		params[PAGES_CONTROL] = oob_only ? NAND_CMD_READOOB : NAND_CMD_READ0;
+		params[PAGES_CONTROL] |= (device->address_cycles - 1) << 16;
+	} else {
+		params[PAGES_COLUMN] = oob_only ? device->page_size : 0;
+		params[PAGES_CONTROL] = NAND_CMD_READ0 | 0x100 | 0x200;
+		params[PAGES_CONTROL] |= (device->address_cycles - 2) << 16;
+	}
+
+	/* With a ready register, only cover tWB before R/B# goes busy;
+	 * otherwise wait out the whole array read time (tR).
+	 */
+	params[PAGES_DELAY] = nand->ready ? 100 : 20000;
+	params[PAGES_TIMEOUT] = 1000000;
+
+	/* set up parameters */
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN_OUT);
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_IN);
+
+	/* armv4 must exit using a hardware breakpoint */
+	if (arm->is_armv4)
+		exit_var = nand->copy_area->address + target_code_size - 4;
+
+	for (done = 0; done < count; done += batch) {
+		if (batch > count - done)
+			batch = count - done;
+
+		params[PAGES_FIRST] = page + done * step;
+		params[PAGES_COUNT] = batch;
+		target_buffer_set_u32_array(target, params_buf,
+				PAGES_NUM_PARAMS, params);
+		retval = target_write_buffer(target, params_addr,
+				sizeof(params_buf), params_buf);
+		if (retval != ERROR_OK)
+			break;
+
+		buf_set_u32(reg_params[0].value, 0, 32, params_addr);
+		buf_set_u32(reg_params[1].value, 0, 32, target_buf);
+
+		/* use alg to read the pages from NAND chip to work area */
+		retval = target_run_algorithm(target, 0, NULL, 2, reg_params,
+				nand->copy_area->address, exit_var,
+				1000 + 10 * batch, arm_algo);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("error executing hosted NAND page read");
+			break;
+		}
+
+		left = buf_get_u32(reg_params[0].value, 0, 32);
+		if (left) {
+			LOG_ERROR("NAND page %" PRIu32 " not ready",
+					page + (done + batch - left) * step);
+			retval = ERROR_NAND_OPERATION_TIMEOUT;
+			break;
+		}
+
+		/* read from work area to the host's memory */
+		retval = target_read_buffer(target, target_buf, batch * size,
+				data + done * size);
+		if (retval != ERROR_OK)
+			break;
+	}
+
+	destroy_reg_param(&reg_params[0]);
+	destroy_reg_param(&reg_params[1]);
+
+	return retval;
+}
@@ -17,6 +17,8 @@
 #ifndef OPENOCD_FLASH_NAND_ARM_IO_H
 #define OPENOCD_FLASH_NAND_ARM_IO_H
 
+struct nand_device;
+
 /**
  * Available operational states the arm_nand_data struct can be in.
  */
@@ -24,6 +26,7 @@ enum arm_nand_op {
 	ARM_NAND_NONE,	/**< No operation performed. */
 	ARM_NAND_READ,	/**< Read operation performed. */
 	ARM_NAND_WRITE,	/**< Write operation performed. */
+	ARM_NAND_READ_PAGES,	/**< Batched page read performed. */
 };
 
 /**
@@ -43,6 +46,18 @@ struct arm_nand_data {
 	/** Where data is read from or written to. */
 	uint32_t data;
 
+	/** Where commands are written (CLE); zero disables batched reads. */
+	uint32_t cmd;
+
+	/** Where address cycles are written (ALE). */
+	uint32_t addr;
+
+	/** Register polled for chip ready; zero means use a fixed delay. */
+	uint32_t ready;
+
+	/** Bits of the ready register that are set once the chip is ready. */
+	uint32_t ready_mask;
+
 	/** Last operation executed using this struct. */
 	enum arm_nand_op op;
 
@@ -51,5 +66,8 @@ struct arm_nand_data {
 
 int arm_nandwrite(struct arm_nand_data *nand, uint8_t *data, int size);
 int arm_nandread(struct arm_nand_data *nand, uint8_t *data, uint32_t size);
+int arm_nandread_pages(struct arm_nand_data *nand, struct nand_device *device,
+		uint32_t page, uint32_t step, uint32_t count, bool oob_only,
+		uint8_t *data, uint32_t size);
 
 #endif /* OPENOCD_FLASH_NAND_ARM_IO_H */
@@ -0,0 +1,471 @@
+/*
+ * Binary BCH ECC for NAND, compatible with the Linux "soft BCH" layout
+ * (lib/bch.c plus drivers/mtd/nand/nand_bch.c): same primitive
+ * polynomials, same generator, same bit order and same erased-page mask,
+ * so pages written through OpenOCD read back cleanly under Linux.
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 or (at your option) any
+ * later version.
+ *
+ * This file is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "core.h"
+
+/*
+ * A message of eccsize bytes is read as a polynomial over GF(2), byte 0
+ * bit 7 being the highest order coefficient.  The ECC is the remainder of
+ * that polynomial times X^deg(g) divided by the generator g(X), stored
+ * left aligned (MSB first) in the ECC bytes.  g(X) is the product of the
+ * minimal polynomials of a^1 .. a^2t in GF(2^m), a being a root of the
+ * primitive polynomial below.
+ */
+static const unsigned bch_prim_poly[] = {
+	0x25, 0x43, 0x83, 0x11d, 0x211, 0x409, 0x805, 0x1053, 0x201b, 0x402b,
+	0x8003,
+};
+
+#define BCH_MIN_M	5
+#define BCH_MAX_M	15
+
+struct nand_bch {
+	unsigned m;		/* field is GF(2^m) */
+	unsigned n;		/* 2^m - 1 */
+	unsigned t;		/* correctable bit errors */
+	unsigned eccsize;	/* data bytes per ECC step */
+	unsigned eccbytes;	/* ECC bytes per step */
+	unsigned ecc_bits;	/* degree of g(X) */
+	unsigned ecc_words;	/* 32-bit words holding ecc_bits */
+
+	uint16_t *a_pow;	/* a^i, for i in [0..n) */
+	uint16_t *a_log;	/* log_a(x), for x in [1..n] */
+
+	/*
+	 * Four 256-entry tables of ecc_words each: table k entry v holds
+	 * (v(X) * X^(8k + ecc_bits)) mod g(X), so a whole 32-bit message
+	 * word is reduced with four lookups.
+	 */
+	uint32_t *mod8_tab;
+
+	uint8_t *eccmask;	/* makes the ECC of an erased step all 0xff */
+
+	uint32_t *ecc_buf;	/* scratch remainder */
+	unsigned *syn;		/* scratch syndromes S1..S2t */
+	unsigned *elp;		/* scratch error locator polynomial */
+	unsigned *elp_prev;	/* scratch; Chien search term logs */
+	unsigned *elp_tmp;	/* scratch; error positions */
+};
+
+static inline unsigned bch_mod(struct nand_bch *bch, unsigned v)
+{
+	while (v >= bch->n)
+		v -= bch->n;
+	return v;
+}
+
+static inline unsigned bch_mul(struct nand_bch *bch, unsigned a, unsigned b)
+{
+	if (!a || !b)
+		return 0;
+	return bch->a_pow[bch_mod(bch, bch->a_log[a] + bch->a_log[b])];
+}
+
+static inline unsigned bch_div(struct nand_bch *bch, unsigned a, unsigned b)
+{
+	if (!a)
+		return 0;
+	return bch->a_pow[bch_mod(bch, bch->a_log[a] + bch->n - bch->a_log[b])];
+}
+
+/* reduce the left aligned remainder by whole 32-bit message words */
+static void bch_encode_words(struct nand_bch *bch, const uint8_t *data,
+	unsigned words)
+{
+	const unsigned l = bch->ecc_words;
+	uint32_t *r = bch->ecc_buf;
+	const uint32_t *p0, *p1, *p2, *p3;
+	uint32_t w;
+	unsigned i;
+
+	while (words--) {
+		w = r[0] ^ be_to_h_u32(data);
+		data += 4;
+
+		p0 = bch->mod8_tab + l * (0 * 256 + (w & 0xff));
+		p1 = bch->mod8_tab + l * (1 * 256 + ((w >> 8) & 0xff));
+		p2 = bch->mod8_tab + l * (2 * 256 + ((w >> 16) & 0xff));
+		p3 = bch->mod8_tab + l * (3 * 256 + (w >> 24));
+
+		for (i = 0; i + 1 < l; i++)
+			r[i] = r[i + 1] ^ p0[i] ^ p1[i] ^ p2[i] ^ p3[i];
+		r[l - 1] = p0[l - 1] ^ p1[l - 1] ^ p2[l - 1] ^ p3[l - 1];
+	}
+}
+
+/* same, one byte at a time, for a length that isn't a multiple of four */
+static void bch_encode_bytes(struct nand_bch *bch, const uint8_t *data,
+	unsigned len)
+{
+	const unsigned l = bch->ecc_words;
+	uint32_t *r = bch->ecc_buf;
+	const uint32_t *p;
+	unsigned i;
+
+	while (len--) {
+		p = bch->mod8_tab + l * ((r[0] >> 24) ^ *data++);
+
+		for (i = 0; i + 1 < l; i++)
+			r[i] = ((r[i] << 8) | (r[i + 1] >> 24)) ^ p[i];
+		r[l - 1] = (r[l - 1] << 8) ^ p[l - 1];
+	}
+}
+
+static void bch_encode(struct nand_bch *bch, const uint8_t *data, uint8_t *ecc)
+{
+	unsigned i;
+
+	memset(bch->ecc_buf, 0, bch->ecc_words * sizeof(uint32_t));
+
+	bch_encode_words(bch, data, bch->eccsize / 4);
+	bch_encode_bytes(bch, data + (bch->eccsize & ~3), bch->eccsize & 3);
+
+	for (i = 0; i < bch->eccbytes; i++)
+		ecc[i] = bch->ecc_buf[i / 4] >> (24 - 8 * (i % 4));
+}
+
+/*
+ * Multiply out g(X) from the cyclotomic cosets of a^1, a^3 .. a^(2t-1)
+ * and return it left aligned in words, X^deg(g) included.
+ */
+static int bch_build_generator(struct nand_bch *bch, uint32_t *genpoly)
+{
+	uint8_t *roots;
+	unsigned *g;
+	unsigned i, j, r, deg, bits, word;
+
+	roots = calloc(bch->n + 1, 1);
+	g = calloc(bch->m * bch->t + 1, sizeof(*g));
+	if (!roots || !g) {
+		free(roots);
+		free(g);
+		return ERROR_FAIL;
+	}
+
+	for (i = 0; i < bch->t; i++) {
+		for (j = 0, r = 2 * i + 1; j < bch->m; j++) {
+			roots[r] = 1;
+			r = bch_mod(bch, 2 * r);
+		}
+	}
+
+	deg = 0;
+	g[0] = 1;
+	for (i = 0; i < bch->n; i++) {
+		if (!roots[i])
+			continue;
+		/* multiply g(X) by (X + a^i) */
+		r = bch->a_pow[i];
+		g[deg + 1] = 1;
+		for (j = deg; j > 0; j--)
+			g[j] = bch_mul(bch, g[j], r) ^ g[j - 1];
+		g[0] = bch_mul(bch, g[0], r);
+		deg++;
+	}
+	bch->ecc_bits = deg;
+
+	/* the coefficients all end up in GF(2) */
+	memset(genpoly, 0, (bch->ecc_words + 1) * sizeof(uint32_t));
+	for (i = 0, bits = deg + 1; bits > 0; i++) {
+		word = 0;
+		for (j = 0; j < 32 && j < bits; j++) {
+			if (g[bits - 1 - j])
+				word |= 1u << (31 - j);
+		}
+		genpoly[i] = word;
+		bits -= j;
+	}
+
+	free(roots);
+	free(g);
+	return ERROR_OK;
+}
+
+static void bch_build_mod8_tables(struct nand_bch *bch, const uint32_t *g)
+{
+	const unsigned l = bch->ecc_words;
+	unsigned v, k, d, j;
+	uint32_t data, *tab;
+
+	memset(bch->mod8_tab, 0, 4 * 256 * l * sizeof(uint32_t));
+
+	for (v = 0; v < 256; v++) {
+		for (k = 0; k < 4; k++) {
+			/* long division of v(X) * X^(8k + deg(g)) by g(X) */
+			tab = bch->mod8_tab + (k * 256 + v) * l;
+			data = v << (8 * k);
+			while (data) {
+				d = 31;
+				while (!(data & (1u << d)))
+					d--;
+				/* subtract X^d * g(X), leaving the low part in tab */
+				data ^= g[0] >> (31 - d);
+				for (j = 0; j < l; j++) {
+					uint32_t hi = (d < 31) ? g[j] << (d + 1) : 0;
+					uint32_t lo = g[j + 1] >> (31 - d);
+					tab[j] ^= hi | lo;
+				}
+			}
+		}
+	}
+}
+
+/**
+ * Set up BCH ECC for @a eccsize byte steps with @a eccbytes ECC bytes
+ * each, choosing the field and strength the way Linux does:
+ * m = fls(1 + 8 * eccsize), t = 8 * eccbytes / m.  For the common
+ * 512 byte step, 7 bytes give t = 4 and 13 bytes give t = 8.
+ *
+ * @returns the BCH state, or NULL for unsupported parameters.
+ */
+struct nand_bch *nand_bch_init(unsigned eccsize, unsigned eccbytes)
+{
+	struct nand_bch *bch;
+	uint32_t *genpoly = NULL;
+	uint8_t *erased = NULL;
+	unsigned m, i, x;
+
+	for (m = 0; (1u << m) <= 1 + 8 * eccsize; m++)
+		;
+	if (m < BCH_MIN_M || m > BCH_MAX_M || eccbytes == 0) {
+		LOG_ERROR("unsupported BCH step of %u bytes", eccsize);
+		return NULL;
+	}
+
+	bch = calloc(1, sizeof(*bch));
+	if (!bch)
+		return NULL;
+
+	bch->m = m;
+	bch->n = (1u << m) - 1;
+	bch->t = 8 * eccbytes / m;
+	bch->eccsize = eccsize;
+	bch->eccbytes = eccbytes;
+	bch->ecc_words = (m * bch->t + 31) / 32;
+
+	if (bch->t == 0 || eccbytes != (m * bch->t + 7) / 8
+			|| 8 * eccsize + m * bch->t > bch->n) {
+		LOG_ERROR("unsupported BCH layout: %u ECC bytes per %u byte step",
+				eccbytes, eccsize);
+		goto fail;
+	}
+
+	bch->a_pow = calloc(bch->n + 1, sizeof(uint16_t));
+	bch->a_log = calloc(bch->n + 1, sizeof(uint16_t));
+	bch->mod8_tab = calloc(4 * 256 * bch->ecc_words, sizeof(uint32_t));
+	bch->eccmask = calloc(eccbytes, 1);
+	bch->ecc_buf = calloc(bch->ecc_words, sizeof(uint32_t));
+	bch->syn = calloc(2 * bch->t + 1, sizeof(unsigned));
+	bch->elp = calloc(2 * bch->t + 2, sizeof(unsigned));
+	bch->elp_prev = calloc(2 * bch->t + 2, sizeof(unsigned));
+	bch->elp_tmp = calloc(2 * bch->t + 2, sizeof(unsigned));
+	genpoly = calloc(bch->ecc_words + 1, sizeof(uint32_t));
+	erased = malloc(eccsize);
+	if (!bch->a_pow || !bch->a_log || !bch->mod8_tab || !bch->eccmask
+			|| !bch->ecc_buf || !bch->syn || !bch->elp || !bch->elp_prev
+			|| !bch->elp_tmp || !genpoly || !erased)
+		goto fail;
+
+	for (i = 0, x = 1; i < bch->n; i++) {
+		bch->a_pow[i] = x;
+		bch->a_log[x] = i;
+		x <<= 1;
+		if (x & (1u << m))
+			x ^= bch_prim_poly[m - BCH_MIN_M];
+	}
+
+	if (bch_build_generator(bch, genpoly) != ERROR_OK)
+		goto fail;
+	bch_build_mod8_tables(bch, genpoly);
+
+	/* an erased step must carry an erased (all 0xff) ECC */
+	memset(erased, 0xff, eccsize);
+	bch_encode(bch, erased, bch->eccmask);
+	for (i = 0; i < eccbytes; i++)
+		bch->eccmask[i] ^= 0xff;
+
+	free(genpoly);
+	free(erased);
+	return bch;
+
+fail:
+	free(genpoly);
+	free(erased);
+	nand_bch_free(bch);
+	return NULL;
+}
+
+void nand_bch_free(struct nand_bch *bch)
+{
+	if (!bch)
+		return;
+
+	free(bch->a_pow);
+	free(bch->a_log);
+	free(bch->mod8_tab);
+	free(bch->eccmask);
+	free(bch->ecc_buf);
+	free(bch->syn);
+	free(bch->elp);
+	free(bch->elp_prev);
+	free(bch->elp_tmp);
+	free(bch);
+}
+
+/**
+ * Compute the ECC bytes for one step of data.
+ */
+int nand_calculate_ecc_bch(struct nand_bch *bch, const uint8_t *dat,
+	uint8_t *ecc_code)
+{
+	unsigned i;
+
+	bch_encode(bch, dat, ecc_code);
+	for (i = 0; i < bch->eccbytes; i++)
+		ecc_code[i] ^= bch->eccmask[i];
+
+	return 0;
+}
+
+/*
+ * Berlekamp-Massey: find the error locator polynomial of least degree
+ * matching the syndromes; returns its degree, the number of errors.
+ */
+static int bch_error_locator(struct nand_bch *bch)
+{
+	const unsigned nsyn = 2 * bch->t;
+	unsigned *c = bch->elp, *b = bch->elp_prev, *tmp = bch->elp_tmp;
+	unsigned d, bd, coef;
+	unsigned i, k, shift, len;
+
+	memset(c, 0, (nsyn + 2) * sizeof(unsigned));
+	memset(b, 0, (nsyn + 2) * sizeof(unsigned));
+	c[0] = 1;
+	b[0] = 1;
+	len = 0;
+	shift = 1;
+	bd = 1;
+
+	for (k = 0; k < nsyn; k++) {
+		/* discrepancy */
+		d = bch->syn[k + 1];
+		for (i = 1; i <= len; i++)
+			d ^= bch_mul(bch, c[i], bch->syn[k + 1 - i]);
+
+		if (!d) {
+			shift++;
+			continue;
+		}
+
+		coef = bch_div(bch, d, bd);
+		if (2 * len <= k) {
+			memcpy(tmp, c, (nsyn + 2) * sizeof(unsigned));
+			for (i = 0; i + shift <= nsyn + 1; i++)
+				c[i + shift] ^= bch_mul(bch, coef, b[i]);
+			len = k + 1 - len;
+			memcpy(b, tmp, (nsyn + 2) * sizeof(unsigned));
+			bd = d;
+			shift = 1;
+		} else {
+			for (i = 0; i + shift <= nsyn + 1; i++)
+				c[i + shift] ^= bch_mul(bch, coef, b[i]);
+			shift++;
+		}
+	}
+
+	return len;
+}
+
+/**
+ * Detect and correct up to t bit errors in one step of data, given the
+ * ECC read from the spare area and the ECC computed over the data read.
+ *
+ * @returns the number of bit errors corrected (errors in the ECC bytes
+ * themselves included), or -1 if the step can't be corrected.
+ */
+int nand_correct_data_bch(struct nand_bch *bch, uint8_t *dat,
+	const uint8_t *read_ecc, const uint8_t *calc_ecc)
+{
+	const unsigned nbits = 8 * bch->eccsize + bch->ecc_bits;
+	unsigned i, j, k, deg, nerr, found, sum, v;
+	unsigned *elp = bch->elp;
+	unsigned *lg = bch->elp_prev;
+	unsigned *pos = bch->elp_tmp;
+	uint8_t diff;
+	int errors;
+
+	/* syndromes of the remainder difference r(X) */
+	memset(bch->syn, 0, (2 * bch->t + 1) * sizeof(unsigned));
+	errors = 0;
+	for (i = 0; i < bch->eccbytes; i++) {
+		diff = read_ecc[i] ^ calc_ecc[i];
+		for (j = 0; diff && j < 8; j++, diff <<= 1) {
+			if (!(diff & 0x80) || 8 * i + j >= bch->ecc_bits)
+				continue;
+			deg = bch->ecc_bits - 1 - (8 * i + j);
+			for (k = 1; k <= 2 * bch->t; k++)
+				bch->syn[k] ^= bch->a_pow[(deg * k) % bch->n];
+			errors = 1;
+		}
+	}
+	if (!errors)
+		return 0;
+
+	nerr = bch_error_locator(bch);
+	if (nerr > bch->t)
+		return -1;
+
+	/*
+	 * Chien search over the shortened code: position p is in error when
+	 * elp(a^-p) == 0.  Each term's log drops by its degree per step.
+	 */
+	for (i = 1; i <= nerr; i++)
+		lg[i] = elp[i] ? bch->a_log[elp[i]] : 0;
+
+	found = 0;
+	for (v = 0; v < nbits && found < nerr; v++) {
+		sum = 1;
+		for (i = 1; i <= nerr; i++) {
+			if (elp[i])
+				sum ^= bch->a_pow[lg[i]];
+			lg[i] = bch_mod(bch, lg[i] + bch->n - i);
+		}
+		if (!sum)
+			pos[found++] = v;
+	}
+
+	/* leave the data alone unless every root was located */
+	if (found != nerr)
+		return -1;
+
+	for (i = 0; i < found; i++) {
+		if (pos[i] < bch->ecc_bits)
+			continue;
+		/* data bit, counted from byte 0 bit 7 */
+		k = nbits - 1 - pos[i];
+		dat[k / 8] ^= 0x80 >> (k % 8);
+	}
+
+	return nerr;
+}
@@ -223,12 +223,15 @@ COMMAND_HELPER(nand_command_get_device, unsigned name_index,
 	return ERROR_OK;
 }
 
+/* blocks whose markers are fetched per nand_read_pages() call */
+#define NAND_BBT_BATCH 256
+
 int nand_build_bbt(struct nand_device *nand, int first, int last)
 {
-	uint32_t page;
-	int i;
+	int i, j, n;
 	int pages_per_block = (nand->erase_size / nand->page_size);
-	uint8_t oob[6];
+	uint8_t oob[NAND_BBT_BATCH * 6];
+	uint8_t *marker;
 	int ret;
 
 	if ((first < 0) || (first >= nand->num_blocks))
@@ -237,21 +240,27 @@ int nand_build_bbt(struct nand_device *nand, int first, int last)
 	if ((last >= nand->num_blocks) || (last == -1))
 		last = nand->num_blocks - 1;
 
-	page = first * pages_per_block;
-	for (i = first; i <= last; i++) {
-		ret = nand_read_page(nand, page, NULL, 0, oob, 6);
+	for (i = first; i <= last; i += n) {
+		n = last - i + 1;
+		if (n > NAND_BBT_BATCH)
+			n = NAND_BBT_BATCH;
+
+		/* the first page of each block holds its marker */
+		ret = nand_read_pages(nand, i * pages_per_block, pages_per_block,
+				n, true, oob, 6);
 		if (ret != ERROR_OK)
 			return ret;
 
-		if (((nand->device->options & NAND_BUSWIDTH_16) && ((oob[0] & oob[1]) != 0xff))
-				|| (((nand->page_size == 512) && (oob[5] != 0xff)) ||
-				((nand->page_size == 2048) && (oob[0] != 0xff)))) {
-			LOG_WARNING("bad block: %i", i);
-			nand->blocks[i].is_bad = 1;
-		} else
-			nand->blocks[i].is_bad = 0;
-
-		page += pages_per_block;
+		for (j = 0, marker = oob; j < n; j++, marker += 6) {
+			if (((nand->device->options & NAND_BUSWIDTH_16)
+					&& ((marker[0] & marker[1]) != 0xff))
+					|| (((nand->page_size == 512) && (marker[5] != 0xff)) ||
+					((nand->page_size == 2048) && (marker[0] != 0xff)))) {
+				LOG_WARNING("bad block: %i", i + j);
+				nand->blocks[i + j].is_bad = 1;
+			} else
+				nand->blocks[i + j].is_bad = 0;
+		}
 	}
 
 	return ERROR_OK;
@@ -684,6 +693,39 @@ int nand_read_page(struct nand_device *nand, uint32_t page,
 		return nand->controller->read_page(nand, page, data, data_size, oob, oob_size);
 }
 
+/**
+ * Read the same span of several pages, @a step pages apart, through the
+ * controller's batched path when it has one, else one page at a time.
+ * @a buf receives @a size bytes per page, from the page data or (with
+ * @a oob_only) from its spare area.
+ */
+int nand_read_pages(struct nand_device *nand, uint32_t page, uint32_t step,
+	uint32_t count, bool oob_only, uint8_t *buf, uint32_t size)
+{
+	int retval = ERROR_NAND_NO_BUFFER;
+
+	if (!nand->device)
+		return ERROR_NAND_DEVICE_NOT_PROBED;
+
+	if (nand->controller->read_pages != NULL)
+		retval = nand->controller->read_pages(nand, page, step, count,
+				oob_only, buf, size);
+
+	if (ERROR_NAND_NO_BUFFER != retval)
+		return retval;
+
+	for (retval = ERROR_OK; retval == ERROR_OK && count > 0; count--) {
+		if (oob_only)
+			retval = nand_read_page(nand, page, NULL, 0, buf, size);
+		else
+			retval = nand_read_page(nand, page, buf, size, NULL, 0);
+		buf += size;
+		page += step;
+	}
+
+	return retval;
+}
+
 int nand_page_command(struct nand_device *nand, uint32_t page,
 	uint8_t cmd, bool oob_only)
 {
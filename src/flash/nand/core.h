@@ -186,6 +186,7 @@ enum oob_formats {
 	NAND_OOB_SW_ECC = 0x10,	/* when writing, use SW ECC (as opposed to no ECC) */
 	NAND_OOB_HW_ECC = 0x20,	/* when writing, use HW ECC (as opposed to no ECC) */
 	NAND_OOB_SW_ECC_KW = 0x40,	/* when writing, use Marvell's Kirkwood bootrom format */
+	NAND_OOB_SW_ECC_BCH = 0x80,	/* use Linux style 4-bit BCH ECC (7 bytes per 512) */
 	NAND_OOB_JFFS2 = 0x100,	/* when writing, use JFFS2 OOB layout */
 	NAND_OOB_YAFFS2 = 0x100,/* when writing, use YAFFS2 OOB layout */
 };
@@ -214,6 +215,14 @@ int nand_calculate_ecc(struct nand_device *nand,
 int nand_calculate_ecc_kw(struct nand_device *nand,
 			  const uint8_t *dat, uint8_t *ecc_code);
 
+struct nand_bch;
+struct nand_bch *nand_bch_init(unsigned eccsize, unsigned eccbytes);
+void nand_bch_free(struct nand_bch *bch);
+int nand_calculate_ecc_bch(struct nand_bch *bch,
+			   const uint8_t *dat, uint8_t *ecc_code);
+int nand_correct_data_bch(struct nand_bch *bch, uint8_t *dat,
+			  const uint8_t *read_ecc, const uint8_t *calc_ecc);
+
 int nand_register_commands(struct command_context *cmd_ctx);
 
 /** helper for parsing a nand device command argument string */
@@ -48,7 +48,7 @@ struct davinci_nand {
 	uint32_t cmd;				/* with CLE */
 	uint32_t addr;				/* with ALE */
 
-	/* write acceleration */
+	/* write and batched page read acceleration */
 	struct arm_nand_data io;
 
 	/* page i/o for the relevant flavor of hardware ECC */
@@ -311,6 +311,24 @@ static int davinci_read_page(struct nand_device *nand, uint32_t page,
 	return info->read_page(nand, page, data, data_size, oob, oob_size);
 }
 
+static int davinci_read_pages(struct nand_device *nand, uint32_t page,
+	uint32_t step, uint32_t count, bool oob_only, uint8_t *buf, uint32_t size)
+{
+	struct davinci_nand *info = nand->controller_priv;
+
+	if (!nand->device)
+		return ERROR_NAND_DEVICE_NOT_PROBED;
+	if (!halted(nand->target, "read_pages"))
+		return ERROR_NAND_OPERATION_FAILED;
+
+	/* only the raw layouts keep data and OOB where the loop expects */
+	if (!nand->use_raw && info->read_page != nand_read_page_raw)
+		return ERROR_NAND_NO_BUFFER;
+
+	return arm_nandread_pages(&info->io, nand, page, step, count,
+			oob_only, buf, size);
+}
+
 static void davinci_write_pagecmd(struct nand_device *nand, uint8_t cmd, uint32_t page)
 {
 	struct davinci_nand *info = nand->controller_priv;
@@ -745,6 +763,10 @@ NAND_DEVICE_COMMAND_HANDLER(davinci_nand_device_command)
 
 	info->io.target = nand->target;
 	info->io.data = info->data;
+	info->io.cmd = info->cmd;
+	info->io.addr = info->addr;
+	info->io.ready = info->aemif + NANDFSR;
+	info->io.ready_mask = 0x01;
 	info->io.op = ARM_NAND_NONE;
 
 	/* NOTE:  for now we don't do any error correction on read.
@@ -787,6 +809,7 @@ struct nand_flash_controller davinci_nand_controller = {
 	.read_data              = davinci_read_data,
 	.write_page             = davinci_write_page,
 	.read_page              = davinci_read_page,
+	.read_pages             = davinci_read_pages,
 	.write_block_data       = davinci_write_block_data,
 	.read_block_data        = davinci_read_block_data,
 	.nand_ready             = davinci_nand_ready,
@@ -75,6 +75,17 @@ struct nand_flash_controller {
 	int (*read_page)(struct nand_device *nand, uint32_t page, uint8_t *data, uint32_t data_size,
 			 uint8_t *oob, uint32_t oob_size);
 
+	/**
+	 * Read @a count pages in one transaction, starting at @a page and
+	 * advancing by @a step pages, storing @a size bytes from each one
+	 * into consecutive slots of @a buf.  With @a oob_only the bytes come
+	 * from the spare area, else from the start of the page data; either
+	 * way the result must match what read_page() would return.  Returns
+	 * ERROR_NAND_NO_BUFFER when the caller should read page by page.
+	 */
+	int (*read_pages)(struct nand_device *nand, uint32_t page, uint32_t step,
+			  uint32_t count, bool oob_only, uint8_t *buf, uint32_t size);
+
 	/** Check if the NAND device is ready for more instructions with timeout. */
 	int (*nand_ready)(struct nand_device *nand, int timeout);
 };
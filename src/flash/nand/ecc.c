@@ -3,8 +3,9 @@
  * and correction of 1-bit errors in a 256 byte block of data.
  *
  * [ Extracted from the initial code found in some early Linux versions.
- *   The current Linux code is bigger while being faster, but this is of
- *   no real benefit when the bottleneck largely remains the JTAG link.  ]
+ *   The parity computation has since been reworked to handle a 64-bit
+ *   word at a time, as the host recomputes it for every page written
+ *   or verified with software ECC.  ]
  *
  * Copyright (C) 2000-2004 Steven J. Hill (sjhill at realitydiluted.com)
  *                         Toshiba America Electronics Components, Inc.
@@ -64,29 +65,63 @@ static const uint8_t nand_ecc_precalc_table[] = {
 	0x00, 0x55, 0x56, 0x03, 0x59, 0x0c, 0x0f, 0x5a, 0x5a, 0x0f, 0x0c, 0x59, 0x03, 0x56, 0x55, 0x00
 };
 
+/*
+ * Parity of all 64 bits of a word, folded down to a byte whose parity
+ * is then taken from bit 6 of the column parity table.
+ */
+static inline uint8_t nand_ecc_parity64(uint64_t w)
+{
+	w ^= w >> 32;
+	w ^= w >> 16;
+	w ^= w >> 8;
+	return (nand_ecc_precalc_table[w & 0xff] >> 6) & 0x01;
+}
+
 /*
  * nand_calculate_ecc - Calculate 3-byte ECC for 256-byte block
+ *
+ * The block is consumed as 32 little endian 64-bit words.  Line parity
+ * bit k is the parity of all bytes whose offset has bit k set: bits 3..7
+ * select whole words, which a pairwise XOR reduction collects, while
+ * bits 0..2 select byte lanes within the XOR of every word.  Column
+ * parity only depends on that XOR folded down to one byte.
  */
 int nand_calculate_ecc(struct nand_device *nand, const uint8_t *dat, uint8_t *ecc_code)
 {
-	uint8_t idx, reg1, reg2, reg3, tmp1, tmp2;
-	int i;
-
-	/* Initialize variables */
-	reg1 = reg2 = reg3 = 0;
-
-	/* Build up column parity */
-	for (i = 0; i < 256; i++) {
-		/* Get CP0 - CP5 from table */
-		idx = nand_ecc_precalc_table[*dat++];
-		reg1 ^= (idx & 0x3f);
-
-		/* All bit XOR = 1 ? */
-		if (idx & 0x40) {
-			reg3 ^= (uint8_t) i;
-			reg2 ^= ~((uint8_t) i);
+	uint64_t w[32], all, word, lp[5];
+	uint8_t reg1, reg2, reg3, tmp1, tmp2;
+	int i, k, n;
+
+	for (i = 0; i < 32; i++, dat += 8)
+		w[i] = le_to_h_u64(dat);
+
+	/* Pairwise reduction: at level k the odd entries are exactly the
+	 * words whose offset has bit k + 3 set.
+	 */
+	for (k = 0, n = 16; k < 5; k++, n /= 2) {
+		lp[k] = 0;
+		for (i = 0; i < n; i++) {
+			lp[k] ^= w[2 * i + 1];
+			w[i] = w[2 * i] ^ w[2 * i + 1];
 		}
 	}
+	all = w[0];
+
+	/* Get CP0 - CP5 from table */
+	word = all ^ (all >> 32);
+	word ^= word >> 16;
+	word ^= word >> 8;
+	reg1 = nand_ecc_precalc_table[word & 0xff] & 0x3f;
+
+	/* Line parity of the odd bytes, by byte offset bit */
+	reg3 = nand_ecc_parity64(all & 0xff00ff00ff00ff00ULL) << 0;
+	reg3 |= nand_ecc_parity64(all & 0xffff0000ffff0000ULL) << 1;
+	reg3 |= nand_ecc_parity64(all & 0xffffffff00000000ULL) << 2;
+	for (k = 0; k < 5; k++)
+		reg3 |= nand_ecc_parity64(lp[k]) << (k + 3);
+
+	/* Complementary line parity differs by the overall parity */
+	reg2 = nand_ecc_parity64(all) ? ~reg3 : reg3;
 
 	/* Create non-inverted ECC code from line parity */
 	tmp1  = (reg3 & 0x80) >> 0; /* B7 -> B7 */
@@ -124,8 +159,8 @@ static inline int countbits(uint32_t b)
 {
 	int res = 0;
 
-	for (; b; b >>= 1)
-		res += b & 0x01;
+	for (; b; b &= b - 1)
+		res++;
 	return res;
 }
 
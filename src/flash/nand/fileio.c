@@ -26,6 +26,10 @@
 #include "core.h"
 #include "fileio.h"
 
+/* Linux soft BCH defaults: 512 byte steps, t = 4, ECC at the end of OOB */
+#define NAND_BCH_STEP	512
+#define NAND_BCH_BYTES	7
+
 static struct nand_ecclayout nand_oob_16 = {
 	.eccbytes = 6,
 	.eccpos = {0, 1, 2, 3, 6, 7},
@@ -81,7 +85,8 @@ int nand_fileio_start(struct command_invocation *cmd,
 		state->page = malloc(nand->page_size);
 	}
 
-	if (state->oob_format & (NAND_OOB_RAW | NAND_OOB_SW_ECC | NAND_OOB_SW_ECC_KW)) {
+	if (state->oob_format & (NAND_OOB_RAW | NAND_OOB_SW_ECC
+			| NAND_OOB_SW_ECC_KW | NAND_OOB_SW_ECC_BCH)) {
 		if (nand->page_size == 512) {
 			state->oob_size = 16;
 			state->eccpos = nand_oob_16.eccpos;
@@ -92,6 +97,19 @@ int nand_fileio_start(struct command_invocation *cmd,
 		state->oob = malloc(state->oob_size);
 	}
 
+	if (state->oob_format & NAND_OOB_SW_ECC_BCH) {
+		if (state->oob_size < (uint32_t)nand->page_size / NAND_BCH_STEP * NAND_BCH_BYTES) {
+			command_print(cmd, "BCH ECC needs 512 or 2048 byte pages");
+			nand_fileio_cleanup(state);
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		}
+		state->bch = nand_bch_init(NAND_BCH_STEP, NAND_BCH_BYTES);
+		if (!state->bch) {
+			nand_fileio_cleanup(state);
+			return ERROR_FAIL;
+		}
+	}
+
 	return ERROR_OK;
 }
 int nand_fileio_cleanup(struct nand_fileio_state *state)
@@ -107,6 +125,8 @@ int nand_fileio_cleanup(struct nand_fileio_state *state)
 		free(state->page);
 		state->page = NULL;
 	}
+	nand_bch_free(state->bch);
+	state->bch = NULL;
 	return ERROR_OK;
 }
 int nand_fileio_finish(struct nand_fileio_state *state)
@@ -154,6 +174,8 @@ COMMAND_HELPER(nand_fileio_parse_args, struct nand_fileio_state *state,
 				state->oob_format |= NAND_OOB_SW_ECC;
 			else if (sw_ecc && !strcmp(CMD_ARGV[i], "oob_softecc_kw"))
 				state->oob_format |= NAND_OOB_SW_ECC_KW;
+			else if (!strcmp(CMD_ARGV[i], "oob_softecc_bch"))
+				state->oob_format |= NAND_OOB_SW_ECC_BCH;
 			else {
 				command_print(CMD, "unknown option: %s", CMD_ARGV[i]);
 				return ERROR_COMMAND_SYNTAX_ERROR;
@@ -216,6 +238,15 @@ int nand_fileio_read(struct nand_device *nand, struct nand_fileio_state *s)
 			nand_calculate_ecc_kw(nand, s->page + i, ecc);
 			ecc += 10;
 		}
+	} else if (s->oob_format & NAND_OOB_SW_ECC_BCH) {
+		/* ECC bytes of all steps sit together at the end of the OOB */
+		uint8_t *ecc = s->oob + s->oob_size
+				- s->page_size / NAND_BCH_STEP * NAND_BCH_BYTES;
+		memset(s->oob, 0xff, s->oob_size);
+		for (uint32_t i = 0; i < s->page_size; i += NAND_BCH_STEP) {
+			nand_calculate_ecc_bch(s->bch, s->page + i, ecc);
+			ecc += NAND_BCH_BYTES;
+		}
 	} else if (NULL != s->oob)   {
 		fileio_read(s->fileio, s->oob_size, s->oob, &one_read);
 		if (one_read < s->oob_size)
@@ -224,3 +255,32 @@ int nand_fileio_read(struct nand_device *nand, struct nand_fileio_state *s)
 	}
 	return total_read;
 }
+
+/**
+ * Correct the page data just read into @a s using the BCH ECC stored
+ * in its OOB.
+ * @returns the number of bit errors corrected, or a negative error code
+ * if some step of the page can't be corrected.
+ */
+int nand_fileio_correct(struct nand_device *nand, struct nand_fileio_state *s)
+{
+	uint8_t calc[NAND_BCH_BYTES];
+	const uint8_t *ecc;
+	int corrected = 0;
+	int ret;
+
+	if (!(s->oob_format & NAND_OOB_SW_ECC_BCH) || !s->page || !s->oob)
+		return 0;
+
+	ecc = s->oob + s->oob_size - s->page_size / NAND_BCH_STEP * NAND_BCH_BYTES;
+	for (uint32_t i = 0; i < s->page_size; i += NAND_BCH_STEP) {
+		nand_calculate_ecc_bch(s->bch, s->page + i, calc);
+		ret = nand_correct_data_bch(s->bch, s->page + i, ecc, calc);
+		if (ret < 0)
+			return ERROR_NAND_OPERATION_FAILED;
+		corrected += ret;
+		ecc += NAND_BCH_BYTES;
+	}
+
+	return corrected;
+}
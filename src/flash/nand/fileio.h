@@ -33,6 +33,7 @@ struct nand_fileio_state {
 	uint32_t oob_size;
 
 	const int *eccpos;
+	struct nand_bch *bch;
 
 	bool file_opened;
 	struct fileio *fileio;
@@ -52,5 +53,6 @@ COMMAND_HELPER(nand_fileio_parse_args, struct nand_fileio_state *state,
 	bool need_size, bool sw_ecc);
 
 int nand_fileio_read(struct nand_device *nand, struct nand_fileio_state *s);
+int nand_fileio_correct(struct nand_device *nand, struct nand_fileio_state *s);
 
 #endif /* OPENOCD_FLASH_NAND_FILEIO_H */
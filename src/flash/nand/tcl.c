@@ -339,35 +339,77 @@ COMMAND_HANDLER(handle_nand_verify_command)
 	return nand_fileio_cleanup(&dev);
 }
 
+/* pages fetched per nand_read_pages() call by "nand dump" */
+#define NAND_DUMP_BATCH 32
+
 COMMAND_HANDLER(handle_nand_dump_command)
 {
 	size_t filesize;
 	struct nand_device *nand = NULL;
 	struct nand_fileio_state s;
+	uint8_t *batch = NULL;
+	uint32_t unit = 0;
+	unsigned corrected = 0;
 	int retval = CALL_COMMAND_HANDLER(nand_fileio_parse_args,
 			&s, &nand, FILEIO_WRITE, true, false);
 	if (ERROR_OK != retval)
 		return retval;
 
+	/* data-only and OOB-only dumps can fetch many pages at once */
+	if ((NULL == s.page) != (NULL == s.oob)) {
+		unit = s.page ? s.page_size : s.oob_size;
+		batch = malloc(NAND_DUMP_BATCH * unit);
+	}
+
 	while (s.size > 0) {
 		size_t size_written;
-		retval = nand_read_page(nand, s.address / nand->page_size,
-				s.page, s.page_size, s.oob, s.oob_size);
+		uint32_t count = 1;
+
+		if (NULL != batch) {
+			count = s.size / nand->page_size;
+			if (count > NAND_DUMP_BATCH)
+				count = NAND_DUMP_BATCH;
+			retval = nand_read_pages(nand, s.address / nand->page_size,
+					1, count, NULL == s.page, batch, unit);
+		} else
+			retval = nand_read_page(nand, s.address / nand->page_size,
+					s.page, s.page_size, s.oob, s.oob_size);
 		if (ERROR_OK != retval) {
 			command_print(CMD, "reading NAND flash page failed");
+			free(batch);
 			nand_fileio_cleanup(&s);
 			return retval;
 		}
 
-		if (NULL != s.page)
-			fileio_write(s.fileio, s.page_size, s.page, &size_written);
+		if (s.oob_format & NAND_OOB_SW_ECC_BCH) {
+			retval = nand_fileio_correct(nand, &s);
+			if (retval < 0) {
+				command_print(CMD, "uncorrectable ECC error "
+					"at 0x%8.8" PRIx32, s.address);
+				nand_fileio_cleanup(&s);
+				return retval;
+			}
+			corrected += retval;
+		}
+
+		if (NULL != batch)
+			fileio_write(s.fileio, count * unit, batch, &size_written);
+		else {
+			if (NULL != s.page)
+				fileio_write(s.fileio, s.page_size, s.page, &size_written);
 
-		if (NULL != s.oob)
-			fileio_write(s.fileio, s.oob_size, s.oob, &size_written);
+			/* BCH dumps keep only the corrected page data */
+			if (NULL != s.oob && !(s.oob_format & NAND_OOB_SW_ECC_BCH))
+				fileio_write(s.fileio, s.oob_size, s.oob, &size_written);
+		}
 
-		s.size -= nand->page_size;
-		s.address += nand->page_size;
+		s.size -= count * nand->page_size;
+		s.address += count * nand->page_size;
 	}
+	free(batch);
+
+	if (corrected)
+		command_print(CMD, "corrected %u bit errors", corrected);
 
 	retval = fileio_size(s.fileio, &filesize);
 	if (retval != ERROR_OK)
@@ -446,7 +488,7 @@ static const struct command_registration nand_exec_command_handlers[] = {
 		.handler = handle_nand_dump_command,
 		.mode = COMMAND_EXEC,
 		.usage = "bank_id filename offset length "
-			"['oob_raw'|'oob_only']",
+			"['oob_raw'|'oob_only'|'oob_softecc_bch']",
 		.help = "dump from NAND flash device",
 	},
 	{
@@ -454,7 +496,8 @@ static const struct command_registration nand_exec_command_handlers[] = {
 		.handler = handle_nand_verify_command,
 		.mode = COMMAND_EXEC,
 		.usage = "bank_id filename offset "
-			"['oob_raw'|'oob_only'|'oob_softecc'|'oob_softecc_kw']",
+			"['oob_raw'|'oob_only'|'oob_softecc'|'oob_softecc_kw'|"
+			"'oob_softecc_bch']",
 		.help = "verify NAND flash device",
 	},
 	{
@@ -462,7 +505,8 @@ static const struct command_registration nand_exec_command_handlers[] = {
 		.handler = handle_nand_write_command,
 		.mode = COMMAND_EXEC,
 		.usage = "bank_id filename offset "
-			"['oob_raw'|'oob_only'|'oob_softecc'|'oob_softecc_kw']",
+			"['oob_raw'|'oob_only'|'oob_softecc'|'oob_softecc_kw'|"
+			"'oob_softecc_bch']",
 		.help = "write to NAND flash device",
 	},
 	{
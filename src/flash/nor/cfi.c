@@ -30,6 +30,8 @@
 #include <target/arm.h>
 #include <target/arm7_9_common.h>
 #include <target/armv7m.h>
+#include <target/embeddedice.h>
+#include <target/register.h>
 #include <target/mips32.h>
 #include <helper/binarybuffer.h>
 #include <target/algorithm.h>
@@ -829,6 +831,8 @@ FLASH_BANK_COMMAND_HANDLER(cfi_flash_bank_command)
 	cfi_info->probed = 0;
 	cfi_info->erase_region_info = NULL;
 	cfi_info->pri_ext = NULL;
+	cfi_info->query_cached = 0;
+	cfi_info->cached_erase_region_info = NULL;
 	bank->driver_priv = cfi_info;
 
 	cfi_info->x16_as_x8 = 0;
@@ -1977,6 +1981,385 @@ static int cfi_spansion_write_block(struct flash_bank *bank, const uint8_t *buff
 	return retval;
 }
 
+/* Block stream fed to the DCC loader by cfi_dcc_completion(), which gets
+ * it through the algorithm's arch_info */
+struct cfi_dcc_algorithm {
+	struct arm_algorithm arm_algo;
+	struct flash_bank *bank;
+	const uint8_t *buffer;
+	uint32_t blocks;
+	uint32_t buffersize;
+	uint32_t *words;
+	int retval;
+};
+
+static int cfi_dcc_send_block(struct target *target, struct arm_jtag *jtag_info,
+	struct cfi_dcc_algorithm *stream, uint32_t block)
+{
+	const uint8_t *data = stream->buffer + block * stream->buffersize;
+	uint32_t nwords = stream->buffersize / 4;
+
+	for (uint32_t i = 0; i < nwords; i++)
+		stream->words[i] = target_buffer_get_u32(target, data + 4 * i);
+
+	return embeddedice_send(jtag_info, stream->words, nwords);
+}
+
+/* Feeds the blocks to the running loader, keeping at most two blocks
+ * beyond the ones acknowledged in flight, as the loader's ring holds
+ * three. Failures are left in the stream's retval once the loader has
+ * stopped, so the algorithm context is still restored. */
+static int cfi_dcc_completion(struct target *target, uint32_t exit_point,
+	int timeout_ms, void *arch_info)
+{
+	struct cfi_dcc_algorithm *stream =
+		container_of(arch_info, struct cfi_dcc_algorithm, arm_algo);
+	struct arm7_9_common *arm7_9 = target_to_arm7_9(target);
+	struct cfi_flash_bank *cfi_info = stream->bank->driver_priv;
+	uint32_t sent = 0, done, ack;
+	int retval;
+
+	retval = target_wait_state(target, TARGET_DEBUG_RUNNING, 500);
+	if (retval != ERROR_OK)
+		return retval;
+
+	for (done = 0; done < stream->blocks; done++) {
+		while (sent < stream->blocks && sent < done + 2) {
+			retval = cfi_dcc_send_block(target, &arm7_9->jtag_info, stream, sent);
+			if (retval != ERROR_OK)
+				break;
+			sent++;
+		}
+		if (retval != ERROR_OK)
+			break;
+
+		retval = embeddedice_handshake(&arm7_9->jtag_info, EICE_COMM_CTRL_WBIT,
+				cfi_info->buf_write_timeout);
+		if (retval != ERROR_OK)
+			break;
+		retval = embeddedice_receive(&arm7_9->jtag_info, &ack, 1);
+		if (retval != ERROR_OK)
+			break;
+		if (ack != 0) {
+			/* the loader has stopped at the failing block */
+			stream->retval = ERROR_FLASH_OPERATION_FAILED;
+			break;
+		}
+	}
+
+	if (retval == ERROR_OK) {
+		retval = target_wait_state(target, TARGET_HALTED, timeout_ms);
+		if (retval == ERROR_OK && buf_get_u32(arm7_9->arm.pc->value, 0, 32) != exit_point)
+			retval = ERROR_TARGET_TIMEOUT;
+	}
+
+	if (retval != ERROR_OK) {
+		LOG_ERROR("DCC stream to the flash loader failed after %" PRIu32 " blocks", done);
+		stream->retval = retval;
+		if (target->state != TARGET_HALTED) {
+			retval = target_halt(target);
+			if (retval != ERROR_OK)
+				return retval;
+			return target_wait_state(target, TARGET_HALTED, 500);
+		}
+	}
+
+	return ERROR_OK;
+}
+
+/* Streams whole write buffers to the flash using buffered program commands.
+ * The on-target algorithm is fed while it runs, so the host transfers the
+ * next buffers while the flash programs the current one. armv7m targets
+ * are fed through a fifo in working memory, using background memory
+ * access; ARM7/ARM9 targets with DCC downloads enabled are fed through
+ * the debug communications channel, which they can read while running.
+ * @a address must be aligned to and @a count a multiple of the write buffer size.
+ */
+static int cfi_write_block_async(struct flash_bank *bank, const uint8_t *buffer,
+	uint32_t address, uint32_t count)
+{
+	struct cfi_flash_bank *cfi_info = bank->driver_priv;
+	struct target *target = bank->target;
+	struct reg_param reg_params[12];
+	struct armv7m_algorithm armv7m_algo;
+	struct cfi_dcc_algorithm dcc_algo;
+	struct working_area *write_algorithm;
+	struct working_area *source = NULL;
+	uint32_t code_size, source_size;
+	bool dcc;
+	int retval;
+
+	/* see contrib/loaders/flash/cfi/cfi_async.S for src */
+	static const uint8_t cfi_async_code[] = {
+#include "../../../contrib/loaders/flash/cfi/cfi_async.inc"
+	};
+
+	/* see contrib/loaders/flash/cfi/cfi_dcc.S for src */
+	static const uint8_t cfi_dcc_code[] = {
+#include "../../../contrib/loaders/flash/cfi/cfi_dcc.inc"
+	};
+
+	/* DCC data is sent without handshake, which is only safe when the
+	 * user vouched for the core keeping up, see "arm7_9 dcc_downloads" */
+	if (is_armv7m(target_to_armv7m(target)))
+		dcc = false;
+	else if (is_arm7_9(target_to_arm7_9(target)) && target_to_arm7_9(target)->dcc_downloads)
+		dcc = true;
+	else
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	/* Calculate buffer size
+	 * buffersize is (buffer size per chip) * (number of chips)
+	 * bufferwsize is buffersize in words */
+	uint32_t buffersize =
+		(1UL << cfi_info->max_buf_write_size) * (bank->bus_width / bank->chip_width);
+	uint32_t bufferwsize = buffersize / bank->bus_width;
+
+	/* the word count is written as a single command cycle */
+	if (bufferwsize == 0 || bufferwsize > 256)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	/* the DCC carries whole 32-bit words */
+	if (dcc && buffersize % 4)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	code_size = dcc ? sizeof(cfi_dcc_code) : sizeof(cfi_async_code);
+	retval = target_alloc_working_area(target, code_size, &write_algorithm);
+	if (retval != ERROR_OK) {
+		LOG_WARNING("no working area available, can't do block memory writes");
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	}
+
+	if (dcc) {
+		/* the loader is kept as little endian words */
+		uint8_t code[sizeof(cfi_dcc_code)];
+		for (unsigned i = 0; i < sizeof(cfi_dcc_code); i += 4)
+			target_buffer_set_u32(target, code + i, le_to_h_u32(cfi_dcc_code + i));
+		retval = target_write_buffer(target, write_algorithm->address,
+				sizeof(code), code);
+	} else {
+		retval = target_write_buffer(target, write_algorithm->address,
+				sizeof(cfi_async_code), cfi_async_code);
+	}
+	if (retval != ERROR_OK) {
+		target_free_working_area(target, write_algorithm);
+		return retval;
+	}
+
+	if (dcc) {
+		/* AMD command values, then a ring of three write buffers */
+		static const uint8_t amd_cmds[] = { 0xaa, 0x55, 0x25, 0x29 };
+		uint8_t cmd_buf[16];
+
+		source_size = 16 + 3 * buffersize;
+		if (target_alloc_working_area_try(target, source_size, &source) != ERROR_OK) {
+			target_free_working_area(target, write_algorithm);
+			LOG_WARNING("no large enough working area available, can't do block memory writes");
+			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		}
+
+		for (unsigned i = 0; i < ARRAY_SIZE(amd_cmds); i++)
+			target_buffer_set_u32(target, cmd_buf + 4 * i,
+					cfi_command_val(bank, amd_cmds[i]));
+		retval = target_write_buffer(target, source->address, sizeof(cmd_buf), cmd_buf);
+		if (retval != ERROR_OK) {
+			target_free_working_area(target, source);
+			target_free_working_area(target, write_algorithm);
+			return retval;
+		}
+	} else {
+		/* fifo of whole write buffers plus read and write pointers,
+		 * at least two buffers are needed to stream */
+		uint32_t fifo_buffers = 32768 / buffersize;
+		if (fifo_buffers < 2)
+			fifo_buffers = 2;
+		while (target_alloc_working_area_try(target, 8 + fifo_buffers * buffersize,
+					&source) != ERROR_OK) {
+			fifo_buffers /= 2;
+			if (fifo_buffers < 2) {
+				target_free_working_area(target, write_algorithm);
+				LOG_WARNING("no large enough working area available, can't do block memory writes");
+				return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+			}
+		}
+		source_size = source->size;
+	}
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_OUT);	/* workarea start */
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);	/* workarea end */
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_IN_OUT);	/* flash address */
+	init_reg_param(&reg_params[3], "r3", 32, PARAM_OUT);	/* block count */
+	init_reg_param(&reg_params[4], "r4", 32, PARAM_IN_OUT);	/* bus width, status */
+	init_reg_param(&reg_params[5], "r5", 32, PARAM_OUT);	/* words per block */
+	init_reg_param(&reg_params[6], "r6", 32, PARAM_OUT);	/* command set */
+	init_reg_param(&reg_params[7], "r7", 32, PARAM_OUT);
+	init_reg_param(&reg_params[8], "r8", 32, PARAM_OUT);
+	init_reg_param(&reg_params[9], "r9", 32, PARAM_OUT);
+	init_reg_param(&reg_params[10], "r10", 32, PARAM_OUT);
+	init_reg_param(&reg_params[11], "r11", 32, PARAM_OUT);
+
+	buf_set_u32(reg_params[0].value, 0, 32, source->address + (dcc ? 16 : 0));
+	buf_set_u32(reg_params[1].value, 0, 32, source->address + source_size);
+	buf_set_u32(reg_params[2].value, 0, 32, address);
+	buf_set_u32(reg_params[3].value, 0, 32, count / buffersize);
+	buf_set_u32(reg_params[4].value, 0, 32, bank->bus_width);
+	buf_set_u32(reg_params[5].value, 0, 32, bufferwsize);
+	buf_set_u32(reg_params[7].value, 0, 32, cfi_command_val(bank, bufferwsize - 1));
+
+	if (cfi_info->pri_id == 2) {
+		struct cfi_spansion_pri_ext *pri_ext = cfi_info->pri_ext;
+		uint32_t dq5_mask = 0;
+		if (cfi_info->status_poll_mask & (1 << 5))
+			dq5_mask = cfi_command_val(bank, 1 << 5);
+
+		buf_set_u32(reg_params[6].value, 0, 32, 1);
+		buf_set_u32(reg_params[8].value, 0, 32, flash_address(bank, 0, pri_ext->_unlock1));
+		buf_set_u32(reg_params[9].value, 0, 32, cfi_command_val(bank, 0x80));
+		buf_set_u32(reg_params[10].value, 0, 32, flash_address(bank, 0, pri_ext->_unlock2));
+		buf_set_u32(reg_params[11].value, 0, 32, dq5_mask);
+	} else {
+		buf_set_u32(reg_params[6].value, 0, 32, 0);
+		buf_set_u32(reg_params[8].value, 0, 32, cfi_command_val(bank, 0xd0));
+		buf_set_u32(reg_params[9].value, 0, 32, cfi_command_val(bank, 0x80));
+		buf_set_u32(reg_params[10].value, 0, 32, cfi_command_val(bank, 0x7e));
+		buf_set_u32(reg_params[11].value, 0, 32, cfi_command_val(bank, 0xe8));
+
+		cfi_intel_clear_status_register(bank);
+	}
+
+	LOG_DEBUG("Streaming 0x%" PRIx32 " bytes in 0x%" PRIx32 " byte buffers to 0x%08" PRIx32,
+		count, buffersize, address);
+
+	if (dcc) {
+		struct arm7_9_common *arm7_9 = target_to_arm7_9(target);
+		uint32_t stale;
+
+		dcc_algo.arm_algo.common_magic = ARM_COMMON_MAGIC;
+		dcc_algo.arm_algo.core_mode = ARM_MODE_SVC;
+		dcc_algo.arm_algo.core_state = ARM_STATE_ARM;
+		dcc_algo.bank = bank;
+		dcc_algo.buffer = buffer;
+		dcc_algo.blocks = count / buffersize;
+		dcc_algo.buffersize = buffersize;
+		dcc_algo.words = malloc(buffersize);
+		dcc_algo.retval = ERROR_OK;
+
+		/* purge pending data in DCC */
+		retval = embeddedice_receive(&arm7_9->jtag_info, &stale, 1);
+
+		if (!dcc_algo.words)
+			retval = ERROR_FAIL;
+		else if (retval == ERROR_OK)
+			retval = armv4_5_run_algorithm_inner(target, 0, NULL,
+					ARRAY_SIZE(reg_params), reg_params,
+					write_algorithm->address, write_algorithm->address + 4,
+					10000, &dcc_algo.arm_algo, cfi_dcc_completion);
+		if (retval == ERROR_OK)
+			retval = dcc_algo.retval;
+
+		free(dcc_algo.words);
+	} else {
+		armv7m_algo.common_magic = ARMV7M_COMMON_MAGIC;
+		armv7m_algo.core_mode = ARM_MODE_THREAD;
+
+		retval = target_run_flash_async_algorithm(target, buffer, count / buffersize, buffersize,
+				0, NULL,
+				ARRAY_SIZE(reg_params), reg_params,
+				source->address, source->size,
+				write_algorithm->address, 0,
+				&armv7m_algo);
+	}
+
+	if (retval == ERROR_FLASH_OPERATION_FAILED) {
+		LOG_ERROR("Buffer write at base " TARGET_ADDR_FMT ", address 0x%" PRIx32
+			" failed, status 0x%" PRIx32, bank->base,
+			buf_get_u32(reg_params[2].value, 0, 32),
+			buf_get_u32(reg_params[4].value, 0, 32));
+		if (cfi_info->pri_id != 2)
+			cfi_intel_clear_status_register(bank);
+		cfi_reset(bank);
+	}
+
+	target_free_working_area(target, source);
+	target_free_working_area(target, write_algorithm);
+
+	for (unsigned i = 0; i < ARRAY_SIZE(reg_params); i++)
+		destroy_reg_param(&reg_params[i]);
+
+	return retval;
+}
+
+/* Programs a block of bus_width aligned data with a target algorithm.
+ * Whole write buffers are streamed if the target supports it, the
+ * remaining head and tail use the per-buffer block write algorithms. */
+static int cfi_write_block(struct flash_bank *bank, const uint8_t *buffer,
+	uint32_t address, uint32_t count)
+{
+	struct cfi_flash_bank *cfi_info = bank->driver_priv;
+	uint32_t head = 0, body = 0, tail;
+	int retval;
+
+	if (cfi_info->buf_write_timeout_typ != 0
+			&& (cfi_info->pri_id == 1 || cfi_info->pri_id == 2 || cfi_info->pri_id == 3)) {
+		uint32_t buffersize =
+			(1UL << cfi_info->max_buf_write_size) * (bank->bus_width / bank->chip_width);
+		uint32_t buffermask = buffersize - 1;
+
+		head = (buffersize - (address & buffermask)) & buffermask;
+		if (head > count)
+			head = count;
+		body = (count - head) & ~buffermask;
+	}
+
+	if (body) {
+		retval = cfi_write_block_async(bank, buffer + head, address + head, body);
+		if (retval == ERROR_TARGET_RESOURCE_NOT_AVAILABLE)
+			body = 0;
+		else if (retval != ERROR_OK)
+			return retval;
+	}
+
+	if (body == 0) {
+		head = count;
+		tail = 0;
+	} else {
+		tail = count - head - body;
+	}
+
+	retval = ERROR_OK;
+	if (head) {
+		switch (cfi_info->pri_id) {
+			case 1:
+			case 3:
+				retval = cfi_intel_write_block(bank, buffer, address, head);
+				break;
+			case 2:
+				retval = cfi_spansion_write_block(bank, buffer, address, head);
+				break;
+			default:
+				LOG_ERROR("cfi primary command set %i unsupported", cfi_info->pri_id);
+				retval = ERROR_FLASH_OPERATION_FAILED;
+				break;
+		}
+	}
+
+	if (retval == ERROR_OK && tail) {
+		buffer += head + body;
+		address += head + body;
+		switch (cfi_info->pri_id) {
+			case 1:
+			case 3:
+				retval = cfi_intel_write_block(bank, buffer, address, tail);
+				break;
+			case 2:
+				retval = cfi_spansion_write_block(bank, buffer, address, tail);
+				break;
+		}
+	}
+
+	return retval;
+}
+
 static int cfi_intel_write_word(struct flash_bank *bank, uint8_t *word, uint32_t address)
 {
 	int retval;
@@ -2392,20 +2775,8 @@ static int cfi_write(struct flash_bank *bank, const uint8_t *buffer, uint32_t of
 
 	/* handle blocks of bus_size aligned bytes */
 	blk_count = count & ~(bank->bus_width - 1);	/* round down, leave tail bytes */
-	switch (cfi_info->pri_id) {
-		/* try block writes (fails without working area) */
-		case 1:
-		case 3:
-			retval = cfi_intel_write_block(bank, buffer, write_p, blk_count);
-			break;
-		case 2:
-			retval = cfi_spansion_write_block(bank, buffer, write_p, blk_count);
-			break;
-		default:
-			LOG_ERROR("cfi primary command set %i unsupported", cfi_info->pri_id);
-			retval = ERROR_FLASH_OPERATION_FAILED;
-			break;
-	}
+	/* try block writes (fails without working area) */
+	retval = cfi_write_block(bank, buffer, write_p, blk_count);
 	if (retval == ERROR_OK) {
 		/* Increment pointers and decrease count on succesful block write */
 		buffer += blk_count;
@@ -2664,7 +3035,22 @@ static int cfi_probe(struct flash_bank *bank)
 	/* query only if this is a CFI compatible flash,
 	 * otherwise the relevant info has already been filled in
 	 */
-	if (cfi_info->not_cfi == 0) {
+	if (cfi_info->not_cfi == 0 && cfi_info->query_cached
+			&& cfi_info->cached_manufacturer == cfi_info->manufacturer
+			&& cfi_info->cached_device_id == cfi_info->device_id) {
+		/* same device as on the last probe, skip the lengthy query */
+		LOG_DEBUG("using cached CFI query data");
+		cfi_info->num_erase_regions = cfi_info->cached_num_erase_regions;
+		if (cfi_info->num_erase_regions) {
+			size_t size = sizeof(*cfi_info->erase_region_info) * cfi_info->num_erase_regions;
+			cfi_info->erase_region_info = malloc(size);
+			if (cfi_info->erase_region_info == NULL) {
+				LOG_ERROR("Out of memory");
+				return ERROR_FAIL;
+			}
+			memcpy(cfi_info->erase_region_info, cfi_info->cached_erase_region_info, size);
+		}
+	} else if (cfi_info->not_cfi == 0) {
 		/* enter CFI query mode
 		 * according to JEDEC Standard No. 68.01,
 		 * a single bus sequence with address = 0x55, data = 0x98 should put
@@ -2813,6 +3199,21 @@ static int cfi_probe(struct flash_bank *bank)
 		retval = cfi_reset(bank);
 		if (retval != ERROR_OK)
 			return retval;
+
+		/* remember the query results, fixups below modify the erase regions */
+		free(cfi_info->cached_erase_region_info);
+		cfi_info->cached_erase_region_info = NULL;
+		if (cfi_info->num_erase_regions) {
+			size_t size = sizeof(*cfi_info->erase_region_info) * cfi_info->num_erase_regions;
+			cfi_info->cached_erase_region_info = malloc(size);
+			if (cfi_info->cached_erase_region_info)
+				memcpy(cfi_info->cached_erase_region_info, cfi_info->erase_region_info, size);
+		}
+		cfi_info->query_cached = cfi_info->num_erase_regions == 0
+			|| cfi_info->cached_erase_region_info != NULL;
+		cfi_info->cached_manufacturer = cfi_info->manufacturer;
+		cfi_info->cached_device_id = cfi_info->device_id;
+		cfi_info->cached_num_erase_regions = cfi_info->num_erase_regions;
 	}	/* end CFI case */
 
 	LOG_DEBUG("Vcc min: %x.%x, Vcc max: %x.%x, Vpp min: %u.%x, Vpp max: %u.%x",
@@ -3112,6 +3513,18 @@ static void cfi_fixup_0002_write_buffer(struct flash_bank *bank, const void *par
 	cfi_info->buf_write_timeout_typ = 0;
 }
 
+static void cfi_free_driver_priv(struct flash_bank *bank)
+{
+	struct cfi_flash_bank *cfi_info = bank->driver_priv;
+
+	if (cfi_info) {
+		free(cfi_info->erase_region_info);
+		free(cfi_info->cached_erase_region_info);
+		free(cfi_info->pri_ext);
+	}
+	default_flash_free_driver_priv(bank);
+}
+
 const struct flash_driver cfi_flash = {
 	.name = "cfi",
 	.flash_bank_command = cfi_flash_bank_command,
@@ -3125,5 +3538,5 @@ const struct flash_driver cfi_flash = {
 	.erase_check = default_flash_blank_check,
 	.protect_check = cfi_protect_check,
 	.info = get_cfi_info,
-	.free_driver_priv = default_flash_free_driver_priv,
+	.free_driver_priv = cfi_free_driver_priv,
 };
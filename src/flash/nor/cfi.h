@@ -73,6 +73,14 @@ struct cfi_flash_bank {
 	unsigned buf_write_timeout;
 	unsigned block_erase_timeout;
 	unsigned chip_erase_timeout;
+
+	/* query results of the last probe, reused when a re-probe
+	 * identifies the same device */
+	int query_cached;
+	uint16_t cached_manufacturer;
+	uint16_t cached_device_id;
+	uint8_t cached_num_erase_regions;
+	uint32_t *cached_erase_region_info;	/* before fixups */
 };
 
 /* Intel primary extended query table
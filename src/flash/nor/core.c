@@ -27,6 +27,7 @@
 #include <flash/nor/core.h>
 #include <flash/nor/imp.h>
 #include <target/image.h>
+#include <target/target_type.h>
 
 /**
  * @file
@@ -48,6 +49,48 @@ int flash_driver_erase(struct flash_bank *bank, int first, int last)
 	return retval;
 }
 
+int flash_driver_erase_start(struct flash_bank *bank, int first, int last)
+{
+	int retval;
+
+	if (bank->driver->erase_start == NULL)
+		return flash_driver_erase(bank, first, last);
+
+	retval = bank->driver->erase_start(bank, first, last);
+	if (retval != ERROR_OK)
+		LOG_ERROR("failed to start erasing sectors %d to %d", first, last);
+
+	return retval;
+}
+
+int flash_driver_erase_poll(struct flash_bank *bank)
+{
+	int retval;
+
+	if (bank->driver->erase_poll == NULL)
+		return ERROR_OK;
+
+	retval = bank->driver->erase_poll(bank);
+	if (retval != ERROR_OK)
+		LOG_ERROR("failed erasing sectors of bank %s", bank->name);
+
+	return retval;
+}
+
+int flash_driver_erase_wait(struct flash_bank *bank)
+{
+	int retval;
+
+	if (bank->driver->erase_wait == NULL)
+		return ERROR_OK;
+
+	retval = bank->driver->erase_wait(bank);
+	if (retval != ERROR_OK)
+		LOG_ERROR("failed erasing sectors of bank %s", bank->name);
+
+	return retval;
+}
+
 int flash_driver_protect(struct flash_bank *bank, int set, int first, int last)
 {
 	int retval;
@@ -133,6 +176,194 @@ int default_flash_read(struct flash_bank *bank,
 	return target_read_buffer(bank->target, offset + bank->base, count, buffer);
 }
 
+/* Address index of all flash banks, sorted by base address.  Rebuilt
+ * lazily after banks are added, freed or re-probed. */
+struct flash_bank_index_entry {
+	struct flash_bank *bank;
+	target_addr_t base;	/* bank->base when the index was built */
+	uint32_t size;		/* bank->size when the index was built */
+	/* highest last address of this and all preceding entries, allows
+	 * to stop the backward scan over overlapping banks early */
+	target_addr_t max_last_addr;
+};
+
+static struct flash_bank_index_entry *flash_bank_index;
+static int flash_bank_index_count;
+static bool flash_bank_index_valid;
+/* banks without a size yet, i.e. not probed, in order of definition;
+ * they are left out of the index */
+static struct flash_bank **flash_bank_unsized;
+static int flash_bank_unsized_count;
+
+void flash_bank_index_invalidate(void)
+{
+	flash_bank_index_valid = false;
+}
+
+/* Invalidates the index if a probe changed the geometry of the bank */
+static void flash_bank_index_update(struct flash_bank *bank,
+		target_addr_t old_base, uint32_t old_size)
+{
+	if (bank->base != old_base || bank->size != old_size)
+		flash_bank_index_invalidate();
+}
+
+int flash_bank_auto_probe(struct flash_bank *bank)
+{
+	target_addr_t base = bank->base;
+	uint32_t size = bank->size;
+
+	int retval = bank->driver->auto_probe(bank);
+	flash_bank_index_update(bank, base, size);
+	return retval;
+}
+
+int flash_bank_probe(struct flash_bank *bank)
+{
+	target_addr_t base = bank->base;
+	uint32_t size = bank->size;
+
+	int retval = bank->driver->probe(bank);
+	flash_bank_index_update(bank, base, size);
+	return retval;
+}
+
+static int flash_bank_index_compare(const void *a, const void *b)
+{
+	const struct flash_bank_index_entry *e1 = a;
+	const struct flash_bank_index_entry *e2 = b;
+
+	if (e1->base != e2->base)
+		return e1->base < e2->base ? -1 : 1;
+	return e1->bank->bank_number - e2->bank->bank_number;
+}
+
+static int flash_bank_index_build(void)
+{
+	struct flash_bank *c;
+	int count = 0, unsized = 0;
+
+	free(flash_bank_index);
+	flash_bank_index = NULL;
+	flash_bank_index_count = 0;
+	free(flash_bank_unsized);
+	flash_bank_unsized = NULL;
+	flash_bank_unsized_count = 0;
+
+	for (c = flash_banks; c; c = c->next) {
+		if (c->size == 0)
+			unsized++;
+		else
+			count++;
+	}
+
+	if (count) {
+		flash_bank_index = malloc(count * sizeof(*flash_bank_index));
+		if (flash_bank_index == NULL) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+	}
+	if (unsized) {
+		flash_bank_unsized = malloc(unsized * sizeof(*flash_bank_unsized));
+		if (flash_bank_unsized == NULL) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+	}
+
+	int i = 0;
+	for (c = flash_banks; c; c = c->next) {
+		if (c->size == 0) {
+			flash_bank_unsized[flash_bank_unsized_count++] = c;
+			continue;
+		}
+		flash_bank_index[i].bank = c;
+		flash_bank_index[i].base = c->base;
+		flash_bank_index[i].size = c->size;
+		i++;
+	}
+	qsort(flash_bank_index, count, sizeof(*flash_bank_index),
+			flash_bank_index_compare);
+
+	target_addr_t max_last_addr = 0;
+	for (i = 0; i < count; i++) {
+		target_addr_t last_addr = flash_bank_index[i].base + flash_bank_index[i].size - 1;
+		if (i == 0 || last_addr > max_last_addr)
+			max_last_addr = last_addr;
+		flash_bank_index[i].max_last_addr = max_last_addr;
+	}
+
+	flash_bank_index_count = count;
+	flash_bank_index_valid = true;
+	return ERROR_OK;
+}
+
+/* Looks up the bank of @a target containing @a addr in the address index.
+ * If more banks contain the address, the one defined first wins.
+ * Returns false if the index cannot answer reliably.  A miss only means the
+ * address is not in the index; in both cases the caller has to walk the
+ * bank list. */
+static bool flash_bank_index_lookup(struct target *target, target_addr_t addr,
+		struct flash_bank **result_bank)
+{
+	*result_bank = NULL;
+
+	if (!flash_bank_index_valid && flash_bank_index_build() != ERROR_OK)
+		return false;
+
+	/* find the last entry with base <= addr */
+	int lo = 0, hi = flash_bank_index_count;
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		if (flash_bank_index[mid].base <= addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	struct flash_bank_index_entry *found = NULL;
+	for (int i = lo - 1; i >= 0 && flash_bank_index[i].max_last_addr >= addr; i--) {
+		struct flash_bank_index_entry *e = &flash_bank_index[i];
+		if (e->bank->target != target || addr > e->base + (e->size - 1))
+			continue;
+		if (found == NULL || e->bank->bank_number < found->bank->bank_number)
+			found = e;
+	}
+
+	if (found) {
+		struct flash_bank *c = found->bank;
+		/* the bank was changed by a probe since the index was built */
+		if (c->base != found->base || c->size != found->size) {
+			flash_bank_index_invalidate();
+			return false;
+		}
+	}
+
+	/* An unsized bank of this target defined before the match may turn
+	 * out to contain the address once it is probed, and would then win.
+	 * Probing a bank which stays empty leaves the index alone. */
+	for (int i = 0; i < flash_bank_unsized_count; i++) {
+		struct flash_bank *u = flash_bank_unsized[i];
+		if (found && u->bank_number > found->bank->bank_number)
+			break;
+		if (u->target != target)
+			continue;
+		if (flash_bank_auto_probe(u) != ERROR_OK)
+			return false;
+		if (u->size != 0) {
+			/* probed since the index was built */
+			flash_bank_index_invalidate();
+			return false;
+		}
+	}
+
+	if (found)
+		*result_bank = found->bank;
+
+	return true;
+}
+
 void flash_bank_add(struct flash_bank *bank)
 {
 	/* put flash bank in linked list */
@@ -150,6 +381,7 @@ void flash_bank_add(struct flash_bank *bank)
 		flash_banks = bank;
 
 	bank->bank_number = bank_num;
+	flash_bank_index_invalidate();
 }
 
 struct flash_bank *flash_bank_list(void)
@@ -210,6 +442,14 @@ void flash_free_all_banks(void)
 		bank = next;
 	}
 	flash_banks = NULL;
+
+	free(flash_bank_index);
+	flash_bank_index = NULL;
+	flash_bank_index_count = 0;
+	free(flash_bank_unsized);
+	flash_bank_unsized = NULL;
+	flash_bank_unsized_count = 0;
+	flash_bank_index_invalidate();
 }
 
 struct flash_bank *get_flash_bank_by_name_noprobe(const char *name)
@@ -237,7 +477,7 @@ int get_flash_bank_by_name(const char *name, struct flash_bank **bank_result)
 
 	bank = get_flash_bank_by_name_noprobe(name);
 	if (bank != NULL) {
-		retval = bank->driver->auto_probe(bank);
+		retval = flash_bank_auto_probe(bank);
 
 		if (retval != ERROR_OK) {
 			LOG_ERROR("auto_probe failed");
@@ -257,7 +497,7 @@ int get_flash_bank_by_num(int num, struct flash_bank **bank)
 	if (p == NULL)
 		return ERROR_FAIL;
 
-	retval = p->driver->auto_probe(p);
+	retval = flash_bank_auto_probe(p);
 
 	if (retval != ERROR_OK) {
 		LOG_ERROR("auto_probe failed");
@@ -275,14 +515,28 @@ int get_flash_bank_by_addr(struct target *target,
 	struct flash_bank **result_bank)
 {
 	struct flash_bank *c;
+	int retval;
 
-	/* cycle through bank list */
+	if (flash_bank_index_lookup(target, addr, &c) && c != NULL) {
+		retval = flash_bank_auto_probe(c);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("auto_probe failed");
+			return retval;
+		}
+		/* auto_probe may have changed the bank geometry */
+		if ((addr >= c->base) && (addr <= c->base + (c->size - 1))) {
+			*result_bank = c;
+			return ERROR_OK;
+		}
+	}
+
+	/* a bank probed behind the index's back may still cover the
+	 * address, so a miss is not definitive: cycle through bank list */
 	for (c = flash_banks; c; c = c->next) {
 		if (c->target != target)
 			continue;
 
-		int retval;
-		retval = c->driver->auto_probe(c);
+		retval = flash_bank_auto_probe(c);
 
 		if (retval != ERROR_OK) {
 			LOG_ERROR("auto_probe failed");
@@ -294,6 +548,7 @@ int get_flash_bank_by_addr(struct target *target,
 			return ERROR_OK;
 		}
 	}
+
 	*result_bank = NULL;
 	if (check) {
 		LOG_ERROR("No flash at address " TARGET_ADDR_FMT, addr);
@@ -302,12 +557,15 @@ int get_flash_bank_by_addr(struct target *target,
 	return ERROR_OK;
 }
 
+/* Largest chunk read by the slow blank check fallback in one call.
+ * The target/adapter layer splits and queues it as needed, so keep it
+ * large enough that a sector is typically checked in a single request. */
+#define FLASH_MEM_BLANK_CHECK_CHUNK	(64 * 1024)
+
 static int default_flash_mem_blank_check(struct flash_bank *bank)
 {
 	struct target *target = bank->target;
-	const int buffer_size = 1024;
-	int i;
-	uint32_t nBytes;
+	uint32_t buffer_size = FLASH_MEM_BLANK_CHECK_CHUNK;
 	int retval = ERROR_OK;
 
 	if (bank->target->state != TARGET_HALTED) {
@@ -315,29 +573,48 @@ static int default_flash_mem_blank_check(struct flash_bank *bank)
 		return ERROR_TARGET_NOT_HALTED;
 	}
 
-	uint8_t *buffer = malloc(buffer_size);
+	/* no need for a buffer larger than the largest sector */
+	uint32_t max_sector_size = 0;
+	for (int i = 0; i < bank->num_sectors; i++) {
+		if (bank->sectors[i].size > max_sector_size)
+			max_sector_size = bank->sectors[i].size;
+	}
+	if (buffer_size > max_sector_size)
+		buffer_size = (max_sector_size + 3) & ~3u;
+	if (buffer_size == 0)
+		return ERROR_OK;
+
+	/* allocate as words so the comparison below can run word-wide */
+	uint32_t *buffer = malloc(buffer_size);
+	if (buffer == NULL) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	const uint32_t erased_word = bank->erased_value * 0x01010101u;
 
-	for (i = 0; i < bank->num_sectors; i++) {
-		uint32_t j;
-		bank->sectors[i].is_erased = 1;
+	for (int i = 0; i < bank->num_sectors; i++) {
+		struct flash_sector *sector = &bank->sectors[i];
+		sector->is_erased = 1;
 
-		for (j = 0; j < bank->sectors[i].size; j += buffer_size) {
-			uint32_t chunk;
-			chunk = buffer_size;
-			if (chunk > (bank->sectors[i].size - j))
-				chunk = (bank->sectors[i].size - j);
+		for (uint32_t j = 0; j < sector->size && sector->is_erased == 1; j += buffer_size) {
+			uint32_t chunk = buffer_size;
+			if (chunk > (sector->size - j))
+				chunk = sector->size - j;
 
 			retval = target_read_memory(target,
-					bank->base + bank->sectors[i].offset + j,
+					bank->base + sector->offset + j,
 					4,
-					chunk/4,
-					buffer);
+					chunk / 4,
+					(uint8_t *)buffer);
 			if (retval != ERROR_OK)
 				goto done;
 
-			for (nBytes = 0; nBytes < chunk; nBytes++) {
-				if (buffer[nBytes] != bank->erased_value) {
-					bank->sectors[i].is_erased = 0;
+			uint32_t nwords = chunk / 4;
+			for (uint32_t w = 0; w < nwords; w++) {
+				if (buffer[w] != erased_word) {
+					/* stop at the first programmed word of the sector */
+					sector->is_erased = 0;
 					break;
 				}
 			}
@@ -350,6 +627,55 @@ done:
 	return retval;
 }
 
+/* Blank check by comparing an on-target checksum of each sector against
+ * the CRC of an all-erased buffer computed on the host.  Used for targets
+ * which provide a checksum algorithm but no blank check algorithm.
+ * The target's checksum_memory handler is called directly: the host side
+ * fallback of target_checksum_memory() would read the whole sector,
+ * which is slower than default_flash_mem_blank_check(). */
+static int default_flash_crc_blank_check(struct flash_bank *bank)
+{
+	struct target *target = bank->target;
+	uint8_t *erased = NULL;
+	uint32_t erased_size = 0;
+	uint32_t erased_crc = 0;
+	int retval = ERROR_OK;
+
+	if (target->type->checksum_memory == NULL)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	for (int i = 0; i < bank->num_sectors; i++) {
+		struct flash_sector *sector = &bank->sectors[i];
+
+		/* sectors usually share a few sizes, recompute the reference
+		 * CRC only when the size changes */
+		if (sector->size != erased_size) {
+			free(erased);
+			erased = malloc(sector->size);
+			if (erased == NULL) {
+				LOG_ERROR("Out of memory");
+				return ERROR_FAIL;
+			}
+			memset(erased, bank->erased_value, sector->size);
+			retval = image_calculate_checksum(erased, sector->size, &erased_crc);
+			if (retval != ERROR_OK)
+				break;
+			erased_size = sector->size;
+		}
+
+		uint32_t crc;
+		retval = target->type->checksum_memory(target,
+				bank->base + sector->offset, sector->size, &crc);
+		if (retval != ERROR_OK)
+			break;
+
+		sector->is_erased = (crc == erased_crc);
+	}
+
+	free(erased);
+	return retval;
+}
+
 int default_flash_blank_check(struct flash_bank *bank)
 {
 	struct target *target = bank->target;
@@ -392,8 +718,11 @@ int default_flash_blank_check(struct flash_bank *bank)
 			bank->sectors[i].is_erased = block_array[i].result;
 		retval = ERROR_OK;
 	} else {
-		LOG_USER("Running slow fallback erase check - add working memory");
-		retval = default_flash_mem_blank_check(bank);
+		retval = default_flash_crc_blank_check(bank);
+		if (retval != ERROR_OK) {
+			LOG_USER("Running slow fallback erase check - add working memory");
+			retval = default_flash_mem_blank_check(bank);
+		}
 	}
 	free(block_array);
 
@@ -466,50 +795,46 @@ static int flash_iterate_address_range_inner(struct target *target,
 		num_blocks = c->num_sectors;
 	}
 
-	for (i = 0; i < num_blocks; i++) {
-		struct flash_sector *f = &block_array[i];
-		target_addr_t sector_addr = c->base + f->offset;
-		target_addr_t sector_last_addr = sector_addr + f->size - 1;
+	/* find the first block, start only on a block boundary */
+	i = flash_find_block(block_array, num_blocks, addr - c->base);
+	if (i < num_blocks) {
+		target_addr_t sector_addr = c->base + block_array[i].offset;
 
-		/* start only on a sector boundary */
-		if (first < 0) {
-			/* scanned past the first sector? */
-			if (addr < sector_addr)
-				break;
-
-			/* is this the first sector? */
-			if (addr == sector_addr)
-				first = i;
+		if (addr == sector_addr)
+			first = i;
 
-			/* Does this need head-padding?  If so, pad and warn;
-			 * or else force an error.
-			 *
-			 * Such padding can make trouble, since *WE* can't
-			 * ever know if that data was in use.  The warning
-			 * should help users sort out messes later.
-			 */
-			else if (addr <= sector_last_addr && pad_reason) {
-				/* FIXME say how many bytes (e.g. 80 KB) */
-				LOG_WARNING("Adding extra %s range, "
-					TARGET_ADDR_FMT " .. " TARGET_ADDR_FMT,
-					pad_reason,
-					sector_addr,
-					addr - 1);
-				first = i;
-			} else
-				continue;
+		/* Does this need head-padding?  If so, pad and warn;
+		 * or else force an error.
+		 *
+		 * Such padding can make trouble, since *WE* can't
+		 * ever know if that data was in use.  The warning
+		 * should help users sort out messes later.
+		 */
+		else if (addr > sector_addr && pad_reason) {
+			/* FIXME say how many bytes (e.g. 80 KB) */
+			LOG_WARNING("Adding extra %s range, "
+				TARGET_ADDR_FMT " .. " TARGET_ADDR_FMT,
+				pad_reason,
+				sector_addr,
+				addr - 1);
+			first = i;
 		}
+	}
+
+	/* find the last block, MUST finish on a block boundary */
+	i = flash_find_block(block_array, num_blocks, last_addr - c->base);
+	if (first >= 0 && i < num_blocks) {
+		struct flash_sector *f = &block_array[i];
+		target_addr_t sector_addr = c->base + f->offset;
+		target_addr_t sector_last_addr = sector_addr + f->size - 1;
 
-		/* is this (also?) the last sector? */
-		if (last_addr == sector_last_addr) {
+		if (last_addr == sector_last_addr)
 			last = i;
-			break;
-		}
 
 		/* Does this need tail-padding?  If so, pad and warn;
 		 * or else force an error.
 		 */
-		if (last_addr < sector_last_addr && pad_reason) {
+		else if (pad_reason) {
 			/* FIXME say how many bytes (e.g. 80 KB) */
 			LOG_WARNING("Adding extra %s range, "
 				TARGET_ADDR_FMT " .. " TARGET_ADDR_FMT,
@@ -517,12 +842,7 @@ static int flash_iterate_address_range_inner(struct target *target,
 				last_addr + 1,
 				sector_last_addr);
 			last = i;
-			break;
 		}
-
-		/* MUST finish on a sector boundary */
-		if (last_addr < sector_addr)
-			break;
 	}
 
 	/* invalid start or end address? */
@@ -585,6 +905,15 @@ int flash_erase_address_range(struct target *target,
 		addr, length, false, &flash_driver_erase);
 }
 
+/* Starts erasing the range, flash_driver_erase_wait() must be called
+ * before the bank is accessed again. */
+static int flash_erase_address_range_start(struct target *target,
+	target_addr_t addr, uint32_t length)
+{
+	return flash_iterate_address_range(target, "erase",
+		addr, length, false, &flash_driver_erase_start);
+}
+
 static int flash_driver_unprotect(struct flash_bank *bank, int first, int last)
 {
 	return flash_driver_protect(bank, 0, first, last);
@@ -627,13 +956,12 @@ target_addr_t flash_write_align_start(struct flash_bank *bank, target_addr_t add
 	if (bank->write_start_alignment == FLASH_WRITE_ALIGN_SECTOR) {
 		uint32_t offset = addr - bank->base;
 		uint32_t aligned = 0;
-		int sect;
-		for (sect = 0; sect < bank->num_sectors; sect++) {
-			if (bank->sectors[sect].offset > offset)
-				break;
-
+		/* start of the sector containing offset or of the preceding one */
+		int sect = flash_find_block(bank->sectors, bank->num_sectors, offset);
+		if (sect < bank->num_sectors && bank->sectors[sect].offset <= offset)
 			aligned = bank->sectors[sect].offset;
-		}
+		else if (sect > 0)
+			aligned = bank->sectors[sect - 1].offset;
 		return bank->base + aligned;
 	}
 
@@ -652,12 +980,12 @@ target_addr_t flash_write_align_end(struct flash_bank *bank, target_addr_t addr)
 	if (bank->write_end_alignment == FLASH_WRITE_ALIGN_SECTOR) {
 		uint32_t offset = addr - bank->base;
 		uint32_t aligned = 0;
-		int sect;
-		for (sect = 0; sect < bank->num_sectors; sect++) {
+		/* end of the sector containing offset or of the following one */
+		int sect = flash_find_block(bank->sectors, bank->num_sectors, offset);
+		if (sect >= bank->num_sectors)
+			sect = bank->num_sectors - 1;
+		if (sect >= 0)
 			aligned = bank->sectors[sect].offset + bank->sectors[sect].size - 1;
-			if (aligned >= offset)
-				break;
-		}
 		return bank->base + aligned;
 	}
 
@@ -676,13 +1004,11 @@ static bool flash_write_check_gap(struct flash_bank *bank,
 		return false;
 
 	if (bank->minimal_write_gap == FLASH_WRITE_GAP_SECTOR) {
-		int sect;
 		uint32_t offset1 = addr1 - bank->base;
 		/* find the sector following the one containing addr1 */
-		for (sect = 0; sect < bank->num_sectors; sect++) {
-			if (bank->sectors[sect].offset > offset1)
-				break;
-		}
+		int sect = flash_find_block(bank->sectors, bank->num_sectors, offset1);
+		if (sect < bank->num_sectors && bank->sectors[sect].offset <= offset1)
+			sect++;
 		if (sect >= bank->num_sectors)
 			return false;
 
@@ -696,10 +1022,104 @@ static bool flash_write_check_gap(struct flash_bank *bank,
 }
 
 
+/* A contiguous block of an image ready to be programmed into one bank */
+struct flash_write_run {
+	struct flash_bank *bank;
+	target_addr_t address;
+	uint32_t size;
+	uint8_t *buffer;
+	/* erase was started by flash_driver_erase_start() and is possibly
+	 * still in progress */
+	bool erase_pending;
+};
+
+/* Programs the run one sector at a time, keeping the erase of
+ * @a erasing, which is in another bank, going in between */
+static int flash_write_run_sectors(struct flash_write_run *run,
+		struct flash_write_run *erasing)
+{
+	struct flash_bank *bank = run->bank;
+	uint32_t offset = run->address - bank->base;
+	uint32_t done = 0;
+
+	while (done < run->size) {
+		uint32_t count = run->size - done;
+		int sect = flash_find_block(bank->sectors, bank->num_sectors, offset + done);
+		if (sect < bank->num_sectors && bank->sectors[sect].offset <= offset + done)
+			count = MIN(count, bank->sectors[sect].offset
+					+ bank->sectors[sect].size - (offset + done));
+
+		int retval = flash_driver_write(bank, run->buffer + done, offset + done, count);
+		if (retval != ERROR_OK)
+			return retval;
+		done += count;
+
+		retval = flash_driver_erase_poll(erasing->bank);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	return ERROR_OK;
+}
+
+/* Completes a pending erase of the run, programs it and releases it.
+ * @a erasing is a run in another bank whose erase is in progress, or NULL. */
+static int flash_write_run_finish(struct flash_write_run *run, uint32_t *written,
+		struct flash_write_run *erasing)
+{
+	int retval = ERROR_OK;
+
+	if (run->erase_pending) {
+		retval = flash_driver_erase_wait(run->bank);
+		run->erase_pending = false;
+	}
+
+	if (retval == ERROR_OK) {
+		/* write flash sectors */
+		if (erasing != NULL && erasing->erase_pending
+				&& erasing->bank->driver->erase_poll != NULL
+				&& run->bank->num_sectors > 0)
+			retval = flash_write_run_sectors(run, erasing);
+		else
+			retval = flash_driver_write(run->bank, run->buffer,
+					run->address - run->bank->base, run->size);
+	}
+
+	if (retval == ERROR_OK && written != NULL)
+		*written += run->size;	/* add run size to total written counter */
+
+	free(run->buffer);
+	run->buffer = NULL;
+	run->bank = NULL;
+
+	return retval;
+}
+
+/* Releases the run after an error, leaves no erase running */
+static void flash_write_run_abort(struct flash_write_run *run)
+{
+	if (run->erase_pending)
+		flash_driver_erase_wait(run->bank);
+	run->erase_pending = false;
+
+	free(run->buffer);
+	run->buffer = NULL;
+	run->bank = NULL;
+}
+
+/*
+ * The image is programmed run by run, a run being the part of the image
+ * which falls into one bank.  Runs are pipelined: the erase of a run is
+ * started before the previous run is programmed.  If the runs are in
+ * different banks and the driver of the later one can erase without
+ * blocking (flash_driver::erase_start), erasing one bank overlaps with
+ * programming the other.  At most two runs are buffered at any time.
+ */
 int flash_write_unlock(struct target *target, struct image *image,
 	uint32_t *written, int erase, bool unlock)
 {
 	int retval = ERROR_OK;
+	struct flash_write_run pending = { .bank = NULL };
 
 	int section;
 	uint32_t section_offset;
@@ -847,17 +1267,15 @@ int flash_write_unlock(struct target *target, struct image *image,
 			/* If we're applying any sector automagic, then pad this
 			 * (maybe-combined) segment to the end of its last sector.
 			 */
-			int sector;
 			uint32_t offset_start = run_address - c->base;
 			uint32_t offset_end = offset_start + run_size;
 			uint32_t end = offset_end, delta;
 
-			for (sector = 0; sector < c->num_sectors; sector++) {
-				end = c->sectors[sector].offset
-					+ c->sectors[sector].size;
-				if (offset_end <= end)
-					break;
-			}
+			int sector = flash_find_block(c->sectors, c->num_sectors, offset_end - 1);
+			if (sector >= c->num_sectors)
+				sector = c->num_sectors - 1;
+			if (sector >= 0)
+				end = c->sectors[sector].offset + c->sectors[sector].size;
 
 			delta = end - offset_end;
 			padding[section_last] += delta;
@@ -919,6 +1337,26 @@ int flash_write_unlock(struct target *target, struct image *image,
 			}
 		}
 
+		struct flash_write_run run = {
+			.bank = c,
+			.address = run_address,
+			.size = run_size,
+			.buffer = buffer,
+		};
+
+		/* Erasing this run can overlap with programming the pending one
+		 * only if they live in different banks. Otherwise finish the
+		 * pending run first to keep the original order of operations. */
+		bool overlap = erase && pending.bank != NULL && pending.bank != c
+				&& c->driver->erase_start != NULL;
+		if (pending.bank != NULL && !overlap) {
+			retval = flash_write_run_finish(&pending, written, NULL);
+			if (retval != ERROR_OK) {
+				free(buffer);
+				goto done;
+			}
+		}
+
 		retval = ERROR_OK;
 
 		if (unlock)
@@ -926,28 +1364,41 @@ int flash_write_unlock(struct target *target, struct image *image,
 		if (retval == ERROR_OK) {
 			if (erase) {
 				/* calculate and erase sectors */
-				retval = flash_erase_address_range(target,
-						true, run_address, run_size);
+				if (c->driver->erase_start != NULL) {
+					retval = flash_erase_address_range_start(target,
+							run_address, run_size);
+					run.erase_pending = (retval == ERROR_OK);
+				} else {
+					retval = flash_erase_address_range(target,
+							true, run_address, run_size);
+				}
 			}
 		}
 
-		if (retval == ERROR_OK) {
-			/* write flash sectors */
-			retval = flash_driver_write(c, buffer, run_address - c->base, run_size);
-		}
-
-		free(buffer);
-
 		if (retval != ERROR_OK) {
 			/* abort operation */
+			free(buffer);
 			goto done;
 		}
 
-		if (written != NULL)
-			*written += run_size;	/* add run size to total written counter */
+		/* program the previous run while this one is being erased */
+		if (pending.bank != NULL) {
+			retval = flash_write_run_finish(&pending, written, &run);
+			if (retval != ERROR_OK) {
+				flash_write_run_abort(&run);
+				goto done;
+			}
+		}
+
+		pending = run;
 	}
 
+	if (pending.bank != NULL)
+		retval = flash_write_run_finish(&pending, written, NULL);
+
 done:
+	if (pending.bank != NULL)
+		flash_write_run_abort(&pending);
 	free(sections);
 	free(padding);
 
@@ -960,6 +1411,21 @@ int flash_write(struct target *target, struct image *image,
 	return flash_write_unlock(target, image, written, erase, false);
 }
 
+int flash_find_block(const struct flash_sector *blocks, int num_blocks, uint32_t offset)
+{
+	int lo = 0, hi = num_blocks;
+
+	/* lower bound on the last offset of a block */
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		if (blocks[mid].offset + (blocks[mid].size - 1) < offset)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
 struct flash_sector *alloc_block_array(uint32_t offset, uint32_t size, int num_blocks)
 {
 	int i;
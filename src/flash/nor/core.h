@@ -125,7 +125,8 @@ struct flash_bank {
 	 * some non-zero value during "probe()" or "auto_probe()".
 	 */
 	int num_sectors;
-	/** Array of sectors, allocated and initialized by the flash driver */
+	/** Array of sectors, allocated and initialized by the flash driver.
+	 * Sectors must be sorted by ascending offset. */
 	struct flash_sector *sectors;
 
 	/**
@@ -276,5 +277,16 @@ int get_flash_bank_by_addr(struct target *target, target_addr_t addr, bool check
  * @returns A struct flash_sector pointer or NULL when allocation failed.
  */
 struct flash_sector *alloc_block_array(uint32_t offset, uint32_t size, int num_blocks);
+/**
+ * Binary search in an array of sectors or protection blocks.
+ * The array must be sorted by ascending offset and blocks must not overlap.
+ * @param blocks Array of blocks.
+ * @param num_blocks Number of blocks in array.
+ * @param offset Offset from start of the bank.
+ * @returns Index of the first block which ends at or after @a offset,
+ * that is the block containing @a offset or the next one if @a offset
+ * falls into a gap; @a num_blocks if all blocks end before @a offset.
+ */
+int flash_find_block(const struct flash_sector *blocks, int num_blocks, uint32_t offset);
 
 #endif /* OPENOCD_FLASH_NOR_CORE_H */
@@ -106,6 +106,41 @@ struct flash_driver {
 	 */
 	int (*erase)(struct flash_bank *bank, int first, int last);
 
+	/**
+	 * Optional non-blocking variant of flash_driver_s::erase.  Starts
+	 * erasing the specified sectors and returns without waiting for
+	 * completion, so the flash core can program another bank meanwhile.
+	 * The core calls flash_driver_s::erase_wait before it accesses
+	 * the bank again.
+	 *
+	 * Set both erase_start and erase_wait or none of them.
+	 *
+	 * @param bank The bank of flash to be erased.
+	 * @param first The number of the first sector to erase.
+	 * @param last The number of the last sector to erase.
+	 * @returns ERROR_OK if the erase was started; otherwise, an error code.
+	 */
+	int (*erase_start)(struct flash_bank *bank, int first, int last);
+
+	/**
+	 * Optional. Checks on an erase started by flash_driver_s::erase_start
+	 * without waiting.  Drivers which erase one sector at a time start
+	 * the next sector here once the previous one is done.  The core
+	 * calls it between the parts of a write to another bank.
+	 *
+	 * @param bank The bank of flash being erased.
+	 * @returns ERROR_OK unless the erase failed.
+	 */
+	int (*erase_poll)(struct flash_bank *bank);
+
+	/**
+	 * Completes an erase started by flash_driver_s::erase_start.
+	 *
+	 * @param bank The bank of flash being erased.
+	 * @returns ERROR_OK if successful; otherwise, an error code.
+	 */
+	int (*erase_wait)(struct flash_bank *bank);
+
 	/**
 	 * Bank/sector protection routine (target-specific).
 	 *
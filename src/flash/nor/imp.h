@@ -30,12 +30,31 @@
  */
 void flash_bank_add(struct flash_bank *bank);
 
+/**
+ * Marks the address index of flash banks stale.  Must be called when
+ * the base address or size of a bank may have changed, e.g. by a probe.
+ */
+void flash_bank_index_invalidate(void);
+/** Calls the driver's auto_probe, keeping the address index up to date */
+int flash_bank_auto_probe(struct flash_bank *bank);
+/** Calls the driver's probe, keeping the address index up to date */
+int flash_bank_probe(struct flash_bank *bank);
+
 /**
  * @return The first bank in the global list.
  */
 struct flash_bank *flash_bank_list(void);
 
 int flash_driver_erase(struct flash_bank *bank, int first, int last);
+/**
+ * Starts erasing sectors using flash_driver::erase_start if the driver
+ * provides it, otherwise erases them synchronously.
+ */
+int flash_driver_erase_start(struct flash_bank *bank, int first, int last);
+/** Continues an erase started by flash_driver_erase_start() without waiting */
+int flash_driver_erase_poll(struct flash_bank *bank);
+/** Waits for an erase started by flash_driver_erase_start() */
+int flash_driver_erase_wait(struct flash_bank *bank);
 int flash_driver_protect(struct flash_bank *bank, int set, int first, int last);
 int flash_driver_write(struct flash_bank *bank,
 		uint8_t *buffer, uint32_t offset, uint32_t count);
@@ -26,12 +26,25 @@
 
 #define JTAGSPI_MAX_TIMEOUT 3000
 
+/* pages queued per JTAG flush in pipelined write mode */
+#define JTAGSPI_PIPELINE_PAGES 16
+/* initial page program time estimate for pipelined writes, raised whenever
+ * the queued status poll still finds the flash busy */
+#define JTAGSPI_PP_DELAY_US 400
+#define JTAGSPI_PP_DELAY_MAX_US 10000
+
 
 struct jtagspi_flash_bank {
 	struct jtag_tap *tap;
 	const struct flash_device *dev;
 	int probed;
 	uint32_t ir;
+	int addr_len;
+	uint8_t read_cmd;
+	uint8_t pprog_cmd;
+	uint8_t erase_cmd;
+	bool pipeline;
+	uint32_t pp_delay_us;
 };
 
 FLASH_BANK_COMMAND_HANDLER(jtagspi_flash_bank_command)
@@ -50,6 +63,9 @@ FLASH_BANK_COMMAND_HANDLER(jtagspi_flash_bank_command)
 
 	info->tap = NULL;
 	info->probed = 0;
+	info->addr_len = 3;
+	info->pipeline = true;
+	info->pp_delay_us = JTAGSPI_PP_DELAY_US;
 	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[6], info->ir);
 
 	return ERROR_OK;
@@ -75,15 +91,20 @@ static void flip_u8(uint8_t *in, uint8_t *out, int len)
 		out[i] = flip_u32(in[i], 8);
 }
 
-static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
-		uint32_t *addr, uint8_t *data, int len)
+/* Queue one SPI transaction without flushing the JTAG queue. Outgoing data is
+ * copied into the queue right away. Read data is captured bit-reversed into
+ * @a data, which must stay valid until the queue has been executed and then
+ * be passed through flip_u8(). @a dummy clock cycles are inserted between the
+ * address and the data phase. */
+static int jtagspi_queue_cmd(struct flash_bank *bank, uint8_t cmd,
+		uint32_t *addr, int dummy, uint8_t *data, int len)
 {
 	struct jtagspi_flash_bank *info = bank->driver_priv;
 	struct scan_field fields[6];
 	uint8_t marker = 1;
 	uint8_t xfer_bits_buf[4];
-	uint8_t addr_buf[3];
-	uint8_t *data_buf;
+	uint8_t addr_buf[4];
+	uint8_t *data_buf = NULL;
 	uint32_t xfer_bits;
 	int is_read, lenb, n;
 
@@ -100,10 +121,10 @@ static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
 	fields[n].in_value = NULL;
 	n++;
 
-	xfer_bits = 8 + len - 1;
+	xfer_bits = 8 + dummy + len - 1;
 	/* cmd + read/write - 1 due to the counter implementation */
 	if (addr)
-		xfer_bits += 24;
+		xfer_bits += 8 * info->addr_len;
 	h_u32_to_be(xfer_bits_buf, xfer_bits);
 	flip_u8(xfer_bits_buf, xfer_bits_buf, 4);
 	fields[n].num_bits = 32;
@@ -118,30 +139,34 @@ static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
 	n++;
 
 	if (addr) {
-		h_u24_to_be(addr_buf, *addr);
-		flip_u8(addr_buf, addr_buf, 3);
-		fields[n].num_bits = 24;
+		if (info->addr_len == 4)
+			h_u32_to_be(addr_buf, *addr);
+		else
+			h_u24_to_be(addr_buf, *addr);
+		flip_u8(addr_buf, addr_buf, info->addr_len);
+		fields[n].num_bits = 8 * info->addr_len;
 		fields[n].out_value = addr_buf;
 		fields[n].in_value = NULL;
 		n++;
 	}
 
 	lenb = DIV_ROUND_UP(len, 8);
-	data_buf = malloc(lenb);
 	if (lenb > 0) {
-		if (data_buf == NULL) {
-			LOG_ERROR("no memory for spi buffer");
-			return ERROR_FAIL;
-		}
 		if (is_read) {
-			fields[n].num_bits = jtag_tap_count_enabled();
+			/* skip the dummy cycles and the bypassed taps */
+			fields[n].num_bits = dummy + jtag_tap_count_enabled();
 			fields[n].out_value = NULL;
 			fields[n].in_value = NULL;
 			n++;
 
 			fields[n].out_value = NULL;
-			fields[n].in_value = data_buf;
+			fields[n].in_value = data;
 		} else {
+			data_buf = malloc(lenb);
+			if (data_buf == NULL) {
+				LOG_ERROR("no memory for spi buffer");
+				return ERROR_FAIL;
+			}
 			flip_u8(data, data_buf, lenb);
 			fields[n].out_value = data_buf;
 			fields[n].in_value = NULL;
@@ -153,14 +178,54 @@ static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
 	jtagspi_set_ir(bank);
 	/* passing from an IR scan to SHIFT-DR clears BYPASS registers */
 	jtag_add_dr_scan(info->tap, n, fields, TAP_IDLE);
-	jtag_execute_queue();
 
-	if (is_read)
-		flip_u8(data_buf, data, lenb);
 	free(data_buf);
 	return ERROR_OK;
 }
 
+static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
+		uint32_t *addr, uint8_t *data, int len)
+{
+	int retval;
+
+	retval = jtagspi_queue_cmd(bank, cmd, addr, 0, data, len);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = jtag_execute_queue();
+	if (retval == ERROR_OK && len < 0)
+		flip_u8(data, data, DIV_ROUND_UP(-len, 8));
+	return retval;
+}
+
+/* map a command taking a 3-byte address to its 4-byte address variant */
+static uint8_t jtagspi_4byte_cmd(uint8_t cmd)
+{
+	switch (cmd) {
+	case SPIFLASH_READ:
+		return SPIFLASH_READ_4B;
+	case SPIFLASH_FAST_READ:
+		return SPIFLASH_FAST_READ_4B;
+	case SPIFLASH_PAGE_PROGRAM:
+		return SPIFLASH_PAGE_PROGRAM_4B;
+	case 0x20: /* 4 kB sector erase */
+		return 0x21;
+	case 0x52: /* 32 kB block erase */
+		return 0x5c;
+	case 0xd8: /* 64 kB block erase */
+		return 0xdc;
+	case SPIFLASH_READ_4B:
+	case SPIFLASH_FAST_READ_4B:
+	case SPIFLASH_PAGE_PROGRAM_4B:
+	case 0x21:
+	case 0x5c:
+	case 0xdc:
+		return cmd;
+	default:
+		return 0x00;
+	}
+}
+
 static int jtagspi_probe(struct flash_bank *bank)
 {
 	struct jtagspi_flash_bank *info = bank->driver_priv;
@@ -178,7 +243,8 @@ static int jtagspi_probe(struct flash_bank *bank)
 	}
 	info->tap = bank->target->tap;
 
-	jtagspi_cmd(bank, SPIFLASH_READ_ID, NULL, in_buf, -24);
+	if (jtagspi_cmd(bank, SPIFLASH_READ_ID, NULL, in_buf, -24) != ERROR_OK)
+		return ERROR_FAIL;
 	/* the table in spi.c has the manufacturer byte (first) as the lsb */
 	id = le_to_h_u24(in_buf);
 
@@ -201,8 +267,26 @@ static int jtagspi_probe(struct flash_bank *bank)
 	bank->size = info->dev->size_in_bytes;
 	if (bank->size <= (1UL << 16))
 		LOG_WARNING("device needs 2-byte addresses - not implemented");
-	if (bank->size > (1UL << 24))
-		LOG_WARNING("device needs paging or 4-byte addresses - not implemented");
+
+	/* fast read runs at full SPI clock; devices above 16 MB are driven
+	 * with the dedicated 4-byte address opcodes, which leaves the
+	 * device's address mode register untouched */
+	info->addr_len = 3;
+	info->read_cmd = SPIFLASH_FAST_READ;
+	info->pprog_cmd = SPIFLASH_PAGE_PROGRAM;
+	info->erase_cmd = info->dev->erase_cmd;
+	if (bank->size > (1UL << 24)) {
+		if (jtagspi_4byte_cmd(info->erase_cmd) == 0x00
+				&& info->dev->erase_cmd != 0x00) {
+			LOG_WARNING("no 4-byte address erase for command 0x%02" PRIx8
+				" - only the first 16 MB are accessible", info->erase_cmd);
+		} else {
+			info->addr_len = 4;
+			info->read_cmd = SPIFLASH_FAST_READ_4B;
+			info->pprog_cmd = SPIFLASH_PAGE_PROGRAM_4B;
+			info->erase_cmd = jtagspi_4byte_cmd(info->erase_cmd);
+		}
+	}
 
 	/* if no sectors, treat whole bank as single sector */
 	sectorsize = info->dev->sectorsize ?
@@ -228,13 +312,15 @@ static int jtagspi_probe(struct flash_bank *bank)
 	return ERROR_OK;
 }
 
-static void jtagspi_read_status(struct flash_bank *bank, uint32_t *status)
+static int jtagspi_read_status(struct flash_bank *bank, uint32_t *status)
 {
 	uint8_t buf;
-	if (jtagspi_cmd(bank, SPIFLASH_READ_STATUS, NULL, &buf, -8) == ERROR_OK) {
+	int retval = jtagspi_cmd(bank, SPIFLASH_READ_STATUS, NULL, &buf, -8);
+	if (retval == ERROR_OK) {
 		*status = buf;
 		/* LOG_DEBUG("status=0x%08" PRIx32, *status); */
 	}
+	return retval;
 }
 
 static int jtagspi_wait(struct flash_bank *bank, int timeout_ms)
@@ -245,7 +331,9 @@ static int jtagspi_wait(struct flash_bank *bank, int timeout_ms)
 
 	do {
 		dt = timeval_ms() - t0;
-		jtagspi_read_status(bank, &status);
+		int retval = jtagspi_read_status(bank, &status);
+		if (retval != ERROR_OK)
+			return retval;
 		if ((status & SPIFLASH_BSY_BIT) == 0) {
 			LOG_DEBUG("waited %" PRId64 " ms", dt);
 			return ERROR_OK;
@@ -260,9 +348,14 @@ static int jtagspi_wait(struct flash_bank *bank, int timeout_ms)
 static int jtagspi_write_enable(struct flash_bank *bank)
 {
 	uint32_t status;
+	int retval;
 
-	jtagspi_cmd(bank, SPIFLASH_WRITE_ENABLE, NULL, NULL, 0);
-	jtagspi_read_status(bank, &status);
+	retval = jtagspi_cmd(bank, SPIFLASH_WRITE_ENABLE, NULL, NULL, 0);
+	if (retval != ERROR_OK)
+		return retval;
+	retval = jtagspi_read_status(bank, &status);
+	if (retval != ERROR_OK)
+		return retval;
 	if ((status & SPIFLASH_WE_BIT) == 0) {
 		LOG_ERROR("Cannot enable write to flash. Status=0x%08" PRIx32, status);
 		return ERROR_FAIL;
@@ -282,7 +375,9 @@ static int jtagspi_bulk_erase(struct flash_bank *bank)
 	retval = jtagspi_write_enable(bank);
 	if (retval != ERROR_OK)
 		return retval;
-	jtagspi_cmd(bank, info->dev->chip_erase_cmd, NULL, NULL, 0);
+	retval = jtagspi_cmd(bank, info->dev->chip_erase_cmd, NULL, NULL, 0);
+	if (retval != ERROR_OK)
+		return retval;
 	retval = jtagspi_wait(bank, bank->num_sectors*JTAGSPI_MAX_TIMEOUT);
 	LOG_INFO("took %" PRId64 " ms", timeval_ms() - t0);
 	return retval;
@@ -297,7 +392,9 @@ static int jtagspi_sector_erase(struct flash_bank *bank, int sector)
 	retval = jtagspi_write_enable(bank);
 	if (retval != ERROR_OK)
 		return retval;
-	jtagspi_cmd(bank, info->dev->erase_cmd, &bank->sectors[sector].offset, NULL, 0);
+	retval = jtagspi_cmd(bank, info->erase_cmd, &bank->sectors[sector].offset, NULL, 0);
+	if (retval != ERROR_OK)
+		return retval;
 	retval = jtagspi_wait(bank, JTAGSPI_MAX_TIMEOUT);
 	LOG_INFO("sector %d took %" PRId64 " ms", sector, timeval_ms() - t0);
 	return retval;
@@ -364,32 +461,130 @@ static int jtagspi_protect(struct flash_bank *bank, int set, int first, int last
 static int jtagspi_read(struct flash_bank *bank, uint8_t *buffer, uint32_t offset, uint32_t count)
 {
 	struct jtagspi_flash_bank *info = bank->driver_priv;
+	int retval;
 
 	if (!(info->probed)) {
 		LOG_ERROR("Flash bank not yet probed.");
 		return ERROR_FLASH_BANK_NOT_PROBED;
 	}
 
-	jtagspi_cmd(bank, SPIFLASH_READ, &offset, buffer, -count*8);
+	/* fast read: one dummy byte after the address */
+	retval = jtagspi_queue_cmd(bank, info->read_cmd, &offset, 8, buffer, -count*8);
+	if (retval != ERROR_OK)
+		return retval;
+	retval = jtag_execute_queue();
+	if (retval != ERROR_OK)
+		return retval;
+	flip_u8(buffer, buffer, count);
 	return ERROR_OK;
 }
 
 static int jtagspi_page_write(struct flash_bank *bank, const uint8_t *buffer, uint32_t offset, uint32_t count)
 {
+	struct jtagspi_flash_bank *info = bank->driver_priv;
 	int retval;
 
 	retval = jtagspi_write_enable(bank);
 	if (retval != ERROR_OK)
 		return retval;
-	jtagspi_cmd(bank, SPIFLASH_PAGE_PROGRAM, &offset, (uint8_t *) buffer, count*8);
+	retval = jtagspi_cmd(bank, info->pprog_cmd, &offset, (uint8_t *) buffer, count*8);
+	if (retval != ERROR_OK)
+		return retval;
 	return jtagspi_wait(bank, JTAGSPI_MAX_TIMEOUT);
 }
 
+/* Let the flash finish a page program without leaving the JTAG queue: clock
+ * the TAP in Run-Test/Idle when the adapter speed is known, sleep otherwise
+ * (e.g. RCLK). */
+static void jtagspi_queue_pp_delay(struct jtagspi_flash_bank *info)
+{
+	unsigned khz = jtag_get_speed_khz();
+
+	if (khz)
+		jtag_add_runtest(MAX(1, (int)(info->pp_delay_us * khz / 1000)), TAP_IDLE);
+	else
+		jtag_add_sleep(info->pp_delay_us);
+}
+
+/* Program up to JTAGSPI_PIPELINE_PAGES pages per JTAG flush. Each page queues
+ * write enable, a status read to capture WEL, page program, a delay and a
+ * second status read to capture WIP. The captured values are compared once
+ * the queue has run. The flash ignores commands while a program is in
+ * progress, so a page still busy when polled means the next page was
+ * dropped: wait for the flash, raise the delay and resume after the busy
+ * page. */
+static int jtagspi_write_pipelined(struct flash_bank *bank, const uint8_t *buffer,
+		uint32_t offset, uint32_t count, uint32_t pagesize)
+{
+	struct jtagspi_flash_bank *info = bank->driver_priv;
+	uint8_t we_status[JTAGSPI_PIPELINE_PAGES];
+	uint8_t wip_status[JTAGSPI_PIPELINE_PAGES];
+	uint32_t page_end[JTAGSPI_PIPELINE_PAGES];
+	uint32_t n = 0;
+	int retval;
+
+	while (n < count) {
+		uint32_t pos = n;
+		int pages;
+
+		for (pages = 0; pages < JTAGSPI_PIPELINE_PAGES && pos < count; pages++) {
+			uint32_t addr = offset + pos;
+			uint32_t len = MIN(count - pos, pagesize - (addr % pagesize));
+
+			retval = jtagspi_queue_cmd(bank, SPIFLASH_WRITE_ENABLE, NULL, 0, NULL, 0);
+			if (retval == ERROR_OK)
+				retval = jtagspi_queue_cmd(bank, SPIFLASH_READ_STATUS, NULL, 0,
+						&we_status[pages], -8);
+			if (retval == ERROR_OK)
+				retval = jtagspi_queue_cmd(bank, info->pprog_cmd, &addr, 0,
+						(uint8_t *) buffer + pos, len*8);
+			if (retval != ERROR_OK)
+				return retval;
+			jtagspi_queue_pp_delay(info);
+			retval = jtagspi_queue_cmd(bank, SPIFLASH_READ_STATUS, NULL, 0,
+					&wip_status[pages], -8);
+			if (retval != ERROR_OK)
+				return retval;
+
+			pos += len;
+			page_end[pages] = pos;
+		}
+
+		retval = jtag_execute_queue();
+		if (retval != ERROR_OK)
+			return retval;
+
+		for (int i = 0; i < pages; i++) {
+			flip_u8(&we_status[i], &we_status[i], 1);
+			flip_u8(&wip_status[i], &wip_status[i], 1);
+
+			if ((we_status[i] & SPIFLASH_WE_BIT) == 0) {
+				LOG_ERROR("Cannot enable write to flash. Status=0x%02" PRIx8,
+					we_status[i]);
+				return ERROR_FAIL;
+			}
+
+			n = page_end[i];
+			if (wip_status[i] & SPIFLASH_BSY_BIT) {
+				retval = jtagspi_wait(bank, JTAGSPI_MAX_TIMEOUT);
+				if (retval != ERROR_OK)
+					return retval;
+				info->pp_delay_us = MIN(2 * info->pp_delay_us, JTAGSPI_PP_DELAY_MAX_US);
+				LOG_DEBUG("page program delay raised to %" PRIu32 " us",
+					info->pp_delay_us);
+				break;
+			}
+		}
+		LOG_DEBUG("wrote up to 0x%08" PRIx32, offset + n);
+	}
+	return ERROR_OK;
+}
+
 static int jtagspi_write(struct flash_bank *bank, const uint8_t *buffer, uint32_t offset, uint32_t count)
 {
 	struct jtagspi_flash_bank *info = bank->driver_priv;
 	int retval;
-	uint32_t n, pagesize;
+	uint32_t n, len, pagesize;
 
 	if (!(info->probed)) {
 		LOG_ERROR("Flash bank not yet probed.");
@@ -399,9 +594,13 @@ static int jtagspi_write(struct flash_bank *bank, const uint8_t *buffer, uint32_
 	/* if no write pagesize, use reasonable default */
 	pagesize = info->dev->pagesize ? info->dev->pagesize : SPIFLASH_DEF_PAGESIZE;
 
-	for (n = 0; n < count; n += pagesize) {
-		retval = jtagspi_page_write(bank, buffer + n, offset + n,
-				MIN(count - n, pagesize));
+	if (info->pipeline)
+		return jtagspi_write_pipelined(bank, buffer, offset, count, pagesize);
+
+	for (n = 0; n < count; n += len) {
+		/* a page program must not cross a page boundary */
+		len = MIN(count - n, pagesize - ((offset + n) % pagesize));
+		retval = jtagspi_page_write(bank, buffer + n, offset + n, len);
 		if (retval != ERROR_OK) {
 			LOG_ERROR("page write error");
 			return retval;
@@ -421,14 +620,62 @@ static int jtagspi_info(struct flash_bank *bank, char *buf, int buf_size)
 	}
 
 	snprintf(buf, buf_size, "\nSPIFI flash information:\n"
-		"  Device \'%s\' (ID 0x%08" PRIx32 ")\n",
-		info->dev->name, info->dev->device_id);
+		"  Device \'%s\' (ID 0x%08" PRIx32 ")\n"
+		"  %d-byte addresses, %s writes\n",
+		info->dev->name, info->dev->device_id, info->addr_len,
+		info->pipeline ? "pipelined" : "polled");
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(jtagspi_handle_pipeline_command)
+{
+	struct jtagspi_flash_bank *info;
 
+	if (CMD_ARGC < 1 || CMD_ARGC > 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	struct flash_bank *bank;
+	int retval = CALL_COMMAND_HANDLER(flash_command_get_bank, 0, &bank);
+	if (ERROR_OK != retval)
+		return retval;
+
+	info = bank->driver_priv;
+
+	if (CMD_ARGC == 2)
+		COMMAND_PARSE_ENABLE(CMD_ARGV[1], info->pipeline);
+
+	command_print(CMD, "jtagspi pipelined writes %s",
+		info->pipeline ? "enabled" : "disabled");
 	return ERROR_OK;
 }
 
+static const struct command_registration jtagspi_exec_command_handlers[] = {
+	{
+		.name = "pipeline",
+		.handler = jtagspi_handle_pipeline_command,
+		.mode = COMMAND_EXEC,
+		.usage = "bank_id ['enable'|'disable']",
+		.help = "Batch page programs and status polls into one JTAG "
+			"queue per page group.",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static const struct command_registration jtagspi_command_handlers[] = {
+	{
+		.name = "jtagspi",
+		.mode = COMMAND_ANY,
+		.help = "jtagspi command group",
+		.usage = "",
+		.chain = jtagspi_exec_command_handlers,
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
 const struct flash_driver jtagspi_flash = {
 	.name = "jtagspi",
+	.commands = jtagspi_command_handlers,
 	.flash_bank_command = jtagspi_flash_bank_command,
 	.erase = jtagspi_erase,
 	.protect = jtagspi_protect,
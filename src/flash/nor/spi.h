@@ -87,6 +87,9 @@ extern const struct flash_device flash_devices[];
 #define SPIFLASH_PAGE_PROGRAM	0x02 /* Page Program */
 #define SPIFLASH_FAST_READ		0x0B /* Fast Read */
 #define SPIFLASH_READ			0x03 /* Normal Read */
+#define SPIFLASH_PAGE_PROGRAM_4B	0x12 /* Page Program, 4-byte address */
+#define SPIFLASH_FAST_READ_4B	0x0C /* Fast Read, 4-byte address */
+#define SPIFLASH_READ_4B		0x13 /* Normal Read, 4-byte address */
 
 #define SPIFLASH_DEF_PAGESIZE	256  /* default for non-page-oriented devices (FRAMs) */
 
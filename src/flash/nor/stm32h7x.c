@@ -26,6 +26,7 @@
 
 /* Erase time can be as high as 1000ms, 10x this and it's toast... */
 #define FLASH_ERASE_TIMEOUT 10000
+#define FLASH_MASS_ERASE_TIMEOUT 30000
 #define FLASH_WRITE_TIMEOUT 5
 
 /* RM 433 */
@@ -130,6 +131,9 @@ struct stm32h7x_flash_bank {
 	uint32_t flash_base;    /* Address of flash reg controller */
 	struct stm32x_options option_bytes;
 	const struct stm32h7x_part_info *part_info;
+	int erase_sector;       /* Sector being erased by stm32x_erase_start() */
+	int erase_last;         /* Last sector to erase */
+	bool erase_bank;        /* Whole bank is being erased at once */
 };
 
 static const struct stm32h7x_rev stm32_450_revs[] = {
@@ -442,11 +446,52 @@ static int stm32x_protect_check(struct flash_bank *bank)
 	return ERROR_OK;
 }
 
-static int stm32x_erase(struct flash_bank *bank, int first, int last)
+static int stm32x_erase_sector_start(struct flash_bank *bank, int sector)
 {
 	struct target *target = bank->target;
 	int retval;
 
+	LOG_DEBUG("erase sector %d", sector);
+	retval = target_write_u32(target, stm32x_get_flash_reg(bank, FLASH_CR),
+			FLASH_SER | FLASH_SNB(sector) | FLASH_PSIZE_64);
+	if (retval == ERROR_OK)
+		retval = target_write_u32(target, stm32x_get_flash_reg(bank, FLASH_CR),
+				FLASH_SER | FLASH_SNB(sector) | FLASH_PSIZE_64 | FLASH_START);
+	if (retval != ERROR_OK)
+		LOG_ERROR("Error erase sector %d", sector);
+
+	return retval;
+}
+
+/* Called once the controller finished the erase in progress: records
+ * the result and starts erasing the next sector, if any */
+static int stm32x_erase_next(struct flash_bank *bank)
+{
+	struct stm32h7x_flash_bank *stm32x_info = bank->driver_priv;
+
+	if (stm32x_info->erase_bank) {
+		for (int i = 0; i < bank->num_sectors; i++)
+			bank->sectors[i].is_erased = 1;
+		stm32x_info->erase_sector = stm32x_info->erase_last + 1;
+		return ERROR_OK;
+	}
+
+	bank->sectors[stm32x_info->erase_sector].is_erased = 1;
+	if (++stm32x_info->erase_sector > stm32x_info->erase_last)
+		return ERROR_OK;
+
+	return stm32x_erase_sector_start(bank, stm32x_info->erase_sector);
+}
+
+/* Starts the erase and returns. The whole bank is erased with a single
+ * bank erase, otherwise the first sector is started here and the others
+ * by stm32x_erase_poll() or stm32x_erase_wait(). Each bank has its own
+ * flash controller, so the other bank can be programmed meanwhile. */
+static int stm32x_erase_start(struct flash_bank *bank, int first, int last)
+{
+	struct stm32h7x_flash_bank *stm32x_info = bank->driver_priv;
+	int retval;
+
 	assert(first < bank->num_sectors);
 	assert(last < bank->num_sectors);
 
@@ -467,27 +512,66 @@ static int stm32x_erase(struct flash_bank *bank, int first, int last)
 	3. Set the STRT bit in the FLASH_CR register
 	4. Wait for flash operations completion
 	 */
-	for (int i = first; i <= last; i++) {
-		LOG_DEBUG("erase sector %d", i);
-		retval = target_write_u32(target, stm32x_get_flash_reg(bank, FLASH_CR),
-				FLASH_SER | FLASH_SNB(i) | FLASH_PSIZE_64);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Error erase sector %d", i);
-			return retval;
-		}
-		retval = target_write_u32(target, stm32x_get_flash_reg(bank, FLASH_CR),
-				FLASH_SER | FLASH_SNB(i) | FLASH_PSIZE_64 | FLASH_START);
+	stm32x_info->erase_sector = first;
+	stm32x_info->erase_last = last;
+	stm32x_info->erase_bank = first == 0 && last == bank->num_sectors - 1;
+
+	if (!stm32x_info->erase_bank)
+		return stm32x_erase_sector_start(bank, first);
+
+	LOG_DEBUG("erase bank");
+	retval = target_write_u32(bank->target, stm32x_get_flash_reg(bank, FLASH_CR),
+			FLASH_BER | FLASH_PSIZE_64);
+	if (retval == ERROR_OK)
+		retval = target_write_u32(bank->target, stm32x_get_flash_reg(bank, FLASH_CR),
+				FLASH_BER | FLASH_PSIZE_64 | FLASH_START);
+	if (retval != ERROR_OK)
+		LOG_ERROR("Error erase bank");
+
+	return retval;
+}
+
+/* Continues a sector by sector erase without waiting */
+static int stm32x_erase_poll(struct flash_bank *bank)
+{
+	struct stm32h7x_flash_bank *stm32x_info = bank->driver_priv;
+	uint32_t status;
+	int retval;
+
+	if (stm32x_info->erase_sector > stm32x_info->erase_last)
+		return ERROR_OK;
+
+	retval = stm32x_get_flash_status(bank, &status);
+	if (retval != ERROR_OK || (status & FLASH_QW))
+		return retval;
+
+	/* does not wait, but reports and clears the error flags */
+	retval = stm32x_wait_flash_op_queue(bank, 0);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("erase operation error sector %d", stm32x_info->erase_sector);
+		return retval;
+	}
+
+	return stm32x_erase_next(bank);
+}
+
+static int stm32x_erase_wait(struct flash_bank *bank)
+{
+	struct stm32h7x_flash_bank *stm32x_info = bank->driver_priv;
+	int retval;
+
+	while (stm32x_info->erase_sector <= stm32x_info->erase_last) {
+		retval = stm32x_wait_flash_op_queue(bank, stm32x_info->erase_bank
+				? FLASH_MASS_ERASE_TIMEOUT : FLASH_ERASE_TIMEOUT);
 		if (retval != ERROR_OK) {
-			LOG_ERROR("Error erase sector %d", i);
+			LOG_ERROR("erase time-out or operation error sector %d",
+				stm32x_info->erase_sector);
 			return retval;
 		}
-		retval = stm32x_wait_flash_op_queue(bank, FLASH_ERASE_TIMEOUT);
 
-		if (retval != ERROR_OK) {
-			LOG_ERROR("erase time-out or operation error sector %d", i);
+		retval = stm32x_erase_next(bank);
+		if (retval != ERROR_OK)
 			return retval;
-		}
-		bank->sectors[i].is_erased = 1;
 	}
 
 	retval = stm32x_lock_reg(bank);
@@ -499,6 +583,15 @@ static int stm32x_erase(struct flash_bank *bank, int first, int last)
 	return ERROR_OK;
 }
 
+static int stm32x_erase(struct flash_bank *bank, int first, int last)
+{
+	int retval = stm32x_erase_start(bank, first, last);
+	if (retval != ERROR_OK)
+		return retval;
+
+	return stm32x_erase_wait(bank);
+}
+
 static int stm32x_protect(struct flash_bank *bank, int set, int first, int last)
 {
 	struct target *target = bank->target;
@@ -1039,7 +1132,7 @@ static int stm32x_mass_erase(struct flash_bank *bank)
 	if (retval != ERROR_OK)
 		return retval;
 
-	retval = stm32x_wait_flash_op_queue(bank, 30000);
+	retval = stm32x_wait_flash_op_queue(bank, FLASH_MASS_ERASE_TIMEOUT);
 	if (retval != ERROR_OK)
 		return retval;
 
@@ -1120,6 +1213,9 @@ const struct flash_driver stm32h7x_flash = {
 	.commands = stm32x_command_handlers,
 	.flash_bank_command = stm32x_flash_bank_command,
 	.erase = stm32x_erase,
+	.erase_start = stm32x_erase_start,
+	.erase_poll = stm32x_erase_poll,
+	.erase_wait = stm32x_erase_wait,
 	.protect = stm32x_protect,
 	.write = stm32x_write,
 	.read = default_flash_read,
@@ -35,6 +35,10 @@ COMMAND_HELPER(flash_command_get_bank_maybe_probe, unsigned name_index,
 {
 	const char *name = CMD_ARGV[name_index];
 	int retval;
+
+	/* driver commands may re-probe the bank on their own */
+	flash_bank_index_invalidate();
+
 	if (do_probe) {
 		retval = get_flash_bank_by_name(name, bank);
 	} else {
@@ -94,7 +98,7 @@ COMMAND_HANDLER(handle_flash_info_command)
 		struct flash_sector *block_array;
 
 		/* attempt auto probe */
-		retval = p->driver->auto_probe(p);
+		retval = flash_bank_auto_probe(p);
 		if (retval != ERROR_OK)
 			return retval;
 
@@ -174,7 +178,7 @@ COMMAND_HANDLER(handle_flash_probe_command)
 		return retval;
 
 	if (p) {
-		retval = p->driver->probe(p);
+		retval = flash_bank_probe(p);
 		if (retval == ERROR_OK)
 			command_print(CMD,
 				"flash '%s' found at " TARGET_ADDR_FMT,
@@ -149,7 +149,7 @@ static int virtual_probe(struct flash_bank *bank)
 		return ERROR_FLASH_OPERATION_FAILED;
 
 	/* call master handler */
-	retval = master_bank->driver->probe(master_bank);
+	retval = flash_bank_probe(master_bank);
 	if (retval != ERROR_OK)
 		return retval;
 
@@ -168,7 +168,7 @@ static int virtual_auto_probe(struct flash_bank *bank)
 		return ERROR_FLASH_OPERATION_FAILED;
 
 	/* call master handler */
-	retval = master_bank->driver->auto_probe(master_bank);
+	retval = flash_bank_auto_probe(master_bank);
 	if (retval != ERROR_OK)
 		return retval;
 
@@ -186,6 +186,12 @@ uint32_t flip_u32(uint32_t value, unsigned int num)
 	return c;
 }
 
+void buf_flip_u8(uint8_t *buf, size_t len)
+{
+	for (size_t i = 0; i < len; i++)
+		buf[i] = bit_reverse_table256[buf[i]];
+}
+
 static int ceil_f_to_u32(float x)
 {
 	if (x < 0)	/* return zero for negative numbers */
@@ -173,6 +173,13 @@ static inline uint64_t buf_get_u64(const uint8_t *_buffer,
  */
 uint32_t flip_u32(uint32_t value, unsigned width);
 
+/**
+ * Inverts the ordering of bits inside each byte of a buffer, in place.
+ * @param buf The buffer to flip.
+ * @param len The number of bytes in @c buf.
+ */
+void buf_flip_u8(uint8_t *buf, size_t len);
+
 bool buf_cmp(const void *buf1, const void *buf2, unsigned size);
 bool buf_cmp_mask(const void *buf1, const void *buf2,
 		const void *mask, unsigned size);
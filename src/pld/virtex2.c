@@ -125,35 +125,115 @@ static int virtex2_read_stat(struct pld_device *pld_device, uint32_t *status)
 	return ERROR_OK;
 }
 
+/* The bitstream is shifted in segments of VIRTEX2_LOAD_CHUNK bytes, and the
+ * queue is executed every VIRTEX2_LOAD_FLUSH bytes, so memory use does not
+ * depend on the size of the bitstream. */
+#define VIRTEX2_LOAD_CHUNK	(64 * 1024)
+#define VIRTEX2_LOAD_FLUSH	(1024 * 1024)
+
+/* Counts the bypassed TAPs between @a tap and TDO, and between TDI and @a tap */
+static void virtex2_count_bypass(struct jtag_tap *tap,
+	unsigned *before, unsigned *after)
+{
+	unsigned *count = before;
+
+	*before = 0;
+	*after = 0;
+	for (struct jtag_tap *t = jtag_tap_next_enabled(NULL); t; t = jtag_tap_next_enabled(t)) {
+		if (t == tap)
+			count = after;
+		else if (t->bypass)
+			(*count)++;
+	}
+}
+
+/* One bypass bit per bypassed TAP, shifted as part of the single
+ * continuous DR shift the segments form */
+static void virtex2_add_bypass_bits(unsigned num_bits, const uint8_t *zeros)
+{
+	if (num_bits)
+		jtag_add_plain_dr_scan(num_bits, zeros, NULL, TAP_DRPAUSE);
+}
+
 static int virtex2_load(struct pld_device *pld_device, const char *filename)
 {
 	struct virtex2_pld_device *virtex2_info = pld_device->driver_priv;
 	struct xilinx_bit_file bit_file;
+	FILE *input_file;
+	uint8_t *buffer, *zeros = NULL;
+	unsigned bypass_before, bypass_after;
+	uint32_t done = 0, queued = 0;
+	int percent, last_percent = 0;
 	int retval;
-	unsigned int i;
-	struct scan_field field;
-
-	field.in_value = NULL;
 
-	retval = xilinx_read_bit_file(&bit_file, filename);
+	retval = xilinx_open_bit_file(&bit_file, filename, &input_file);
 	if (retval != ERROR_OK)
 		return retval;
 
+	buffer = malloc(VIRTEX2_LOAD_CHUNK);
+	if (buffer == NULL) {
+		LOG_ERROR("no memory for bitstream buffer");
+		retval = ERROR_FAIL;
+		goto out;
+	}
+
 	virtex2_set_instr(virtex2_info->tap, 0xb);	/* JPROG_B */
-	jtag_execute_queue();
+	retval = jtag_execute_queue();
+	if (retval != ERROR_OK)
+		goto out;
 	jtag_add_sleep(1000);
 
 	virtex2_set_instr(virtex2_info->tap, 0x5);	/* CFG_IN */
-	jtag_execute_queue();
-
-	for (i = 0; i < bit_file.length; i++)
-		bit_file.data[i] = flip_u32(bit_file.data[i], 8);
-
-	field.num_bits = bit_file.length * 8;
-	field.out_value = bit_file.data;
+	retval = jtag_execute_queue();
+	if (retval != ERROR_OK)
+		goto out;
+
+	virtex2_count_bypass(virtex2_info->tap, &bypass_before, &bypass_after);
+	zeros = calloc(DIV_ROUND_UP(MAX(bypass_before, bypass_after), 8) + 1, 1);
+	if (zeros == NULL) {
+		LOG_ERROR("no memory for bitstream buffer");
+		retval = ERROR_FAIL;
+		goto out;
+	}
 
-	jtag_add_dr_scan(virtex2_info->tap, 1, &field, TAP_DRPAUSE);
-	jtag_execute_queue();
+	/* Each segment ends in DRPAUSE and the next one re-enters DRSHIFT
+	 * through DREXIT2, without passing DRUPDATE, so the device sees a
+	 * single continuous shift.  The segments are plain scans; the bits
+	 * for the other TAPs in bypass are only shifted before the first
+	 * and after the last segment, not in the middle of the bitstream. */
+	virtex2_add_bypass_bits(bypass_before, zeros);
+	while (done < bit_file.length) {
+		size_t len = MIN(bit_file.length - done, VIRTEX2_LOAD_CHUNK);
+
+		if (fread(buffer, 1, len, input_file) != len) {
+			LOG_ERROR("couldn't read bitstream from file '%s'", filename);
+			retval = ERROR_PLD_FILE_LOAD_FAILED;
+			goto out;
+		}
+		buf_flip_u8(buffer, len);
+
+		/* the scan data is copied into the queue */
+		jtag_add_plain_dr_scan(len * 8, buffer, NULL, TAP_DRPAUSE);
+
+		done += len;
+		queued += len;
+		if (done == bit_file.length)
+			virtex2_add_bypass_bits(bypass_after, zeros);
+		if (queued < VIRTEX2_LOAD_FLUSH && done < bit_file.length)
+			continue;
+
+		retval = jtag_execute_queue();
+		if (retval != ERROR_OK)
+			goto out;
+		queued = 0;
+
+		percent = (uint64_t)done * 100 / bit_file.length;
+		if (percent / 10 != last_percent / 10) {
+			LOG_INFO("virtex2: loaded %d%% (%" PRIu32 " of %" PRIu32 " bytes)",
+				percent, done, bit_file.length);
+			last_percent = percent;
+		}
+	}
 
 	jtag_add_tlr();
 
@@ -166,9 +246,15 @@ static int virtex2_load(struct pld_device *pld_device, const char *filename)
 		virtex2_set_instr(virtex2_info->tap, 0xc);	/* JSTART */
 	jtag_add_runtest(13, TAP_IDLE);
 	virtex2_set_instr(virtex2_info->tap, 0x3f);		/* BYPASS */
-	jtag_execute_queue();
+	retval = jtag_execute_queue();
 
-	return ERROR_OK;
+out:
+	free(zeros);
+	free(buffer);
+	fclose(input_file);
+	xilinx_free_bit_file(&bit_file);
+
+	return retval;
 }
 
 COMMAND_HANDLER(virtex2_handle_read_stat_command)
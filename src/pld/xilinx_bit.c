@@ -60,6 +60,8 @@ static int read_section(FILE *input_file, int length_size, char section,
 		*buffer_length = length;
 
 	*buffer = malloc(length);
+	if (*buffer == NULL)
+		return ERROR_PLD_FILE_LOAD_FAILED;
 
 	read_count = fread(*buffer, 1, length, input_file);
 	if (read_count != length)
@@ -68,15 +70,31 @@ static int read_section(FILE *input_file, int length_size, char section,
 	return ERROR_OK;
 }
 
-int xilinx_read_bit_file(struct xilinx_bit_file *bit_file, const char *filename)
+static bool xilinx_is_raw_bitstream(const char *filename)
 {
-	FILE *input_file;
+	size_t len = strlen(filename);
+
+	return len >= 4 && strcasecmp(filename + len - 4, ".bin") == 0;
+}
+
+/**
+ * Opens a bitstream and parses its header, leaving @a input_file positioned
+ * at the configuration data.  @c bit_file->length is the number of data bytes
+ * that follow; @c bit_file->data is not filled in.  Files named *.bin are
+ * taken as raw configuration data without a header.
+ */
+int xilinx_open_bit_file(struct xilinx_bit_file *bit_file, const char *filename,
+		FILE **input_file)
+{
+	FILE *input;
 	struct stat input_stat;
 	int read_count;
 
-	if (!filename || !bit_file)
+	if (!filename || !bit_file || !input_file)
 		return ERROR_COMMAND_SYNTAX_ERROR;
 
+	memset(bit_file, 0, sizeof(*bit_file));
+
 	if (stat(filename, &input_stat) == -1) {
 		LOG_ERROR("couldn't stat() %s: %s", filename, strerror(errno));
 		return ERROR_PLD_FILE_LOAD_FAILED;
@@ -92,37 +110,90 @@ int xilinx_read_bit_file(struct xilinx_bit_file *bit_file, const char *filename)
 		return ERROR_PLD_FILE_LOAD_FAILED;
 	}
 
-	input_file = fopen(filename, "rb");
-	if (input_file == NULL) {
+	input = fopen(filename, "rb");
+	if (input == NULL) {
 		LOG_ERROR("couldn't open %s: %s", filename, strerror(errno));
 		return ERROR_PLD_FILE_LOAD_FAILED;
 	}
 
-	read_count = fread(bit_file->unknown_header, 1, 13, input_file);
+	if (xilinx_is_raw_bitstream(filename)) {
+		bit_file->length = input_stat.st_size;
+		LOG_DEBUG("raw bitstream: %" PRIi32 "", bit_file->length);
+		*input_file = input;
+		return ERROR_OK;
+	}
+
+	read_count = fread(bit_file->unknown_header, 1, 13, input);
 	if (read_count != 13) {
 		LOG_ERROR("couldn't read unknown_header from file '%s'", filename);
-		return ERROR_PLD_FILE_LOAD_FAILED;
+		goto error;
 	}
 
-	if (read_section(input_file, 2, 'a', NULL, &bit_file->source_file) != ERROR_OK)
-		return ERROR_PLD_FILE_LOAD_FAILED;
+	if (read_section(input, 2, 'a', NULL, &bit_file->source_file) != ERROR_OK)
+		goto error;
 
-	if (read_section(input_file, 2, 'b', NULL, &bit_file->part_name) != ERROR_OK)
-		return ERROR_PLD_FILE_LOAD_FAILED;
+	if (read_section(input, 2, 'b', NULL, &bit_file->part_name) != ERROR_OK)
+		goto error;
 
-	if (read_section(input_file, 2, 'c', NULL, &bit_file->date) != ERROR_OK)
-		return ERROR_PLD_FILE_LOAD_FAILED;
+	if (read_section(input, 2, 'c', NULL, &bit_file->date) != ERROR_OK)
+		goto error;
 
-	if (read_section(input_file, 2, 'd', NULL, &bit_file->time) != ERROR_OK)
-		return ERROR_PLD_FILE_LOAD_FAILED;
+	if (read_section(input, 2, 'd', NULL, &bit_file->time) != ERROR_OK)
+		goto error;
 
-	if (read_section(input_file, 4, 'e', &bit_file->length, &bit_file->data) != ERROR_OK)
-		return ERROR_PLD_FILE_LOAD_FAILED;
+	/* section 'e' is the configuration data, only its length is read here */
+	uint8_t length_buffer[4];
+	char section_char;
+	if (fread(&section_char, 1, 1, input) != 1 || section_char != 'e'
+			|| fread(length_buffer, 1, 4, input) != 4)
+		goto error;
+	bit_file->length = be_to_h_u32(length_buffer);
 
 	LOG_DEBUG("bit_file: %s %s %s,%s %" PRIi32 "", bit_file->source_file, bit_file->part_name,
 		bit_file->date, bit_file->time, bit_file->length);
 
+	*input_file = input;
+	return ERROR_OK;
+
+error:
+	fclose(input);
+	xilinx_free_bit_file(bit_file);
+	return ERROR_PLD_FILE_LOAD_FAILED;
+}
+
+int xilinx_read_bit_file(struct xilinx_bit_file *bit_file, const char *filename)
+{
+	FILE *input_file;
+	int retval;
+
+	retval = xilinx_open_bit_file(bit_file, filename, &input_file);
+	if (retval != ERROR_OK)
+		return retval;
+
+	bit_file->data = malloc(bit_file->length);
+	if (bit_file->data == NULL
+			|| fread(bit_file->data, 1, bit_file->length, input_file) != bit_file->length) {
+		LOG_ERROR("couldn't read bitstream from file '%s'", filename);
+		fclose(input_file);
+		xilinx_free_bit_file(bit_file);
+		return ERROR_PLD_FILE_LOAD_FAILED;
+	}
+
 	fclose(input_file);
 
 	return ERROR_OK;
 }
+
+void xilinx_free_bit_file(struct xilinx_bit_file *bit_file)
+{
+	free(bit_file->source_file);
+	free(bit_file->part_name);
+	free(bit_file->date);
+	free(bit_file->time);
+	free(bit_file->data);
+	bit_file->source_file = NULL;
+	bit_file->part_name = NULL;
+	bit_file->date = NULL;
+	bit_file->time = NULL;
+	bit_file->data = NULL;
+}
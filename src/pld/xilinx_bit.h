@@ -30,5 +30,8 @@ struct xilinx_bit_file {
 };
 
 int xilinx_read_bit_file(struct xilinx_bit_file *bit_file, const char *filename);
+int xilinx_open_bit_file(struct xilinx_bit_file *bit_file, const char *filename,
+		FILE **input_file);
+void xilinx_free_bit_file(struct xilinx_bit_file *bit_file);
 
 #endif /* OPENOCD_PLD_XILINX_BIT_H */
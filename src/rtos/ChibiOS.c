@@ -274,6 +274,17 @@ static int ChibiOS_update_stacking(struct rtos *rtos)
 	return -1;
 }
 
+/* Thread fields are served from the rtos snapshot, so the list walk below
+ * costs about one target read per thread. */
+static int ChibiOS_read_u32(struct rtos *rtos, uint32_t address, uint32_t *value)
+{
+	uint8_t buf[4];
+	int retval = rtos_snapshot_read(rtos, address, sizeof(buf), buf);
+	if (retval == ERROR_OK)
+		*value = target_buffer_get_u32(rtos->target, buf);
+	return retval;
+}
+
 static int ChibiOS_update_threads(struct rtos *rtos)
 {
 	int retval;
@@ -316,8 +327,7 @@ static int ChibiOS_update_threads(struct rtos *rtos)
 	current = rlist;
 	previous = rlist;
 	while (1) {
-		retval = target_read_u32(rtos->target,
-								 current + signature->cf_off_newer, &current);
+		retval = ChibiOS_read_u32(rtos, current + signature->cf_off_newer, &current);
 		if (retval != ERROR_OK) {
 			LOG_ERROR("Could not read next ChibiOS thread");
 			return retval;
@@ -331,8 +341,7 @@ static int ChibiOS_update_threads(struct rtos *rtos)
 			break;
 		}
 		/* Fetch previous thread in the list as a integrity check. */
-		retval = target_read_u32(rtos->target,
-								 current + signature->cf_off_older, &older);
+		retval = ChibiOS_read_u32(rtos, current + signature->cf_off_older, &older);
 		if ((retval != ERROR_OK) || (older == 0) || (older != previous)) {
 			LOG_ERROR("ChibiOS registry integrity check failed, "
 						"double linked list violation");
@@ -386,8 +395,7 @@ static int ChibiOS_update_threads(struct rtos *rtos)
 		uint32_t name_ptr = 0;
 		char tmp_str[CHIBIOS_THREAD_NAME_STR_SIZE];
 
-		retval = target_read_u32(rtos->target,
-								 current + signature->cf_off_newer, &current);
+		retval = ChibiOS_read_u32(rtos, current + signature->cf_off_newer, &current);
 		if (retval != ERROR_OK) {
 			LOG_ERROR("Could not read next ChibiOS thread");
 			return -6;
@@ -401,25 +409,32 @@ static int ChibiOS_update_threads(struct rtos *rtos)
 		curr_thrd_details->threadid = current;
 
 		/* read the name pointer */
-		retval = target_read_u32(rtos->target,
-								 current + signature->cf_off_name, &name_ptr);
+		retval = ChibiOS_read_u32(rtos, current + signature->cf_off_name, &name_ptr);
 		if (retval != ERROR_OK) {
 			LOG_ERROR("Could not read ChibiOS thread name pointer from target");
 			return retval;
 		}
 
-		/* Read the thread name */
-		retval = target_read_buffer(rtos->target, name_ptr,
-									CHIBIOS_THREAD_NAME_STR_SIZE,
-									(uint8_t *)&tmp_str);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Error reading thread name from ChibiOS target");
-			return retval;
-		}
-		tmp_str[CHIBIOS_THREAD_NAME_STR_SIZE - 1] = '\x00';
+		/* Names are mostly string constants: unless the thread now points
+		 * elsewhere, the name read at the previous halt is still good. */
+		const char *name = rtos_snapshot_lookup_name(rtos, current, name_ptr);
+		if (name) {
+			strncpy(tmp_str, name, CHIBIOS_THREAD_NAME_STR_SIZE - 1);
+			tmp_str[CHIBIOS_THREAD_NAME_STR_SIZE - 1] = '\x00';
+		} else {
+			retval = target_read_buffer(rtos->target, name_ptr,
+										CHIBIOS_THREAD_NAME_STR_SIZE,
+										(uint8_t *)&tmp_str);
+			if (retval != ERROR_OK) {
+				LOG_ERROR("Error reading thread name from ChibiOS target");
+				return retval;
+			}
+			tmp_str[CHIBIOS_THREAD_NAME_STR_SIZE - 1] = '\x00';
 
-		if (tmp_str[0] == '\x00')
-			strcpy(tmp_str, "No Name");
+			if (tmp_str[0] == '\x00')
+				strcpy(tmp_str, "No Name");
+		}
+		rtos_snapshot_record_name(rtos, current, name_ptr, tmp_str);
 
 		curr_thrd_details->thread_name_str = malloc(
 				strlen(tmp_str) + 1);
@@ -429,8 +444,8 @@ static int ChibiOS_update_threads(struct rtos *rtos)
 		uint8_t threadState;
 		const char *state_desc;
 
-		retval = target_read_u8(rtos->target,
-								current + signature->cf_off_state, &threadState);
+		retval = rtos_snapshot_read(rtos, current + signature->cf_off_state,
+									sizeof(threadState), &threadState);
 		if (retval != ERROR_OK) {
 			LOG_ERROR("Error reading thread state from ChibiOS target");
 			return retval;
@@ -453,9 +468,7 @@ static int ChibiOS_update_threads(struct rtos *rtos)
 
 	uint32_t current_thrd;
 	/* NOTE: By design, cf_off_name equals readylist_current_offset */
-	retval = target_read_u32(rtos->target,
-							 rlist + signature->cf_off_name,
-							 &current_thrd);
+	retval = ChibiOS_read_u32(rtos, rlist + signature->cf_off_name, &current_thrd);
 	if (retval != ERROR_OK) {
 		LOG_ERROR("Could not read current Thread from ChibiOS target");
 		return retval;
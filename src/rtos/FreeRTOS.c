@@ -178,7 +178,7 @@ static int FreeRTOS_update_threads(struct rtos *rtos)
 	}
 
 	int thread_list_size = 0;
-	retval = target_read_buffer(rtos->target,
+	retval = rtos_snapshot_read(rtos,
 			rtos->symbols[FreeRTOS_VAL_uxCurrentNumberOfTasks].address,
 			param->thread_count_width,
 			(uint8_t *)&thread_list_size);
@@ -195,7 +195,7 @@ static int FreeRTOS_update_threads(struct rtos *rtos)
 	rtos_free_threadlist(rtos);
 
 	/* read the current thread */
-	retval = target_read_buffer(rtos->target,
+	retval = rtos_snapshot_read(rtos,
 			rtos->symbols[FreeRTOS_VAL_pxCurrentTCB].address,
 			param->pointer_width,
 			(uint8_t *)&rtos->current_thread);
@@ -246,7 +246,7 @@ static int FreeRTOS_update_threads(struct rtos *rtos)
 		return ERROR_FAIL;
 	}
 	int64_t max_used_priority = 0;
-	retval = target_read_buffer(rtos->target,
+	retval = rtos_snapshot_read(rtos,
 			rtos->symbols[FreeRTOS_VAL_uxTopUsedPriority].address,
 			param->pointer_width,
 			(uint8_t *)&max_used_priority);
@@ -280,13 +280,19 @@ static int FreeRTOS_update_threads(struct rtos *rtos)
 	list_of_lists[num_lists++] = rtos->symbols[FreeRTOS_VAL_xSuspendedTaskList].address;
 	list_of_lists[num_lists++] = rtos->symbols[FreeRTOS_VAL_xTasksWaitingTermination].address;
 
+	/* All ready lists in one read; a failure here only costs the
+	 * individual reads below. */
+	if (rtos->symbols[FreeRTOS_VAL_pxReadyTasksLists].address)
+		rtos_snapshot_prefetch(rtos, rtos->symbols[FreeRTOS_VAL_pxReadyTasksLists].address,
+				(max_used_priority + 1) * param->list_width);
+
 	for (i = 0; i < num_lists; i++) {
 		if (list_of_lists[i] == 0)
 			continue;
 
 		/* Read the number of threads in this list */
 		int64_t list_thread_count = 0;
-		retval = target_read_buffer(rtos->target,
+		retval = rtos_snapshot_read(rtos,
 				list_of_lists[i],
 				param->thread_count_width,
 				(uint8_t *)&list_thread_count);
@@ -304,7 +310,7 @@ static int FreeRTOS_update_threads(struct rtos *rtos)
 		/* Read the location of first list item */
 		uint64_t prev_list_elem_ptr = -1;
 		uint64_t list_elem_ptr = 0;
-		retval = target_read_buffer(rtos->target,
+		retval = rtos_snapshot_read(rtos,
 				list_of_lists[i] + param->list_next_offset,
 				param->pointer_width,
 				(uint8_t *)&list_elem_ptr);
@@ -321,7 +327,7 @@ static int FreeRTOS_update_threads(struct rtos *rtos)
 				(tasks_found < thread_list_size)) {
 			/* Get the location of the thread structure. */
 			rtos->thread_details[tasks_found].threadid = 0;
-			retval = target_read_buffer(rtos->target,
+			retval = rtos_snapshot_read(rtos,
 					list_elem_ptr + param->list_elem_content_offset,
 					param->pointer_width,
 					(uint8_t *)&(rtos->thread_details[tasks_found].threadid));
@@ -340,7 +346,7 @@ static int FreeRTOS_update_threads(struct rtos *rtos)
 			char tmp_str[FREERTOS_THREAD_NAME_STR_SIZE];
 
 			/* Read the thread name */
-			retval = target_read_buffer(rtos->target,
+			retval = rtos_snapshot_read(rtos,
 					rtos->thread_details[tasks_found].threadid + param->thread_name_offset,
 					FREERTOS_THREAD_NAME_STR_SIZE,
 					(uint8_t *)&tmp_str);
@@ -376,7 +382,7 @@ static int FreeRTOS_update_threads(struct rtos *rtos)
 
 			prev_list_elem_ptr = list_elem_ptr;
 			list_elem_ptr = 0;
-			retval = target_read_buffer(rtos->target,
+			retval = rtos_snapshot_read(rtos,
 					prev_list_elem_ptr + param->list_elem_next_offset,
 					param->pointer_width,
 					(uint8_t *)&list_elem_ptr);
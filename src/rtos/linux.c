@@ -36,6 +36,8 @@
 #include "linux_header.h"
 #define PHYS
 #define MAX_THREADS 200
+#define LINUX_PAGE_SIZE 4096
+
 /*  specific task  */
 struct linux_os {
 	const char *name;
@@ -63,8 +65,13 @@ struct current_thread {
 	struct current_thread *next;
 };
 
+/*  fields of struct threads read on first use, see linux_task_fetch() */
+#define LINUX_TASK_NAME		0x1
+#define LINUX_TASK_INFO		0x2
+
 struct threads {
 	char name[17];
+	uint32_t valid;		/*  LINUX_TASK_* fields already read */
 	uint32_t base_addr;	/*  address to read magic */
 	uint32_t state;		/*  magic value : filled only at creation */
 	uint32_t pid;		/* linux pid : id for identifying a thread */
@@ -92,8 +99,6 @@ struct cpu_context {
 	uint32_t PC;
 	uint32_t preempt_count;
 };
-struct cpu_context *cpu_context_read(struct target *target, uint32_t base_addr,
-				     uint32_t *info_addr);
 static int insert_into_threadlist(struct target *target, struct threads *t);
 
 static int linux_os_create(struct target *target);
@@ -124,24 +129,51 @@ static int linux_compute_virt2phys(struct target *target, target_addr_t address)
 	return ERROR_OK;
 }
 
+/*  kernel memory outside the linear map needs the MMU tables; the
+ *  target caches the translations in its TLB, which it keeps coherent
+ *  with resumes and page table changes.  Falls back to the linear
+ *  offset. */
+static uint32_t linux_virt2phys(struct target *target, uint32_t address)
+{
+	struct linux_os *linux_os = (struct linux_os *)
+		target->rtos->rtos_specific_params;
+	target_addr_t pa;
+
+	if (!target->type->virt2phys ||
+			target->type->virt2phys(target, address, &pa) != ERROR_OK)
+		return (address & linux_os->phys_mask) + linux_os->phys_base;
+
+	return pa;
+}
+
 static int linux_read_memory(struct target *target,
 	uint32_t address, uint32_t size, uint32_t count,
 	uint8_t *buffer)
 {
-#ifdef PHYS
-	struct linux_os *linux_os = (struct linux_os *)
-		target->rtos->rtos_specific_params;
-	uint32_t pa = (address & linux_os->phys_mask) + linux_os->phys_base;
-#endif
 	if (address < 0xc000000) {
 		LOG_ERROR("linux awareness : address in user space");
 		return ERROR_FAIL;
 	}
 #ifdef PHYS
-	target_read_phys_memory(target, pa, size, count, buffer);
+	/*  one physical read per page instead of a translated access */
+	uint32_t done = 0;
+
+	while (done < count) {
+		uint32_t addr = address + done * size;
+		uint32_t n = (LINUX_PAGE_SIZE - (addr & (LINUX_PAGE_SIZE - 1))) / size;
+
+		if (n == 0 || n > count - done)
+			n = count - done;
+		if (target_read_phys_memory(target, linux_virt2phys(target, addr),
+				size, n, buffer + done * size) != ERROR_OK)
+			break;
+		done += n;
+	}
+
+	if (done == count)
+		return ERROR_OK;
 #endif
-	target_read_memory(target, address, size, count, buffer);
-	return ERROR_OK;
+	return target_read_memory(target, address, size, count, buffer);
 }
 
 int fill_buffer(struct target *target, uint32_t addr, uint8_t *buffer)
@@ -345,6 +377,7 @@ int fill_task(struct target *target, struct threads *t)
 		LOG_ERROR("fill task: unable to read memory");
 
 	free(buffer);
+	t->valid |= LINUX_TASK_INFO;
 
 	return retval;
 }
@@ -391,10 +424,42 @@ int get_name(struct target *target, struct threads *t)
 	t->name[14] = raw_name >> 16;
 	t->name[13] = raw_name >> 8;
 	t->name[12] = raw_name;
+	t->valid |= LINUX_TASK_NAME;
 	return ERROR_OK;
 
 }
 
+/*  Walking the task list needs only the pid and the link to the next
+ *  task; both are read with one access. */
+static int linux_read_task(struct target *target, struct threads *t,
+	uint32_t *next)
+{
+	const uint32_t first = MIN(NEXT, PID);
+	const uint32_t count = (MAX(NEXT, PID) - first) / 4 + 1;
+	uint8_t buffer[(MAX(NEXT, PID) - MIN(NEXT, PID)) + 4];
+
+	int retval = linux_read_memory(target, t->base_addr + first, 4, count,
+			buffer);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("read task: unable to read memory");
+		return retval;
+	}
+
+	t->pid = get_buffer(target, buffer + PID - first);
+	*next = get_buffer(target, buffer + NEXT - first) - NEXT;
+	return ERROR_OK;
+}
+
+/*  Reads the fields of a task that are only shown to the user */
+static void linux_task_fetch(struct target *target, struct threads *t,
+	uint32_t fields)
+{
+	if ((fields & LINUX_TASK_INFO) && !(t->valid & LINUX_TASK_INFO))
+		fill_task(target, t);
+	if ((fields & LINUX_TASK_NAME) && !(t->valid & LINUX_TASK_NAME))
+		get_name(target, t);
+}
+
 int get_current(struct target *target, int create)
 {
 	struct target_list *head;
@@ -483,102 +548,6 @@ int get_current(struct target *target, int create)
 	return ERROR_OK;
 }
 
-struct cpu_context *cpu_context_read(struct target *target, uint32_t base_addr,
-	uint32_t *thread_info_addr_old)
-{
-	struct cpu_context *context = calloc(1, sizeof(struct cpu_context));
-	uint32_t preempt_count_addr = 0;
-	uint32_t registers[10];
-	uint8_t *buffer = calloc(1, 4);
-	uint32_t stack = base_addr + QAT;
-	uint32_t thread_info_addr = 0;
-	uint32_t thread_info_addr_update = 0;
-	int retval = ERROR_FAIL;
-	context->R4 = 0xdeadbeef;
-	context->R5 = 0xdeadbeef;
-	context->R6 = 0xdeadbeef;
-	context->R7 = 0xdeadbeef;
-	context->R8 = 0xdeadbeef;
-	context->R9 = 0xdeadbeef;
-	context->IP = 0xdeadbeef;
-	context->FP = 0xdeadbeef;
-	context->SP = 0xdeadbeef;
-	context->PC = 0xdeadbeef;
-retry:
-
-	if (*thread_info_addr_old == 0xdeadbeef) {
-		retval = fill_buffer(target, stack, buffer);
-
-		if (retval == ERROR_OK)
-			thread_info_addr = get_buffer(target, buffer);
-		else
-			LOG_ERROR("cpu_context: unable to read memory");
-
-		thread_info_addr_update = thread_info_addr;
-	} else
-		thread_info_addr = *thread_info_addr_old;
-
-	preempt_count_addr = thread_info_addr + PREEMPT;
-	retval = fill_buffer(target, preempt_count_addr, buffer);
-
-	if (retval == ERROR_OK)
-		context->preempt_count = get_buffer(target, buffer);
-	else {
-		if (*thread_info_addr_old != 0xdeadbeef) {
-			LOG_ERROR
-				("cpu_context: cannot read at thread_info_addr");
-
-			if (*thread_info_addr_old < LINUX_USER_KERNEL_BORDER)
-				LOG_INFO
-					("cpu_context : thread_info_addr in userspace!!!");
-
-			*thread_info_addr_old = 0xdeadbeef;
-			goto retry;
-		}
-
-		LOG_ERROR("cpu_context: unable to read memory");
-	}
-
-	thread_info_addr += CPU_CONT;
-
-	retval = linux_read_memory(target, thread_info_addr, 4, 10,
-			(uint8_t *) registers);
-
-	if (retval != ERROR_OK) {
-		free(buffer);
-		LOG_ERROR("cpu_context: unable to read memory\n");
-		return context;
-	}
-
-	context->R4 =
-		target_buffer_get_u32(target, (const uint8_t *)&registers[0]);
-	context->R5 =
-		target_buffer_get_u32(target, (const uint8_t *)&registers[1]);
-	context->R6 =
-		target_buffer_get_u32(target, (const uint8_t *)&registers[2]);
-	context->R7 =
-		target_buffer_get_u32(target, (const uint8_t *)&registers[3]);
-	context->R8 =
-		target_buffer_get_u32(target, (const uint8_t *)&registers[4]);
-	context->R9 =
-		target_buffer_get_u32(target, (const uint8_t *)&registers[5]);
-	context->IP =
-		target_buffer_get_u32(target, (const uint8_t *)&registers[6]);
-	context->FP =
-		target_buffer_get_u32(target, (const uint8_t *)&registers[7]);
-	context->SP =
-		target_buffer_get_u32(target, (const uint8_t *)&registers[8]);
-	context->PC =
-		target_buffer_get_u32(target, (const uint8_t *)&registers[9]);
-
-	if (*thread_info_addr_old == 0xdeadbeef)
-		*thread_info_addr_old = thread_info_addr_update;
-
-	free(buffer);
-
-	return context;
-}
-
 uint32_t next_task(struct target *target, struct threads *t)
 {
 	uint8_t *buffer = calloc(1, 4);
@@ -684,7 +653,7 @@ static int current_base_addr(struct linux_os *linux_os, uint32_t base_addr)
 	return 0;
 }
 
-int linux_get_tasks(struct target *target, int context)
+int linux_get_tasks(struct target *target)
 {
 	int loop = 0;
 	int retval = 0;
@@ -708,9 +677,10 @@ int linux_get_tasks(struct target *target, int context)
 
 	while (((t->base_addr != linux_os->init_task_addr) &&
 		(t->base_addr != 0)) || (loop == 0)) {
+		uint32_t base_addr;
+
 		loop++;
-		fill_task(target, t);
-		retval = get_name(target, t);
+		retval = linux_read_task(target, t, &base_addr);
 
 		if (loop > MAX_THREADS) {
 			free(t);
@@ -737,20 +707,14 @@ int linux_get_tasks(struct target *target, int context)
 
 			linux_os->thread_list =
 				liste_add_task(linux_os->thread_list, t, &last);
-			/* no interest to fill the context if it is a current thread. */
+			/*  name, state and context are read when asked for */
 			linux_os->thread_count++;
 			t->thread_info_addr = 0xdeadbeef;
-
-			if (context)
-				t->context =
-					cpu_context_read(target, t->base_addr,
-						&t->thread_info_addr);
 		} else {
 			/*LOG_INFO("thread %s is a current thread already created",t->name); */
 			free(t);
 		}
 
-		uint32_t base_addr = next_task(target, t);
 		t = calloc(1, sizeof(struct threads));
 		t->base_addr = base_addr;
 	}
@@ -916,7 +880,7 @@ error_handling:
 #endif
 }
 
-static int linux_task_update(struct target *target, int context)
+static int linux_task_update(struct target *target)
 {
 	struct linux_os *linux_os = (struct linux_os *)
 		target->rtos->rtos_specific_params;
@@ -928,6 +892,7 @@ static int linux_task_update(struct target *target, int context)
 	/*thread_list = thread_list->next; skip init_task*/
 	while (thread_list != NULL) {
 		thread_list->status = 0;	/*setting all tasks to dead state*/
+		thread_list->valid &= ~LINUX_TASK_NAME;
 
 		if (thread_list->context) {
 			free(thread_list->context);
@@ -946,6 +911,7 @@ static int linux_task_update(struct target *target, int context)
 	int64_t start = timeval_ms();
 	struct threads *t = calloc(1, sizeof(struct threads));
 	uint32_t previous = 0xdeadbeef;
+	uint32_t next;
 	t->base_addr = linux_os->init_task_addr;
 	retval = get_current(target, 0);
 	/*check that all current threads have been identified  */
@@ -958,9 +924,7 @@ static int linux_task_update(struct target *target, int context)
 		loop++;
 		previous = t->base_addr;
 		/*  read only pid */
-#ifdef PID_CHECK
-		retval = fill_task_pid(target, t);
-#endif
+		retval = linux_read_task(target, t, &next);
 
 		if (retval != ERROR_OK) {
 			free(t);
@@ -990,13 +954,6 @@ static int linux_task_update(struct target *target, int context)
 					thread_list->oncpu = t->oncpu;
 					thread_list->asid = t->asid;
 					*/
-					if (context)
-						thread_list->context =
-							cpu_context_read(target,
-								thread_list->
-								base_addr,
-								&thread_list->
-								thread_info_addr);
 				} else {
 					/*  it is a current thread no need to read context */
 				}
@@ -1011,23 +968,12 @@ static int linux_task_update(struct target *target, int context)
 		}
 
 		if (found == 0) {
-			uint32_t base_addr;
-			fill_task(target, t);
-			get_name(target, t);
 			retval = insert_into_threadlist(target, t);
 			t->thread_info_addr = 0xdeadbeef;
-
-			if (context)
-				t->context =
-					cpu_context_read(target, t->base_addr,
-						&t->thread_info_addr);
-
-			base_addr = next_task(target, t);
 			t = calloc(1, sizeof(struct threads));
-			t->base_addr = base_addr;
 			linux_os->thread_count++;
-		} else
-			t->base_addr = next_task(target, t);
+		}
+		t->base_addr = next;
 	}
 
 	LOG_INFO("update thread done %" PRId64 ", mean%" PRId64 "\n",
@@ -1052,7 +998,7 @@ int linux_gdb_thread_packet(struct target *target,
 		return ERROR_OK;
 	}
 
-	retval = linux_get_tasks(target, 1);
+	retval = linux_get_tasks(target);
 
 	if (retval != ERROR_OK)
 		return ERROR_TARGET_FAILURE;
@@ -1134,6 +1080,8 @@ int linux_thread_extra_info(struct target *target,
 
 	while (temp != NULL) {
 		if (temp->threadid == threadid) {
+			linux_task_fetch(target, temp, LINUX_TASK_NAME);
+
 			char *pid = " PID: ";
 			char *pid_current = "*PID: ";
 			char *name = "Name: ";
@@ -1207,7 +1155,7 @@ int linux_gdb_T_packet(struct connection *connection,
 		return ERROR_OK;
 
 	} else {
-		retval = linux_task_update(target, 1);
+		retval = linux_task_update(target);
 		struct threads *temp = linux_os->thread_list;
 
 		while (temp != NULL) {
@@ -1467,10 +1415,10 @@ static char *linux_ps_command(struct target *target)
 	char *display;
 
 	if (linux_os->threads_lookup == 0)
-		retval = linux_get_tasks(target, 1);
+		retval = linux_get_tasks(target);
 	else {
 		if (linux_os->threads_needs_update != 0)
-			retval = linux_task_update(target, 0);
+			retval = linux_task_update(target);
 	}
 
 	if (retval == ERROR_OK) {
@@ -1489,6 +1437,9 @@ static char *linux_ps_command(struct target *target)
 
 		while (temp != NULL) {
 			if (temp->status) {
+				linux_task_fetch(target, temp,
+					LINUX_TASK_INFO | LINUX_TASK_NAME);
+
 				if (temp->context)
 					tmp +=
 						sprintf(tmp,
@@ -55,6 +55,12 @@ static struct rtos_type *rtos_types[] = {
 };
 
 int rtos_thread_packet(struct connection *connection, const char *packet, int packet_size);
+static void rtos_snapshot_free(struct rtos *rtos);
+static void rtos_free_thread_regs(struct rtos *rtos);
+static int rtos_event_callback(struct target *target, enum target_event event, void *priv);
+
+/* Returned by rtos_generic_stack_read() while the frames are collected */
+#define RTOS_STACK_READ_QUEUED	(-41)
 
 int rtos_smp_init(struct target *target)
 {
@@ -89,6 +95,8 @@ static int os_alloc(struct target *target, struct rtos_type *ostype)
 	os->gdb_thread_packet = rtos_thread_packet;
 	os->gdb_target_for_threadid = rtos_target_for_threadid;
 
+	target_register_event_callback(rtos_event_callback, os);
+
 	return JIM_OK;
 }
 
@@ -100,6 +108,9 @@ static void os_free(struct target *target)
 	if (target->rtos->symbols)
 		free(target->rtos->symbols);
 
+	target_unregister_event_callback(rtos_event_callback, target->rtos);
+	rtos_free_thread_regs(target->rtos);
+	rtos_snapshot_free(target->rtos);
 	free(target->rtos);
 	target->rtos = NULL;
 }
@@ -356,7 +367,7 @@ int rtos_thread_packet(struct connection *connection, char const *packet, int pa
 				target->rtos_auto_detect = false;
 				target->rtos->type->create(target);
 			}
-			target->rtos->type->update_threads(target->rtos);
+			rtos_update_threads(target);
 		}
 		return ERROR_OK;
 	} else if (strncmp(packet, "qfThreadInfo", 12) == 0) {
@@ -462,6 +473,173 @@ static int rtos_put_gdb_reg_list(struct connection *connection,
 	return ERROR_OK;
 }
 
+static void rtos_free_thread_regs(struct rtos *rtos)
+{
+	for (int i = 0; i < rtos->thread_regs_count; i++)
+		free(rtos->thread_regs[i].reg_list);
+	free(rtos->thread_regs);
+	rtos->thread_regs = NULL;
+	rtos->thread_regs_count = 0;
+	rtos->thread_regs_valid = false;
+}
+
+static int rtos_event_callback(struct target *target, enum target_event event, void *priv)
+{
+	struct rtos *rtos = priv;
+
+	if (target->rtos == rtos && event == TARGET_EVENT_RESUMED)
+		rtos_free_thread_regs(rtos);
+	return ERROR_OK;
+}
+
+static int rtos_decode_stack(struct target *target,
+	const struct rtos_register_stacking *stacking,
+	int64_t stack_ptr, const uint8_t *stack_data,
+	struct rtos_reg **reg_list, int *num_regs);
+
+/* Reads the stacked frames of all collected threads, as one queued
+ * transaction if the target supports it. */
+static void rtos_read_thread_frames(struct rtos *rtos, uint8_t **frames)
+{
+	struct target *target = rtos->target;
+	struct target_mem_op *ops = NULL;
+	unsigned count = 0;
+
+	for (int i = 0; i < rtos->thread_regs_count; i++) {
+		const struct rtos_register_stacking *stacking = rtos->thread_regs[i].stacking;
+		count += DIV_ROUND_UP(stacking->stack_registers_size, 4);
+	}
+
+	ops = malloc(count * sizeof(*ops));
+	count = 0;
+	for (int i = 0; ops && i < rtos->thread_regs_count; i++) {
+		struct rtos_thread_regs *t = &rtos->thread_regs[i];
+		uint32_t size = t->stacking->stack_registers_size;
+		uint32_t address = t->stack_ptr;
+
+		if (t->stacking->stack_growth_direction == 1)
+			address -= size;
+		/* only whole aligned words can be queued */
+		if ((address | size) & 3)
+			continue;
+		for (uint32_t offset = 0; offset < size; offset += 4) {
+			ops[count++] = (struct target_mem_op) {
+				.size = 4,
+				.address = address + offset,
+			};
+		}
+	}
+
+	unsigned failed;
+	bool queued = ops && count &&
+		target_run_mem_ops(target, ops, count, &failed) == ERROR_OK;
+
+	struct target_mem_op *op = ops;
+	for (int i = 0; i < rtos->thread_regs_count; i++) {
+		struct rtos_thread_regs *t = &rtos->thread_regs[i];
+		uint32_t size = t->stacking->stack_registers_size;
+		uint32_t address = t->stack_ptr;
+
+		if (t->stacking->stack_growth_direction == 1)
+			address -= size;
+
+		frames[i] = malloc(size);
+		if (!frames[i])
+			continue;
+
+		if (queued && !((address | size) & 3)) {
+			for (uint32_t offset = 0; offset < size; offset += 4, op++)
+				target_buffer_set_u32(target, frames[i] + offset, op->value);
+		} else if (target_read_buffer(target, address, size, frames[i]) != ERROR_OK) {
+			free(frames[i]);
+			frames[i] = NULL;
+		}
+	}
+
+	free(ops);
+}
+
+/* Collects the stack frame location of every thread but the running one
+ * through the backend, then reads and decodes all frames together. */
+static void rtos_prefetch_thread_regs(struct rtos *rtos)
+{
+	struct target *target = rtos->target;
+
+	rtos_free_thread_regs(rtos);
+	rtos->thread_regs_valid = true;
+
+	if (!rtos->thread_details || rtos->thread_count <= 0)
+		return;
+
+	rtos->thread_regs = calloc(rtos->thread_count, sizeof(*rtos->thread_regs));
+	if (!rtos->thread_regs)
+		return;
+
+	for (int i = 0; i < rtos->thread_count; i++) {
+		threadid_t threadid = rtos->thread_details[i].threadid;
+		if (threadid == rtos->current_thread && !target->smp)
+			continue;
+
+		struct rtos_thread_regs *t = &rtos->thread_regs[rtos->thread_regs_count];
+		struct rtos_reg *reg_list = NULL;
+		int num_regs;
+
+		t->threadid = threadid;
+		rtos->queue_stack_read = t;
+		int retval = rtos->type->get_thread_reg_list(rtos, threadid, &reg_list, &num_regs);
+		rtos->queue_stack_read = NULL;
+
+		if (retval == RTOS_STACK_READ_QUEUED) {
+			rtos->thread_regs_count++;
+		} else if (retval == ERROR_OK) {
+			/* the backend does not read stacked frames; it is asked
+			 * per thread as before */
+			free(reg_list);
+			break;
+		}
+	}
+
+	uint8_t **frames = calloc(rtos->thread_regs_count, sizeof(*frames));
+	if (!frames) {
+		rtos->thread_regs_count = 0;
+		return;
+	}
+
+	rtos_read_thread_frames(rtos, frames);
+
+	for (int i = 0; i < rtos->thread_regs_count; i++) {
+		struct rtos_thread_regs *t = &rtos->thread_regs[i];
+		if (frames[i])
+			rtos_decode_stack(target, t->stacking, t->stack_ptr, frames[i],
+					&t->reg_list, &t->num_regs);
+		free(frames[i]);
+	}
+	free(frames);
+}
+
+static int rtos_get_thread_reg_list(struct rtos *rtos, threadid_t threadid,
+		struct rtos_reg **reg_list, int *num_regs)
+{
+	if (!rtos->thread_regs_valid)
+		rtos_prefetch_thread_regs(rtos);
+
+	for (int i = 0; i < rtos->thread_regs_count; i++) {
+		struct rtos_thread_regs *t = &rtos->thread_regs[i];
+		if (t->threadid != threadid || !t->reg_list)
+			continue;
+
+		*reg_list = malloc(t->num_regs * sizeof(**reg_list));
+		if (!*reg_list)
+			break;
+		memcpy(*reg_list, t->reg_list, t->num_regs * sizeof(**reg_list));
+		*num_regs = t->num_regs;
+		return ERROR_OK;
+	}
+
+	/* a thread whose frame could not be read reports its own error */
+	return rtos->type->get_thread_reg_list(rtos, threadid, reg_list, num_regs);
+}
+
 int rtos_get_gdb_reg(struct connection *connection, int reg_num)
 {
 	struct target *target = get_target_from_connection(connection);
@@ -479,7 +657,7 @@ int rtos_get_gdb_reg(struct connection *connection, int reg_num)
 										current_threadid,
 										target->rtos->current_thread);
 
-		int retval = target->rtos->type->get_thread_reg_list(target->rtos,
+		int retval = rtos_get_thread_reg_list(target->rtos,
 				current_threadid,
 				&reg_list,
 				&num_regs);
@@ -517,7 +695,7 @@ int rtos_get_gdb_reg_list(struct connection *connection)
 										current_threadid,
 										target->rtos->current_thread);
 
-		int retval = target->rtos->type->get_thread_reg_list(target->rtos,
+		int retval = rtos_get_thread_reg_list(target->rtos,
 				current_threadid,
 				&reg_list,
 				&num_regs);
@@ -546,6 +724,14 @@ int rtos_generic_stack_read(struct target *target,
 		LOG_ERROR("Error: null stack pointer in thread");
 		return -5;
 	}
+
+	struct rtos_thread_regs *queued = target->rtos ? target->rtos->queue_stack_read : NULL;
+	if (queued) {
+		queued->stacking = stacking;
+		queued->stack_ptr = stack_ptr;
+		return RTOS_STACK_READ_QUEUED;
+	}
+
 	/* Read the stack */
 	uint8_t *stack_data = malloc(stacking->stack_registers_size);
 	uint32_t address = stack_ptr;
@@ -567,6 +753,16 @@ int rtos_generic_stack_read(struct target *target,
 		LOG_OUTPUT("\r\n");
 #endif
 
+	retval = rtos_decode_stack(target, stacking, stack_ptr, stack_data, reg_list, num_regs);
+	free(stack_data);
+	return retval;
+}
+
+static int rtos_decode_stack(struct target *target,
+	const struct rtos_register_stacking *stacking,
+	int64_t stack_ptr, const uint8_t *stack_data,
+	struct rtos_reg **reg_list, int *num_regs)
+{
 	int64_t new_stack_ptr;
 	if (stacking->calculate_process_stack != NULL) {
 		new_stack_ptr = stacking->calculate_process_stack(target,
@@ -590,7 +786,6 @@ int rtos_generic_stack_read(struct target *target,
 			buf_cpy(stack_data + offset, (*reg_list)[i].value, (*reg_list)[i].size);
 	}
 
-	free(stack_data);
 /*	LOG_OUTPUT("Output register string: %s\r\n", *hex_reg_list); */
 	return ERROR_OK;
 }
@@ -610,6 +805,7 @@ int rtos_try_next(struct target *target)
 		return 0;
 
 	os->type = *type;
+	rtos_free_thread_regs(os);
 	if (os->symbols) {
 		free(os->symbols);
 		os->symbols = NULL;
@@ -618,10 +814,192 @@ int rtos_try_next(struct target *target)
 	return 1;
 }
 
+/* Snapshot blocks are aligned to this and at least RTOS_SNAPSHOT_BLOCK long,
+ * which covers a typical TCB together with the list node inside it. */
+#define RTOS_SNAPSHOT_ALIGN		32
+#define RTOS_SNAPSHOT_BLOCK		256
+
+static void rtos_snapshot_free_threads(struct rtos_snapshot_thread *threads,
+		unsigned count)
+{
+	for (unsigned i = 0; i < count; i++)
+		free(threads[i].name);
+	free(threads);
+}
+
+static void rtos_snapshot_begin(struct rtos *rtos)
+{
+	struct rtos_snapshot *snapshot = &rtos->snapshot;
+
+	/* the names recorded last time can be reused by this update */
+	rtos_snapshot_free_threads(snapshot->previous, snapshot->num_previous);
+	snapshot->previous = snapshot->threads;
+	snapshot->num_previous = snapshot->num_threads;
+	snapshot->threads = NULL;
+	snapshot->num_threads = 0;
+	snapshot->alloc_threads = 0;
+}
+
+/* Target memory may change once the target runs again, so only names
+ * recorded with their key survive an update. */
+static void rtos_snapshot_end(struct rtos *rtos)
+{
+	struct rtos_snapshot *snapshot = &rtos->snapshot;
+
+	for (unsigned i = 0; i < snapshot->num_blocks; i++)
+		free(snapshot->blocks[i].data);
+	snapshot->num_blocks = 0;
+
+	rtos_snapshot_free_threads(snapshot->previous, snapshot->num_previous);
+	snapshot->previous = NULL;
+	snapshot->num_previous = 0;
+}
+
+static void rtos_snapshot_free(struct rtos *rtos)
+{
+	struct rtos_snapshot *snapshot = &rtos->snapshot;
+
+	rtos_snapshot_end(rtos);
+	free(snapshot->blocks);
+	rtos_snapshot_free_threads(snapshot->threads, snapshot->num_threads);
+	memset(snapshot, 0, sizeof(*snapshot));
+}
+
+/**
+ * Reads @a size bytes at @a address in one target access and keeps them
+ * for rtos_snapshot_read() until the end of the current update.
+ */
+int rtos_snapshot_prefetch(struct rtos *rtos, symbol_address_t address, uint32_t size)
+{
+	struct rtos_snapshot *snapshot = &rtos->snapshot;
+
+	if (snapshot->num_blocks == snapshot->alloc_blocks) {
+		unsigned alloc = snapshot->alloc_blocks ? 2 * snapshot->alloc_blocks : 32;
+		struct rtos_snapshot_block *blocks = realloc(snapshot->blocks,
+				alloc * sizeof(*blocks));
+		if (!blocks) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+		snapshot->blocks = blocks;
+		snapshot->alloc_blocks = alloc;
+	}
+
+	uint8_t *data = malloc(size);
+	if (!data) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	int retval = target_read_buffer(rtos->target, address, size, data);
+	if (retval != ERROR_OK) {
+		free(data);
+		return retval;
+	}
+
+	snapshot->blocks[snapshot->num_blocks++] = (struct rtos_snapshot_block) {
+		.address = address,
+		.size = size,
+		.data = data,
+	};
+	return ERROR_OK;
+}
+
+/**
+ * Drop-in replacement for target_read_buffer() in update_threads methods.
+ * A miss reads a whole aligned block around the request, so neighbouring
+ * fields are served from memory on the next call.
+ */
+int rtos_snapshot_read(struct rtos *rtos, symbol_address_t address, uint32_t size,
+		uint8_t *buffer)
+{
+	struct rtos_snapshot *snapshot = &rtos->snapshot;
+
+	/* recent blocks are the most likely to match */
+	for (unsigned i = snapshot->num_blocks; i-- > 0; ) {
+		struct rtos_snapshot_block *b = &snapshot->blocks[i];
+		if (address >= b->address && address + size <= b->address + b->size) {
+			memcpy(buffer, b->data + (address - b->address), size);
+			return ERROR_OK;
+		}
+	}
+
+	symbol_address_t start = address & ~(symbol_address_t)(RTOS_SNAPSHOT_ALIGN - 1);
+	symbol_address_t end = (address + size + RTOS_SNAPSHOT_ALIGN - 1) &
+			~(symbol_address_t)(RTOS_SNAPSHOT_ALIGN - 1);
+	if (end - start < RTOS_SNAPSHOT_BLOCK)
+		end = start + RTOS_SNAPSHOT_BLOCK;
+
+	/* the block may reach past the end of RAM; then read what was asked */
+	if (rtos_snapshot_prefetch(rtos, start, end - start) != ERROR_OK &&
+			rtos_snapshot_prefetch(rtos, address, size) != ERROR_OK)
+		return target_read_buffer(rtos->target, address, size, buffer);
+
+	struct rtos_snapshot_block *b = &snapshot->blocks[snapshot->num_blocks - 1];
+	memcpy(buffer, b->data + (address - b->address), size);
+	return ERROR_OK;
+}
+
+/**
+ * Returns the name recorded for @a threadid by the previous update if it
+ * was recorded with the same @a key, e.g. the address of the name, so the
+ * caller can skip reading it.  Valid until the update returns.
+ */
+const char *rtos_snapshot_lookup_name(struct rtos *rtos, threadid_t threadid, uint64_t key)
+{
+	struct rtos_snapshot *snapshot = &rtos->snapshot;
+	unsigned hint = snapshot->num_threads;
+
+	/* threads are usually found in the same order as last time */
+	if (hint < snapshot->num_previous && snapshot->previous[hint].threadid == threadid)
+		return snapshot->previous[hint].key == key ? snapshot->previous[hint].name : NULL;
+
+	for (unsigned i = 0; i < snapshot->num_previous; i++) {
+		if (snapshot->previous[i].threadid == threadid)
+			return snapshot->previous[i].key == key ? snapshot->previous[i].name : NULL;
+	}
+	return NULL;
+}
+
+int rtos_snapshot_record_name(struct rtos *rtos, threadid_t threadid, uint64_t key,
+		const char *name)
+{
+	struct rtos_snapshot *snapshot = &rtos->snapshot;
+
+	if (snapshot->num_threads == snapshot->alloc_threads) {
+		unsigned alloc = snapshot->alloc_threads ? 2 * snapshot->alloc_threads : 16;
+		struct rtos_snapshot_thread *threads = realloc(snapshot->threads,
+				alloc * sizeof(*threads));
+		if (!threads) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+		snapshot->threads = threads;
+		snapshot->alloc_threads = alloc;
+	}
+
+	char *copy = strdup(name);
+	if (!copy) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	snapshot->threads[snapshot->num_threads++] = (struct rtos_snapshot_thread) {
+		.threadid = threadid,
+		.key = key,
+		.name = copy,
+	};
+	return ERROR_OK;
+}
+
 int rtos_update_threads(struct target *target)
 {
-	if ((target->rtos != NULL) && (target->rtos->type != NULL))
+	if ((target->rtos != NULL) && (target->rtos->type != NULL)) {
+		rtos_free_thread_regs(target->rtos);
+		rtos_snapshot_begin(target->rtos);
 		target->rtos->type->update_threads(target->rtos);
+		rtos_snapshot_end(target->rtos);
+	}
 	return ERROR_OK;
 }
 
@@ -43,6 +43,43 @@ struct thread_detail {
 	char *extra_info_str;
 };
 
+/**
+ * Memory read during one thread list update, kept in blocks so that the
+ * fields of a TCB and its list nodes come from a single target read, and
+ * the thread names of the previous update for reuse.
+ */
+struct rtos_snapshot_block {
+	symbol_address_t address;
+	uint32_t size;
+	uint8_t *data;
+};
+
+struct rtos_snapshot_thread {
+	threadid_t threadid;
+	uint64_t key;
+	char *name;
+};
+
+struct rtos_snapshot {
+	struct rtos_snapshot_block *blocks;
+	unsigned num_blocks;
+	unsigned alloc_blocks;
+	struct rtos_snapshot_thread *threads;
+	unsigned num_threads;
+	unsigned alloc_threads;
+	struct rtos_snapshot_thread *previous;
+	unsigned num_previous;
+};
+
+/* Register list of one thread, decoded from its stacked frame */
+struct rtos_thread_regs {
+	threadid_t threadid;
+	const struct rtos_register_stacking *stacking;
+	int64_t stack_ptr;
+	struct rtos_reg *reg_list;
+	int num_regs;
+};
+
 struct rtos {
 	const struct rtos_type *type;
 
@@ -56,6 +93,13 @@ struct rtos {
 	int (*gdb_thread_packet)(struct connection *connection, char const *packet, int packet_size);
 	int (*gdb_target_for_threadid)(struct connection *connection, int64_t thread_id, struct target **p_target);
 	void *rtos_specific_params;
+	struct rtos_snapshot snapshot;
+	/* register lists of the other threads, read together on the first
+	 * request after a halt and kept until the target resumes */
+	struct rtos_thread_regs *thread_regs;
+	int thread_regs_count;
+	bool thread_regs_valid;
+	struct rtos_thread_regs *queue_stack_read;
 };
 
 struct rtos_reg {
@@ -116,6 +160,12 @@ int rtos_get_gdb_reg_list(struct connection *connection);
 int rtos_update_threads(struct target *target);
 void rtos_free_threadlist(struct rtos *rtos);
 int rtos_smp_init(struct target *target);
+int rtos_snapshot_prefetch(struct rtos *rtos, symbol_address_t address, uint32_t size);
+int rtos_snapshot_read(struct rtos *rtos, symbol_address_t address, uint32_t size,
+		uint8_t *buffer);
+const char *rtos_snapshot_lookup_name(struct rtos *rtos, threadid_t threadid, uint64_t key);
+int rtos_snapshot_record_name(struct rtos *rtos, threadid_t threadid, uint64_t key,
+		const char *name);
 /*  function for handling symbol access */
 int rtos_qsymbol(struct connection *connection, char const *packet, int packet_size);
 
@@ -0,0 +1,152 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "rtt_server.h"
+#include <target/rtt.h>
+
+/* Each service forwards one RTT channel: up-channel data goes to every
+ * connection, and data received from a connection goes into the
+ * down-channel of the same number. */
+struct rtt_service {
+	unsigned channel;
+};
+
+static int rtt_server_sink(unsigned channel, const uint8_t *buf,
+		size_t length, void *priv)
+{
+	struct connection *connection = priv;
+
+	connection_write(connection, buf, length);
+	return ERROR_OK;
+}
+
+static int rtt_new_connection(struct connection *connection)
+{
+	struct rtt_service *service = connection->service->priv;
+
+	return rtt_register_sink(service->channel, rtt_server_sink, connection);
+}
+
+static int rtt_input(struct connection *connection)
+{
+	struct rtt_service *service = connection->service->priv;
+	uint8_t buf[256];
+
+	int length = connection_read(connection, buf, sizeof(buf));
+	if (length <= 0) {
+		if (length < 0)
+			LOG_ERROR("error during read: %s", strerror(errno));
+		return ERROR_SERVER_REMOTE_CLOSED;
+	}
+
+	if (!rtt_started())
+		return ERROR_OK;
+
+	size_t written = length;
+	if (rtt_write_channel(service->channel, buf, &written) != ERROR_OK)
+		return ERROR_OK;
+	if (written < (size_t)length)
+		LOG_DEBUG("rtt: down-channel %u full, dropped %zu bytes",
+				service->channel, length - written);
+
+	return ERROR_OK;
+}
+
+static int rtt_connection_closed(struct connection *connection)
+{
+	struct rtt_service *service = connection->service->priv;
+
+	rtt_unregister_sink(service->channel, rtt_server_sink, connection);
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_rtt_server_start_command)
+{
+	if (CMD_ARGC != 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	unsigned channel;
+	COMMAND_PARSE_NUMBER(uint, CMD_ARGV[1], channel);
+
+	struct rtt_service *service = malloc(sizeof(*service));
+	if (!service) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+	service->channel = channel;
+
+	int retval = add_service("rtt", CMD_ARGV[0], CONNECTION_LIMIT_UNLIMITED,
+			rtt_new_connection, rtt_input, rtt_connection_closed, service);
+	if (retval != ERROR_OK)
+		free(service);
+	return retval;
+}
+
+COMMAND_HANDLER(handle_rtt_server_stop_command)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	return remove_service("rtt", CMD_ARGV[0]);
+}
+
+static const struct command_registration rtt_server_subcommand_handlers[] = {
+	{
+		.name = "start",
+		.handler = handle_rtt_server_start_command,
+		.mode = COMMAND_ANY,
+		.help = "serve an RTT channel on a TCP port",
+		.usage = "port channel",
+	},
+	{
+		.name = "stop",
+		.handler = handle_rtt_server_stop_command,
+		.mode = COMMAND_ANY,
+		.help = "stop serving RTT on a TCP port",
+		.usage = "port",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static const struct command_registration rtt_server_command_handlers[] = {
+	{
+		.name = "server",
+		.mode = COMMAND_ANY,
+		.help = "RTT server command group",
+		.usage = "",
+		.chain = rtt_server_subcommand_handlers,
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static const struct command_registration rtt_command_handlers[] = {
+	{
+		.name = "rtt",
+		.mode = COMMAND_ANY,
+		.help = "Real-Time Transfer command group",
+		.usage = "",
+		.chain = rtt_server_command_handlers,
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+int rtt_server_register_commands(struct command_context *cmd_ctx)
+{
+	return register_commands(cmd_ctx, NULL, rtt_command_handlers);
+}
@@ -33,6 +33,10 @@
 #include "svf.h"
 #include <helper/time_support.h>
 
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+
 /* SVF command */
 enum svf_command {
 	ENDDR,
@@ -224,6 +228,14 @@ static size_t svf_command_buffer_size;
 static int svf_line_number;
 static int svf_getline(char **lineptr, size_t *n, FILE *stream);
 
+/* The file is read in large blocks and split into lines in memory, rather
+ * than one fgetc() per character. */
+#define SVF_READ_BUFFER_SIZE	(256 * 1024)
+static char *svf_read_buffer;
+static size_t svf_read_buffer_pos, svf_read_buffer_len;
+static uint64_t svf_bytes_read;
+static uint64_t svf_scan_bits;
+
 #define SVF_MAX_BUFFER_SIZE_TO_COMMIT   (1024 * 1024)
 static uint8_t *svf_tdi_buffer, *svf_tdo_buffer, *svf_mask_buffer;
 static int svf_buffer_index, svf_buffer_size ;
@@ -237,7 +249,7 @@ static int svf_set_padding(struct svf_xxr_para *para, int len, unsigned char tdi
 
 /* Progress Indicator */
 static int svf_progress_enabled;
-static long svf_total_lines;
+static uint64_t svf_file_size;
 static int svf_percentage;
 static int svf_last_printed_percentage = -1;
 
@@ -418,6 +430,19 @@ COMMAND_HANDLER(handle_svf_command)
 	/* init */
 	svf_line_number = 0;
 	svf_command_buffer_size = 0;
+	svf_read_buffer_pos = 0;
+	svf_read_buffer_len = 0;
+	svf_bytes_read = 0;
+	svf_scan_bits = 0;
+	svf_file_size = 0;
+	svf_last_printed_percentage = -1;
+
+	svf_read_buffer = malloc(SVF_READ_BUFFER_SIZE);
+	if (NULL == svf_read_buffer) {
+		LOG_ERROR("not enough memory");
+		ret = ERROR_FAIL;
+		goto free_all;
+	}
 
 	svf_check_tdo_para_index = 0;
 	svf_check_tdo_para = malloc(sizeof(struct svf_check_tdo_para) * SVF_CHECK_TDO_PARA_SIZE);
@@ -489,28 +514,34 @@ COMMAND_HANDLER(handle_svf_command)
 	}
 
 	if (svf_progress_enabled) {
-		/* Count total lines in file. */
-		while (!feof(svf_fd)) {
-			svf_getline(&svf_command_buffer, &svf_command_buffer_size, svf_fd);
-			svf_total_lines++;
-		}
+		/* Progress is tracked in bytes consumed, so the file needs
+		 * no extra pass to count its lines. */
+		long size;
+		if (fseek(svf_fd, 0, SEEK_END) == 0 && (size = ftell(svf_fd)) > 0)
+			svf_file_size = size;
 		rewind(svf_fd);
 	}
+#if defined(HAVE_FCNTL_H) && defined(POSIX_FADV_SEQUENTIAL)
+	/* let the kernel read ahead while the JTAG queue is executing */
+	posix_fadvise(fileno(svf_fd), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
 	while (ERROR_OK == svf_read_command_from_file(svf_fd)) {
 		/* Log Output */
+		if (svf_progress_enabled && svf_file_size)
+			svf_percentage = ((svf_bytes_read * 20) / svf_file_size) * 5;
 		if (svf_quiet) {
 			if (svf_progress_enabled) {
-				svf_percentage = ((svf_line_number * 20) / svf_total_lines) * 5;
 				if (svf_last_printed_percentage != svf_percentage) {
-					LOG_USER_N("\r%d%%    ", svf_percentage);
+					int64_t elapsed_ms = timeval_ms() - time_measure_ms;
+					LOG_USER_N("\r%d%%  %" PRIu64 " kB/s    ", svf_percentage,
+						elapsed_ms ? svf_bytes_read / elapsed_ms : 0);
 					svf_last_printed_percentage = svf_percentage;
 				}
 			}
 		} else {
-			if (svf_progress_enabled) {
-				svf_percentage = ((svf_line_number * 20) / svf_total_lines) * 5;
+			if (svf_progress_enabled)
 				LOG_USER_N("%3d%%  %s", svf_percentage, svf_read_line);
-			} else
+			else
 				LOG_USER_N("%s", svf_read_line);
 		}
 		/* Run Command */
@@ -529,6 +560,12 @@ COMMAND_HANDLER(handle_svf_command)
 
 	/* print time */
 	time_measure_ms = timeval_ms() - time_measure_ms;
+	if (svf_progress_enabled && time_measure_ms > 0)
+		command_print(CMD,
+			"\r\nParsed %" PRIu64 " bytes (%" PRIu64 " kB/s), "
+			"shifted %" PRIu64 " scan bits (%" PRIu64 " kbit/s)",
+			svf_bytes_read, svf_bytes_read / time_measure_ms,
+			svf_scan_bits, svf_scan_bits / time_measure_ms);
 	time_measure_s = time_measure_ms / 1000;
 	time_measure_ms %= 1000;
 	time_measure_m = time_measure_s / 60;
@@ -546,6 +583,10 @@ free_all:
 	svf_fd = 0;
 
 	/* free buffers */
+	if (svf_read_buffer) {
+		free(svf_read_buffer);
+		svf_read_buffer = NULL;
+	}
 	if (svf_command_buffer) {
 		free(svf_command_buffer);
 		svf_command_buffer = NULL;
@@ -593,32 +634,48 @@ free_all:
 
 static int svf_getline(char **lineptr, size_t *n, FILE *stream)
 {
-#define MIN_CHUNK 16	/* Buffer is increased by this size each time as required */
 	size_t i = 0;
 
-	if (*lineptr == NULL) {
-		*n = MIN_CHUNK;
-		*lineptr = malloc(*n);
-		if (!*lineptr)
-			return -1;
+	for (;;) {
+		if (svf_read_buffer_pos == svf_read_buffer_len) {
+			svf_read_buffer_len = fread(svf_read_buffer, 1, SVF_READ_BUFFER_SIZE, stream);
+			svf_read_buffer_pos = 0;
+			if (svf_read_buffer_len == 0)
+				break;
+		}
+
+		const char *start = svf_read_buffer + svf_read_buffer_pos;
+		size_t avail = svf_read_buffer_len - svf_read_buffer_pos;
+		const char *eol = memchr(start, '\n', avail);
+		size_t len = eol ? (size_t)(eol - start) + 1 : avail;
+
+		/* grow geometrically, long bitstream lines are common */
+		if (i + len + 1 > *n) {
+			size_t size = MAX(2 * *n, i + len + 1);
+			char *ptr = realloc(*lineptr, size);
+			if (!ptr)
+				return -1;
+			*lineptr = ptr;
+			*n = size;
+		}
+
+		memcpy(*lineptr + i, start, len);
+		i += len;
+		svf_read_buffer_pos += len;
+		svf_bytes_read += len;
+		if (eol)
+			break;
 	}
 
-	(*lineptr)[0] = fgetc(stream);
-	while ((*lineptr)[i] != '\n') {
-		(*lineptr)[++i] = fgetc(stream);
-		if (feof(stream)) {
+	if (i == 0) {
+		if (*lineptr)
 			(*lineptr)[0] = 0;
-			return -1;
-		}
-		if ((i + 2) > *n) {
-			*n += MIN_CHUNK;
-			*lineptr = realloc(*lineptr, *n);
-		}
+		return -1;
 	}
 
-	(*lineptr)[++i] = 0;
+	(*lineptr)[i] = 0;
 
-	return sizeof(*lineptr);
+	return i;
 }
 
 #define SVFP_CMD_INC_CNT 1024
@@ -682,8 +739,8 @@ static int svf_read_command_from_file(FILE *fd)
 				 *  - terminating NUL ('\0')
 				 */
 				if (cmd_pos + 3 > svf_command_buffer_size) {
-					svf_command_buffer = realloc(svf_command_buffer, cmd_pos + 3);
-					svf_command_buffer_size = cmd_pos + 3;
+					svf_command_buffer_size = cmd_pos + 3 + MAX(cmd_pos, SVFP_CMD_INC_CNT);
+					svf_command_buffer = realloc(svf_command_buffer, svf_command_buffer_size);
 					if (svf_command_buffer == NULL) {
 						LOG_ERROR("not enough memory");
 						return ERROR_FAIL;
@@ -798,53 +855,61 @@ static int svf_set_padding(struct svf_xxr_para *para, int len, unsigned char tdi
 	return error;
 }
 
+/* svf_hex_digit[] holds nibble value + 1 for hex digits, 0 for anything
+ * that is neither a hex digit nor whitespace */
+#define SVF_HEX_SPACE	0x80
+static const uint8_t svf_hex_digit[256] = {
+	['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5,
+	['5'] = 6, ['6'] = 7, ['7'] = 8, ['8'] = 9, ['9'] = 10,
+	['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+	[' '] = SVF_HEX_SPACE, ['\t'] = SVF_HEX_SPACE, ['\n'] = SVF_HEX_SPACE,
+	['\v'] = SVF_HEX_SPACE, ['\f'] = SVF_HEX_SPACE, ['\r'] = SVF_HEX_SPACE,
+};
+
+/* Take the next nibble from the end of str, skipping whitespace.  Returns 0
+ * once the string is exhausted and -1 for a character that is not hex. */
+static inline int svf_hex_nibble(const char *str, int *str_len)
+{
+	while (*str_len > 0) {
+		uint8_t v = svf_hex_digit[(uint8_t)str[--*str_len]];
+
+		/* Skip whitespace.  The SVF specification (rev E) is
+		 * deficient in terms of basic lexical issues like
+		 * where whitespace is allowed.  Long bitstrings may
+		 * require line ends for correctness, since there is
+		 * a hard limit on line length.
+		 */
+		if (v != SVF_HEX_SPACE)
+			return v - 1;
+	}
+	return 0;
+}
+
 static int svf_copy_hexstring_to_binary(char *str, uint8_t **bin, int orig_bit_len, int bit_len)
 {
 	int i, str_len = strlen(str), str_hbyte_len = (bit_len + 3) >> 2;
-	uint8_t ch = 0;
+	int lsb, msb = 0, ch = 0;
 
 	if (ERROR_OK != svf_adjust_array_length(bin, orig_bit_len, bit_len)) {
 		LOG_ERROR("fail to adjust length of array");
 		return ERROR_FAIL;
 	}
 
-	/* fill from LSB (end of str) to MSB (beginning of str) */
-	for (i = 0; i < str_hbyte_len; i++) {
-		ch = 0;
-		while (str_len > 0) {
-			ch = str[--str_len];
-
-			/* Skip whitespace.  The SVF specification (rev E) is
-			 * deficient in terms of basic lexical issues like
-			 * where whitespace is allowed.  Long bitstrings may
-			 * require line ends for correctness, since there is
-			 * a hard limit on line length.
-			 */
-			if (!isspace(ch)) {
-				if ((ch >= '0') && (ch <= '9')) {
-					ch = ch - '0';
-					break;
-				} else if ((ch >= 'A') && (ch <= 'F')) {
-					ch = ch - 'A' + 10;
-					break;
-				} else {
-					LOG_ERROR("invalid hex string");
-					return ERROR_FAIL;
-				}
-			}
-
-			ch = 0;
+	/* fill from LSB (end of str) to MSB (beginning of str), a byte at a time */
+	for (i = 0; i < str_hbyte_len; i += 2) {
+		lsb = svf_hex_nibble(str, &str_len);
+		ch = lsb;
+		if (i + 1 < str_hbyte_len) {
+			msb = svf_hex_nibble(str, &str_len);
+			ch = msb;
+		} else
+			msb = 0;
+		if (lsb < 0 || msb < 0) {
+			LOG_ERROR("invalid hex string");
+			return ERROR_FAIL;
 		}
 
-		/* write bin */
-		if (i % 2) {
-			/* MSB */
-			(*bin)[i / 2] |= ch << 4;
-		} else {
-			/* LSB */
-			(*bin)[i / 2] = 0;
-			(*bin)[i / 2] |= ch;
-		}
+		(*bin)[i / 2] = (msb << 4) | lsb;
 	}
 
 	/* consume optional leading '0' MSBs or whitespace */
@@ -1214,6 +1279,7 @@ XXR_common:
 				}
 
 				svf_buffer_index += (i + 7) >> 3;
+				svf_scan_bits += i;
 			} else if (SIR == command) {
 				/* check buffer size first, reallocate if necessary */
 				i = svf_para.hir_para.len + svf_para.sir_para.len +
@@ -1304,6 +1370,7 @@ XXR_common:
 				}
 
 				svf_buffer_index += (i + 7) >> 3;
+				svf_scan_bits += i;
 			}
 			break;
 		case PIO:
@@ -314,41 +314,102 @@ static int aarch64_wait_halt_one(struct target *target)
 	return retval;
 }
 
+/*
+ * The SMP group operations queue the same accesses on all PEs and run
+ * the DAP queues once per step, so the cost of halting or restarting a
+ * group does not grow with a round trip per PE, and the PEs are polled
+ * at the same time.
+ */
+
+/* Reads PRSR of all examined PEs of the group into smp_prsr */
+static int aarch64_read_prsr_smp(struct target *target)
+{
+	struct adiv5_dap_set daps = { .count = 0 };
+	struct target_list *head;
+	int retval = ERROR_OK;
+
+	foreach_smp_target(head, target->head) {
+		struct target *curr = head->target;
+		struct aarch64_common *a64 = target_to_aarch64(curr);
+		struct armv8_common *armv8 = &a64->armv8_common;
+
+		if (!target_was_examined(curr))
+			continue;
+
+		retval = dap_set_add(&daps, armv8->debug_ap->dap);
+		if (retval == ERROR_OK)
+			retval = mem_ap_read_u32(armv8->debug_ap,
+					armv8->debug_base + CPUV8_DBG_PRSR, &a64->smp_prsr);
+		if (retval != ERROR_OK)
+			break;
+	}
+
+	int run = dap_set_run(&daps);
+	return retval != ERROR_OK ? retval : run;
+}
+
 static int aarch64_prepare_halt_smp(struct target *target, bool exc_target, struct target **p_first)
 {
+	struct adiv5_dap_set daps = { .count = 0 };
 	int retval = ERROR_OK;
-	struct target_list *head = target->head;
+	struct target_list *head;
 	struct target *first = NULL;
 
 	LOG_DEBUG("target %s exc %i", target_name(target), exc_target);
 
-	while (head != NULL) {
+	/* read CTI gate and DSCR of every running PE ... */
+	foreach_smp_target(head, target->head) {
 		struct target *curr = head->target;
-		struct armv8_common *armv8 = target_to_armv8(curr);
-		head = head->next;
+		struct aarch64_common *a64 = target_to_aarch64(curr);
+		struct armv8_common *armv8 = &a64->armv8_common;
 
-		if (exc_target && curr == target)
+		a64->smp_selected = (!exc_target || curr != target) &&
+			target_was_examined(curr) && curr->state == TARGET_RUNNING;
+		if (!a64->smp_selected)
 			continue;
-		if (!target_was_examined(curr))
-			continue;
-		if (curr->state != TARGET_RUNNING)
+
+		retval = arm_cti_queue_read_reg(armv8->cti, CTI_GATE, &a64->smp_cti_gate, &daps);
+		if (retval == ERROR_OK)
+			retval = dap_set_add(&daps, armv8->debug_ap->dap);
+		if (retval == ERROR_OK)
+			retval = mem_ap_read_u32(armv8->debug_ap,
+					armv8->debug_base + CPUV8_DBG_DSCR, &a64->smp_dscr);
+		if (retval != ERROR_OK)
+			break;
+	}
+	int run = dap_set_run(&daps);
+	if (retval == ERROR_OK)
+		retval = run;
+
+	/* ... then open the gate for channel 0 to let HALT requests pass to
+	 * the CTM and allow Halting Debug Mode on all of them at once */
+	foreach_smp_target(head, target->head) {
+		struct target *curr = head->target;
+		struct aarch64_common *a64 = target_to_aarch64(curr);
+		struct armv8_common *armv8 = &a64->armv8_common;
+
+		if (retval != ERROR_OK)
+			break;
+		if (!a64->smp_selected)
 			continue;
 
 		/* HACK: mark this target as prepared for halting */
 		curr->debug_reason = DBG_REASON_DBGRQ;
 
-		/* open the gate for channel 0 to let HALT requests pass to the CTM */
-		retval = arm_cti_ungate_channel(armv8->cti, 0);
+		retval = arm_cti_queue_write_reg(armv8->cti, CTI_GATE,
+				a64->smp_cti_gate | CTI_CHNL(0), &daps);
 		if (retval == ERROR_OK)
-			retval = aarch64_set_dscr_bits(curr, DSCR_HDE, DSCR_HDE);
-		if (retval != ERROR_OK)
-			break;
+			retval = mem_ap_write_u32(armv8->debug_ap,
+					armv8->debug_base + CPUV8_DBG_DSCR, a64->smp_dscr | DSCR_HDE);
 
 		LOG_DEBUG("target %s prepared", target_name(curr));
 
 		if (first == NULL)
 			first = curr;
 	}
+	run = dap_set_run(&daps);
+	if (retval == ERROR_OK)
+		retval = run;
 
 	if (p_first) {
 		if (exc_target && first)
@@ -414,16 +475,17 @@ static int aarch64_halt_smp(struct target *target, bool exc_target)
 		struct target_list *head;
 		struct target *curr;
 
-		foreach_smp_target(head, target->head) {
-			int halted;
+		retval = aarch64_read_prsr_smp(target);
+		if (retval != ERROR_OK)
+			break;
 
+		foreach_smp_target(head, target->head) {
 			curr = head->target;
 
 			if (!target_was_examined(curr))
 				continue;
 
-			retval = aarch64_check_state_one(curr, PRSR_HALT, PRSR_HALT, &halted, NULL);
-			if (retval != ERROR_OK || !halted) {
+			if (!(target_to_aarch64(curr)->smp_prsr & PRSR_HALT)) {
 				all_halted = false;
 				break;
 			}
@@ -452,6 +514,8 @@ static int aarch64_halt_smp(struct target *target, bool exc_target)
 	return retval;
 }
 
+static int aarch64_update_state(struct target *target, int halted);
+
 static int update_halt_gdb(struct target *target, enum target_debug_reason debug_reason)
 {
 	struct target *gdb_target = NULL;
@@ -463,6 +527,10 @@ static int update_halt_gdb(struct target *target, enum target_debug_reason debug
 		aarch64_halt_smp(target, true);
 	}
 
+	/* the state of all PEs in one read; debug entry then runs for each
+	 * halted PE in turn */
+	bool have_prsr = aarch64_read_prsr_smp(target) == ERROR_OK;
+
 	/* poll all targets in the group, but skip the target that serves GDB */
 	foreach_smp_target(head, target->head) {
 		curr = head->target;
@@ -483,13 +551,21 @@ static int update_halt_gdb(struct target *target, enum target_debug_reason debug
 
 		/* avoid recursion in aarch64_poll() */
 		curr->smp = 0;
-		aarch64_poll(curr);
+		if (have_prsr)
+			aarch64_update_state(curr, target_to_aarch64(curr)->smp_prsr & PRSR_HALT);
+		else
+			aarch64_poll(curr);
 		curr->smp = 1;
 	}
 
 	/* after all targets were updated, poll the gdb serving target */
-	if (gdb_target != NULL && gdb_target != target)
-		aarch64_poll(gdb_target);
+	if (gdb_target != NULL && gdb_target != target) {
+		if (have_prsr)
+			aarch64_update_state(gdb_target,
+					target_to_aarch64(gdb_target)->smp_prsr & PRSR_HALT);
+		else
+			aarch64_poll(gdb_target);
+	}
 
 	return ERROR_OK;
 }
@@ -500,8 +576,7 @@ static int update_halt_gdb(struct target *target, enum target_debug_reason debug
 
 static int aarch64_poll(struct target *target)
 {
-	enum target_state prev_target_state;
-	int retval = ERROR_OK;
+	int retval;
 	int halted;
 
 	retval = aarch64_check_state_one(target,
@@ -509,6 +584,42 @@ static int aarch64_poll(struct target *target)
 	if (retval != ERROR_OK)
 		return retval;
 
+	return aarch64_update_state(target, halted);
+}
+
+/* Background polling of several PEs that are not in an SMP group:
+ * one PRSR read per PE, run as one transaction per DAP */
+static void aarch64_poll_batch(struct target **targets, unsigned count, int *results)
+{
+	struct adiv5_dap_set daps = { .count = 0 };
+	int retval = ERROR_OK;
+
+	for (unsigned i = 0; i < count && retval == ERROR_OK; i++) {
+		struct aarch64_common *a64 = target_to_aarch64(targets[i]);
+		struct armv8_common *armv8 = &a64->armv8_common;
+
+		retval = dap_set_add(&daps, armv8->debug_ap->dap);
+		if (retval == ERROR_OK)
+			retval = mem_ap_read_u32(armv8->debug_ap,
+					armv8->debug_base + CPUV8_DBG_PRSR, &a64->smp_prsr);
+	}
+	int run = dap_set_run(&daps);
+
+	for (unsigned i = 0; i < count; i++) {
+		if (retval != ERROR_OK || run != ERROR_OK)
+			results[i] = aarch64_poll(targets[i]);
+		else
+			results[i] = aarch64_update_state(targets[i],
+					target_to_aarch64(targets[i])->smp_prsr & PRSR_HALT);
+	}
+}
+
+/* Handles the PE state found by a poll */
+static int aarch64_update_state(struct target *target, int halted)
+{
+	enum target_state prev_target_state;
+	int retval = ERROR_OK;
+
 	if (halted) {
 		prev_target_state = target->state;
 		if (prev_target_state != TARGET_HALTED) {
@@ -719,6 +830,89 @@ static int aarch64_restart_one(struct target *target, enum restart_mode mode)
 	return retval;
 }
 
+/*
+ * aarch64_prepare_restart_one() for all PEs selected by
+ * aarch64_prep_restart_smp(), in two queued steps
+ */
+static int aarch64_prepare_restart_smp(struct target *target)
+{
+	struct adiv5_dap_set daps = { .count = 0 };
+	struct target_list *head;
+	int retval = ERROR_OK;
+
+	/* read DSCR and the CTI gate, acknowledge the pending halt event */
+	foreach_smp_target(head, target->head) {
+		struct aarch64_common *a64 = target_to_aarch64(head->target);
+		struct armv8_common *armv8 = &a64->armv8_common;
+
+		if (!a64->smp_selected)
+			continue;
+
+		retval = dap_set_add(&daps, armv8->debug_ap->dap);
+		if (retval == ERROR_OK)
+			retval = mem_ap_read_u32(armv8->debug_ap,
+					armv8->debug_base + CPUV8_DBG_DSCR, &a64->smp_dscr);
+		if (retval == ERROR_OK)
+			retval = arm_cti_queue_write_reg(armv8->cti, CTI_INACK, CTI_TRIG(HALT), &daps);
+		if (retval == ERROR_OK)
+			retval = arm_cti_queue_read_reg(armv8->cti, CTI_GATE, &a64->smp_cti_gate, &daps);
+		if (retval != ERROR_OK)
+			break;
+	}
+	int run = dap_set_run(&daps);
+	if (retval != ERROR_OK || run != ERROR_OK)
+		return retval != ERROR_OK ? retval : run;
+
+	/*
+	 * open the CTI gate for channel 1 so that the restart events get
+	 * passed along to all PEs, close the gate for channel 0 to isolate
+	 * the PEs from halt events, make sure that DSCR.HDE is set and
+	 * clear the sticky bits in PRSR
+	 */
+	foreach_smp_target(head, target->head) {
+		struct aarch64_common *a64 = target_to_aarch64(head->target);
+		struct armv8_common *armv8 = &a64->armv8_common;
+
+		if (!a64->smp_selected)
+			continue;
+
+		if ((a64->smp_dscr & DSCR_ITE) == 0)
+			LOG_ERROR("DSCR.ITE must be set before leaving debug!");
+		if ((a64->smp_dscr & DSCR_ERR) != 0)
+			LOG_ERROR("DSCR.ERR must be cleared before leaving debug!");
+
+		retval = arm_cti_queue_read_reg(armv8->cti, CTI_TROUT_STATUS,
+				&a64->smp_cti_trout, &daps);
+		if (retval == ERROR_OK)
+			retval = arm_cti_queue_write_reg(armv8->cti, CTI_GATE,
+					(a64->smp_cti_gate | CTI_CHNL(1)) & ~CTI_CHNL(0), &daps);
+		if (retval == ERROR_OK)
+			retval = mem_ap_write_u32(armv8->debug_ap,
+					armv8->debug_base + CPUV8_DBG_DSCR, a64->smp_dscr | DSCR_HDE);
+		if (retval == ERROR_OK)
+			retval = mem_ap_read_u32(armv8->debug_ap,
+					armv8->debug_base + CPUV8_DBG_PRSR, &a64->smp_prsr);
+		if (retval != ERROR_OK)
+			break;
+	}
+	run = dap_set_run(&daps);
+	if (retval != ERROR_OK || run != ERROR_OK)
+		return retval != ERROR_OK ? retval : run;
+
+	/* the acknowledge usually completes right away; wait for the rest */
+	foreach_smp_target(head, target->head) {
+		struct aarch64_common *a64 = target_to_aarch64(head->target);
+
+		if (a64->smp_selected && (a64->smp_cti_trout & CTI_TRIG(HALT))) {
+			retval = arm_cti_ack_events(a64->armv8_common.cti, CTI_TRIG(HALT));
+			if (retval != ERROR_OK)
+				break;
+		}
+	}
+
+	return retval;
+}
+
 /*
  * prepare all but the current target for restart
  */
@@ -731,6 +925,9 @@ static int aarch64_prep_restart_smp(struct target *target, int handle_breakpoint
 
 	foreach_smp_target(head, target->head) {
 		struct target *curr = head->target;
+		struct aarch64_common *a64 = target_to_aarch64(curr);
+
+		a64->smp_selected = false;
 
 		/* skip calling target */
 		if (curr == target)
@@ -742,63 +939,60 @@ static int aarch64_prep_restart_smp(struct target *target, int handle_breakpoint
 
 		/*  resume at current address, not in step mode */
 		retval = aarch64_restore_one(curr, 1, &address, handle_breakpoints, 0);
-		if (retval == ERROR_OK)
-			retval = aarch64_prepare_restart_one(curr);
 		if (retval != ERROR_OK) {
 			LOG_ERROR("failed to restore target %s", target_name(curr));
 			break;
 		}
+		a64->smp_selected = true;
+
 		/* remember the first valid target in the group */
 		if (first == NULL)
 			first = curr;
 	}
 
+	if (retval == ERROR_OK)
+		retval = aarch64_prepare_restart_smp(target);
+	if (retval != ERROR_OK)
+		LOG_ERROR("failed to prepare SMP group of %s for restart", target_name(target));
+
 	if (p_first)
 		*p_first = first;
 
 	return retval;
 }
 
-
-static int aarch64_step_restart_smp(struct target *target)
+/*
+ * wait until all PEs but the current one have restarted
+ */
+static int aarch64_wait_restart_smp(struct target *target)
 {
-	int retval = ERROR_OK;
-	struct target_list *head;
-	struct target *first = NULL;
-
-	LOG_DEBUG("%s", target_name(target));
-
-	retval = aarch64_prep_restart_smp(target, 0, &first);
-	if (retval != ERROR_OK)
-		return retval;
-
-	if (first != NULL)
-		retval = aarch64_do_restart_one(first, RESTART_LAZY);
-	if (retval != ERROR_OK) {
-		LOG_DEBUG("error restarting target %s", target_name(first));
-		return retval;
-	}
-
+	int retval;
 	int64_t then = timeval_ms();
+
 	for (;;) {
 		struct target *curr = target;
+		struct target_list *head;
 		bool all_resumed = true;
 
+		retval = aarch64_read_prsr_smp(target);
+		if (retval != ERROR_OK)
+			break;
+
 		foreach_smp_target(head, target->head) {
 			uint32_t prsr;
-			int resumed;
 
 			curr = head->target;
-
 			if (curr == target)
 				continue;
-
 			if (!target_was_examined(curr))
 				continue;
 
-			retval = aarch64_check_state_one(curr,
-					PRSR_SDR, PRSR_SDR, &resumed, &prsr);
-			if (retval != ERROR_OK || (!resumed && (prsr & PRSR_HALT))) {
+			/*
+			 * if PRSR.SDR is set now, the target did restart, even
+			 * if it's now already halted again (e.g. due to breakpoint)
+			 */
+			prsr = target_to_aarch64(curr)->smp_prsr;
+			if (!(prsr & PRSR_SDR) && (prsr & PRSR_HALT)) {
 				all_resumed = false;
 				break;
 			}
@@ -814,10 +1008,11 @@ static int aarch64_step_restart_smp(struct target *target)
 			break;
 
 		if (timeval_ms() > then + 1000) {
-			LOG_ERROR("%s: timeout waiting for target resume", __func__);
+			LOG_ERROR("%s: timeout waiting for target %s to resume", __func__, target_name(curr));
 			retval = ERROR_TARGET_TIMEOUT;
 			break;
 		}
+
 		/*
 		 * HACK: on Hi6220 there are 8 cores organized in 2 clusters
 		 * and it looks like the CTI's are not connected by a common
@@ -828,11 +1023,33 @@ static int aarch64_step_restart_smp(struct target *target)
 		retval = aarch64_do_restart_one(curr, RESTART_LAZY);
 		if (retval != ERROR_OK)
 			break;
-}
+	}
 
 	return retval;
 }
 
+
+static int aarch64_step_restart_smp(struct target *target)
+{
+	int retval = ERROR_OK;
+	struct target *first = NULL;
+
+	LOG_DEBUG("%s", target_name(target));
+
+	retval = aarch64_prep_restart_smp(target, 0, &first);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (first != NULL)
+		retval = aarch64_do_restart_one(first, RESTART_LAZY);
+	if (retval != ERROR_OK) {
+		LOG_DEBUG("error restarting target %s", target_name(first));
+		return retval;
+	}
+
+	return aarch64_wait_restart_smp(target);
+}
+
 static int aarch64_resume(struct target *target, int current,
 	target_addr_t address, int handle_breakpoints, int debug_execution)
 {
@@ -865,58 +1082,8 @@ static int aarch64_resume(struct target *target, int current,
 	if (retval != ERROR_OK)
 		return retval;
 
-	if (target->smp) {
-		int64_t then = timeval_ms();
-		for (;;) {
-			struct target *curr = target;
-			struct target_list *head;
-			bool all_resumed = true;
-
-			foreach_smp_target(head, target->head) {
-				uint32_t prsr;
-				int resumed;
-
-				curr = head->target;
-				if (curr == target)
-					continue;
-				if (!target_was_examined(curr))
-					continue;
-
-				retval = aarch64_check_state_one(curr,
-						PRSR_SDR, PRSR_SDR, &resumed, &prsr);
-				if (retval != ERROR_OK || (!resumed && (prsr & PRSR_HALT))) {
-					all_resumed = false;
-					break;
-				}
-
-				if (curr->state != TARGET_RUNNING) {
-					curr->state = TARGET_RUNNING;
-					curr->debug_reason = DBG_REASON_NOTHALTED;
-					target_call_event_callbacks(curr, TARGET_EVENT_RESUMED);
-				}
-			}
-
-			if (all_resumed)
-				break;
-
-			if (timeval_ms() > then + 1000) {
-				LOG_ERROR("%s: timeout waiting for target %s to resume", __func__, target_name(curr));
-				retval = ERROR_TARGET_TIMEOUT;
-				break;
-			}
-
-			/*
-			 * HACK: on Hi6220 there are 8 cores organized in 2 clusters
-			 * and it looks like the CTI's are not connected by a common
-			 * trigger matrix. It seems that we need to halt one core in each
-			 * cluster explicitly. So if we find that a core has not halted
-			 * yet, we trigger an explicit resume for the second cluster.
-			 */
-			retval = aarch64_do_restart_one(curr, RESTART_LAZY);
-			if (retval != ERROR_OK)
-				break;
-		}
-	}
+	if (target->smp)
+		retval = aarch64_wait_restart_smp(target);
 
 	if (retval != ERROR_OK)
 		return retval;
@@ -2777,6 +2944,7 @@ struct target_type aarch64_target = {
 	.name = "aarch64",
 
 	.poll = aarch64_poll,
+	.poll_batch = aarch64_poll_batch,
 	.arch_state = armv8_arch_state,
 
 	.halt = aarch64_halt,
@@ -65,6 +65,13 @@ struct aarch64_common {
 	struct armv8_common armv8_common;
 
 	enum aarch64_isrmasking_mode isrmasking_mode;
+
+	/* registers read by the queued SMP group operations */
+	bool smp_selected;
+	uint32_t smp_prsr;
+	uint32_t smp_dscr;
+	uint32_t smp_cti_gate;
+	uint32_t smp_cti_trout;
 };
 
 static inline struct aarch64_common *
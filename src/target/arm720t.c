@@ -424,6 +424,7 @@ static int arm720t_init_arch_info(struct target *target,
 	arm720t->armv4_5_mmu.enable_mmu_caches = arm720t_enable_mmu_caches;
 	arm720t->armv4_5_mmu.has_tiny_pages = 0;
 	arm720t->armv4_5_mmu.mmu_enabled = 0;
+	target->tlb = &arm720t->armv4_5_mmu.tlb;
 
 	return ERROR_OK;
 }
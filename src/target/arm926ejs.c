@@ -701,6 +701,7 @@ int arm926ejs_init_arch_info(struct target *target, struct arm926ejs_common *arm
 	arm926ejs->armv4_5_mmu.enable_mmu_caches = arm926ejs_enable_mmu_caches;
 	arm926ejs->armv4_5_mmu.has_tiny_pages = 1;
 	arm926ejs->armv4_5_mmu.mmu_enabled = 0;
+	target->tlb = &arm926ejs->armv4_5_mmu.tlb;
 
 	arm7_9->examine_debug_reason = arm926ejs_examine_debug_reason;
 
@@ -640,6 +640,39 @@ void dap_invalidate_cache(struct adiv5_dap *dap)
 	}
 }
 
+/**
+ * Adds @a dap to @a set before an access is queued on it.  A full set is
+ * run first, which completes the accesses queued so far.
+ */
+int dap_set_add(struct adiv5_dap_set *set, struct adiv5_dap *dap)
+{
+	for (unsigned i = 0; i < set->count; i++) {
+		if (set->dap[i] == dap)
+			return ERROR_OK;
+	}
+
+	int retval = ERROR_OK;
+	if (set->count == DAP_SET_SIZE)
+		retval = dap_set_run(set);
+
+	set->dap[set->count++] = dap;
+	return retval;
+}
+
+/** Runs the queue of every DAP in @a set and empties it. */
+int dap_set_run(struct adiv5_dap_set *set)
+{
+	int retval = ERROR_OK;
+
+	for (unsigned i = 0; i < set->count; i++) {
+		int r = dap_run(set->dap[i]);
+		if (retval == ERROR_OK)
+			retval = r;
+	}
+	set->count = 0;
+	return retval;
+}
+
 /**
  * Initialize a DAP.  This sets up the power domains, prepares the DP
  * for further use and activates overrun checking.
@@ -435,6 +435,20 @@ static inline int dap_run(struct adiv5_dap *dap)
 	return dap->ops->run(dap);
 }
 
+#define DAP_SET_SIZE	8
+
+/**
+ * DAPs with queued transactions, for operations that queue accesses to
+ * several APs, e.g. on all PEs of an SMP group, and run them together.
+ */
+struct adiv5_dap_set {
+	struct adiv5_dap *dap[DAP_SET_SIZE];
+	unsigned count;
+};
+
+int dap_set_add(struct adiv5_dap_set *set, struct adiv5_dap *dap);
+int dap_set_run(struct adiv5_dap_set *set);
+
 static inline int dap_sync(struct adiv5_dap *dap)
 {
 	assert(dap->ops != NULL);
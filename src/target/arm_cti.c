@@ -149,6 +149,30 @@ int arm_cti_read_reg(struct arm_cti *self, unsigned int reg, uint32_t *p_value)
 	return mem_ap_read_atomic_u32(self->ap, self->base + reg, p_value);
 }
 
+/*
+ * Queued accesses, completed by dap_set_run(daps).  @a value is only
+ * valid after that.
+ */
+int arm_cti_queue_write_reg(struct arm_cti *self, unsigned int reg, uint32_t value,
+		struct adiv5_dap_set *daps)
+{
+	int retval = dap_set_add(daps, self->ap->dap);
+	if (retval != ERROR_OK)
+		return retval;
+
+	return mem_ap_write_u32(self->ap, self->base + reg, value);
+}
+
+int arm_cti_queue_read_reg(struct arm_cti *self, unsigned int reg, uint32_t *value,
+		struct adiv5_dap_set *daps)
+{
+	int retval = dap_set_add(daps, self->ap->dap);
+	if (retval != ERROR_OK)
+		return retval;
+
+	return mem_ap_read_u32(self->ap, self->base + reg, value);
+}
+
 int arm_cti_pulse_channel(struct arm_cti *self, uint32_t channel)
 {
 	if (channel > 31)
@@ -61,6 +61,7 @@
 /* forward-declare arm_cti struct */
 struct arm_cti;
 struct adiv5_ap;
+struct adiv5_dap_set;
 
 extern const char *arm_cti_name(struct arm_cti *self);
 extern struct arm_cti *cti_instance_by_jim_obj(Jim_Interp *interp, Jim_Obj *o);
@@ -70,6 +71,10 @@ extern int arm_cti_gate_channel(struct arm_cti *self, uint32_t channel);
 extern int arm_cti_ungate_channel(struct arm_cti *self, uint32_t channel);
 extern int arm_cti_write_reg(struct arm_cti *self, unsigned int reg, uint32_t value);
 extern int arm_cti_read_reg(struct arm_cti *self, unsigned int reg, uint32_t *value);
+extern int arm_cti_queue_write_reg(struct arm_cti *self, unsigned int reg, uint32_t value,
+		struct adiv5_dap_set *daps);
+extern int arm_cti_queue_read_reg(struct arm_cti *self, unsigned int reg, uint32_t *value,
+		struct adiv5_dap_set *daps);
 extern int arm_cti_pulse_channel(struct arm_cti *self, uint32_t channel);
 extern int arm_cti_set_channel(struct arm_cti *self, uint32_t channel);
 extern int arm_cti_clear_channel(struct arm_cti *self, uint32_t channel);
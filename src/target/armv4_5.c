@@ -38,6 +38,7 @@
 #include "algorithm.h"
 #include "register.h"
 #include "semihosting_common.h"
+#include "mmu_tlb.h"
 
 /* offsets into armv4_5 core register cache */
 enum {
@@ -1085,6 +1086,10 @@ static int jim_mcrmrc(Jim_Interp *interp, int argc, Jim_Obj * const *argv)
 		retval = arm->mcr(target, cpnum, op1, op2, CRn, CRm, value);
 		if (retval != ERROR_OK)
 			return JIM_ERR;
+
+		/* may have switched translation tables or address spaces */
+		if (cpnum == 15 && target->tlb)
+			mmu_tlb_flush(target->tlb);
 	} else {
 		/* NOTE: parameters reordered! */
 		/* ARMV4_5_MRC(cpnum, op1, 0, CRn, CRm, op2) */
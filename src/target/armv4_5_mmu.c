@@ -35,6 +35,12 @@ int armv4_5_mmu_translate_va(struct target *target,
 	if (retval != ERROR_OK)
 		return retval;
 
+	target_addr_t pa;
+	if (mmu_tlb_lookup(&armv4_5_mmu->tlb, ttb, va, &pa, cb)) {
+		*val = pa;
+		return ERROR_OK;
+	}
+
 	retval = armv4_5_mmu_read_physical(target, armv4_5_mmu,
 		(ttb & 0xffffc000) | ((va & 0xfff00000) >> 18),
 		4, 1, (uint8_t *)&first_lvl_descriptor);
@@ -58,6 +64,7 @@ int armv4_5_mmu_translate_va(struct target *target,
 		/* section descriptor */
 		*cb = (first_lvl_descriptor & 0xc) >> 2;
 		*val = (first_lvl_descriptor & 0xfff00000) | (va & 0x000fffff);
+		mmu_tlb_insert(&armv4_5_mmu->tlb, ttb, va, *val, *cb);
 		return ERROR_OK;
 	}
 
@@ -92,17 +99,19 @@ int armv4_5_mmu_translate_va(struct target *target,
 	if ((second_lvl_descriptor & 0x3) == 1) {
 		/* large page descriptor */
 		*val = (second_lvl_descriptor & 0xffff0000) | (va & 0x0000ffff);
+		mmu_tlb_insert(&armv4_5_mmu->tlb, ttb, va, *val, *cb);
 		return ERROR_OK;
 	}
 
 	if ((second_lvl_descriptor & 0x3) == 2) {
 		/* small page descriptor */
 		*val = (second_lvl_descriptor & 0xfffff000) | (va & 0x00000fff);
+		mmu_tlb_insert(&armv4_5_mmu->tlb, ttb, va, *val, *cb);
 		return ERROR_OK;
 	}
 
 	if ((second_lvl_descriptor & 0x3) == 3) {
-		/* tiny page descriptor */
+		/* tiny page descriptor, smaller than a cached page */
 		*val = (second_lvl_descriptor & 0xfffffc00) | (va & 0x000003ff);
 		return ERROR_OK;
 	}
@@ -20,6 +20,7 @@
 #define OPENOCD_TARGET_ARMV4_5_MMU_H
 
 #include "armv4_5_cache.h"
+#include "mmu_tlb.h"
 
 struct target;
 
@@ -33,6 +34,7 @@ struct armv4_5_mmu_common {
 	struct armv4_5_cache_common armv4_5_cache;
 	int has_tiny_pages;
 	int mmu_enabled;
+	struct mmu_tlb tlb;
 };
 
 int armv4_5_mmu_translate_va(struct target *target,
@@ -146,6 +146,10 @@ int armv7a_read_ttbcr(struct target *target)
 
 	LOG_DEBUG("ttbcr %" PRIx32, ttbcr);
 
+	/* cached translations are only tagged with the TTBRs */
+	if (ttbcr != armv7a->armv7a_mmu.ttbcr)
+		mmu_tlb_flush(&armv7a->armv7a_mmu.tlb);
+
 	ttbcr_n = ttbcr & 0x7;
 	armv7a->armv7a_mmu.ttbcr = ttbcr;
 	armv7a->armv7a_mmu.cached = 1;
@@ -538,6 +542,7 @@ int armv7a_init_arch_info(struct target *target, struct armv7a_common *armv7a)
 	armv7a->armv7a_mmu.armv7a_cache.outer_cache = NULL;
 	armv7a->armv7a_mmu.armv7a_cache.flush_all_data_cache = NULL;
 	armv7a->armv7a_mmu.armv7a_cache.auto_cache_enabled = 1;
+	target->tlb = &armv7a->armv7a_mmu.tlb;
 	return ERROR_OK;
 }
 
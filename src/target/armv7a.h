@@ -24,6 +24,7 @@
 #include "armv4_5_mmu.h"
 #include "armv4_5_cache.h"
 #include "arm_dpm.h"
+#include "mmu_tlb.h"
 
 enum {
 	ARM_PC  = 15,
@@ -95,6 +96,9 @@ struct armv7a_mmu_common {
 			uint32_t count, uint8_t *buffer);
 	struct armv7a_cache_common armv7a_cache;
 	uint32_t mmu_enabled;
+	/* translations done through the CP15 address translation
+	 * operations, tagged with both TTBRs */
+	struct mmu_tlb tlb;
 };
 
 struct armv7a_common {
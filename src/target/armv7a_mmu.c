@@ -34,6 +34,25 @@
 
 #define SCTLR_BIT_AFE (1 << 29)
 
+static uint64_t armv7a_mmu_tlb_context(struct armv7a_common *armv7a)
+{
+	return (uint64_t)armv7a->armv7a_mmu.ttbr[1] << 32 | armv7a->armv7a_mmu.ttbr[0];
+}
+
+/* Translation from the TLB without touching the core, false on a miss */
+bool armv7a_mmu_tlb_lookup(struct target *target, uint32_t va,
+	target_addr_t *val)
+{
+	struct armv7a_common *armv7a = target_to_armv7a(target);
+
+	/* TTBRs not read since debug entry, cannot tag the entries */
+	if (!armv7a->armv7a_mmu.cached)
+		return false;
+
+	return mmu_tlb_lookup(&armv7a->armv7a_mmu.tlb,
+			armv7a_mmu_tlb_context(armv7a), va, val, NULL);
+}
+
 /*  V7 method VA TO PA  */
 int armv7a_mmu_translate_va_pa(struct target *target, uint32_t va,
 	target_addr_t *val, int meminfo)
@@ -43,6 +62,10 @@ int armv7a_mmu_translate_va_pa(struct target *target, uint32_t va,
 	struct arm_dpm *dpm = armv7a->arm.dpm;
 	uint32_t virt = va & ~0xfff, value;
 	uint32_t NOS, NS, INNER, OUTER, SS;
+
+	if (!meminfo && armv7a_mmu_tlb_lookup(target, va, val))
+		return ERROR_OK;
+
 	*val = 0xdeadbeef;
 	retval = dpm->prepare(dpm);
 	if (retval != ERROR_OK)
@@ -83,6 +106,10 @@ int armv7a_mmu_translate_va_pa(struct target *target, uint32_t va,
 	} else {
 		*val = (value & ~0xfff)  +  (va & 0xfff);
 	}
+	/* PAR.F set means the translation aborted */
+	if (!(value & 1) && armv7a->armv7a_mmu.cached)
+		mmu_tlb_insert(&armv7a->armv7a_mmu.tlb,
+				armv7a_mmu_tlb_context(armv7a), va, *val, 0);
 	if (meminfo) {
 		LOG_INFO("%" PRIx32 " : %" TARGET_PRIxADDR " %s outer shareable %s secured %s super section",
 			va, *val,
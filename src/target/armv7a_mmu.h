@@ -19,6 +19,8 @@
 #ifndef OPENOCD_TARGET_ARMV7A_MMU_H
 #define OPENOCD_TARGET_ARMV7A_MMU_H
 
+extern bool armv7a_mmu_tlb_lookup(struct target *target, uint32_t va,
+	target_addr_t *val);
 extern int armv7a_mmu_translate_va_pa(struct target *target, uint32_t va,
 	target_addr_t *val, int meminfo);
 
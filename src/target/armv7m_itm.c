@@ -0,0 +1,316 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <helper/log.h>
+#include <target/armv7m_itm.h>
+
+/* stimulus payload is collected per port and handed to the sinks in
+ * blocks, not per packet */
+#define ITM_OUT_SIZE		4096
+
+/* a synchronisation packet is at least 47 zero bits followed by a one */
+#define ITM_SYNC_ZEROS		5
+
+/* DWT hardware source packet discriminators */
+#define DWT_ID_EVENT_COUNTER	0
+#define DWT_ID_EXCEPTION	1
+#define DWT_ID_PC_SAMPLE	2
+#define DWT_ID_DATA_FIRST	8
+#define DWT_ID_DATA_LAST	23
+
+enum itm_state {
+	ITM_STATE_HEADER,
+	ITM_STATE_PAYLOAD,
+	ITM_STATE_CONTINUATION,
+	ITM_STATE_SYNC,
+};
+
+struct itm_sink {
+	unsigned port;
+	itm_sink_t sink;
+	void *priv;
+	struct itm_sink *next;
+};
+
+struct itm_decoder {
+	enum itm_state state;
+	uint8_t header;
+	unsigned size;
+	unsigned count;
+	uint8_t payload[4];
+	unsigned zeros;
+
+	/* ports with at least one sink, and their pending output */
+	uint32_t sink_mask;
+	uint8_t *out[ITM_STIMULUS_PORTS];
+	size_t out_length[ITM_STIMULUS_PORTS];
+	struct itm_sink *sinks;
+
+	struct itm_stats stats;
+};
+
+struct itm_decoder *itm_decoder_new(void)
+{
+	struct itm_decoder *decoder = calloc(1, sizeof(*decoder));
+	if (!decoder)
+		LOG_ERROR("Out of memory");
+	return decoder;
+}
+
+void itm_decoder_free(struct itm_decoder *decoder)
+{
+	if (!decoder)
+		return;
+
+	while (decoder->sinks) {
+		struct itm_sink *next = decoder->sinks->next;
+		free(decoder->sinks);
+		decoder->sinks = next;
+	}
+	for (unsigned i = 0; i < ITM_STIMULUS_PORTS; i++)
+		free(decoder->out[i]);
+	free(decoder);
+}
+
+struct itm_stats *itm_decoder_stats(struct itm_decoder *decoder)
+{
+	return &decoder->stats;
+}
+
+void itm_decoder_reset_stats(struct itm_decoder *decoder)
+{
+	memset(&decoder->stats, 0, sizeof(decoder->stats));
+}
+
+static void itm_flush_port(struct itm_decoder *decoder, unsigned port)
+{
+	for (struct itm_sink *s = decoder->sinks; s; s = s->next) {
+		if (s->port == port)
+			s->sink(port, decoder->out[port], decoder->out_length[port], s->priv);
+	}
+	decoder->out_length[port] = 0;
+}
+
+int itm_register_sink(struct itm_decoder *decoder, unsigned port,
+		itm_sink_t sink, void *priv)
+{
+	if (port >= ITM_STIMULUS_PORTS)
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+
+	if (!decoder->out[port]) {
+		decoder->out[port] = malloc(ITM_OUT_SIZE);
+		if (!decoder->out[port]) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+	}
+
+	struct itm_sink *s = malloc(sizeof(*s));
+	if (!s) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+	s->port = port;
+	s->sink = sink;
+	s->priv = priv;
+	s->next = decoder->sinks;
+	decoder->sinks = s;
+	decoder->sink_mask |= 1u << port;
+
+	return ERROR_OK;
+}
+
+int itm_unregister_sink(struct itm_decoder *decoder, unsigned port,
+		itm_sink_t sink, void *priv)
+{
+	int retval = ERROR_FAIL;
+
+	for (struct itm_sink **p = &decoder->sinks; *p; p = &(*p)->next) {
+		struct itm_sink *s = *p;
+		if (s->port == port && s->sink == sink && s->priv == priv) {
+			*p = s->next;
+			free(s);
+			retval = ERROR_OK;
+			break;
+		}
+	}
+
+	decoder->sink_mask &= ~(1u << port);
+	for (struct itm_sink *s = decoder->sinks; s; s = s->next) {
+		if (s->port == port)
+			decoder->sink_mask |= 1u << port;
+	}
+	if (!(decoder->sink_mask & (1u << port)))
+		decoder->out_length[port] = 0;
+
+	return retval;
+}
+
+static void itm_hardware_packet(struct itm_decoder *decoder)
+{
+	struct itm_stats *stats = &decoder->stats;
+	const uint8_t *p = decoder->payload;
+	unsigned id = decoder->header >> 3;
+
+	switch (id) {
+	case DWT_ID_EVENT_COUNTER:
+		stats->event_counter++;
+		break;
+	case DWT_ID_EXCEPTION: {
+		unsigned number = p[0] | ((p[1] & 1) << 8);
+		switch ((p[1] >> 4) & 3) {
+		case 1:
+			stats->exception_entry++;
+			stats->exceptions[number]++;
+			break;
+		case 2:
+			stats->exception_exit++;
+			break;
+		case 3:
+			stats->exception_return++;
+			break;
+		default:
+			stats->invalid++;
+		}
+		break;
+	}
+	case DWT_ID_PC_SAMPLE:
+		/* a one byte sample means the core was sleeping */
+		if (decoder->size == 4) {
+			stats->pc_samples++;
+			stats->last_pc = p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+		} else
+			stats->sleep_samples++;
+		break;
+	default:
+		if (id >= DWT_ID_DATA_FIRST && id <= DWT_ID_DATA_LAST)
+			stats->data_trace++;
+		else
+			stats->invalid++;
+	}
+}
+
+/* Starts a packet; returns the next state */
+static enum itm_state itm_header(struct itm_decoder *decoder, uint8_t b)
+{
+	struct itm_stats *stats = &decoder->stats;
+
+	if (b & 3) {
+		/* source packet: instrumentation (bit 2 clear) or hardware */
+		decoder->header = b;
+		decoder->size = (b & 3) == 3 ? 4 : (b & 3);
+		decoder->count = 0;
+		return ITM_STATE_PAYLOAD;
+	}
+
+	if (b == 0x00) {
+		decoder->zeros = 1;
+		return ITM_STATE_SYNC;
+	}
+
+	if (b == 0x70) {
+		stats->overflow++;
+		return ITM_STATE_HEADER;
+	}
+
+	if ((b & 0x0f) == 0) {
+		/* local timestamp, format 2 is a single byte */
+		stats->local_timestamp++;
+		return (b & 0x80) ? ITM_STATE_CONTINUATION : ITM_STATE_HEADER;
+	}
+
+	if (b == 0x94 || b == 0xb4) {
+		stats->global_timestamp++;
+		return ITM_STATE_CONTINUATION;
+	}
+
+	if ((b & 0x0b) == 0x08) {
+		stats->extension++;
+		return (b & 0x80) ? ITM_STATE_CONTINUATION : ITM_STATE_HEADER;
+	}
+
+	stats->invalid++;
+	return ITM_STATE_HEADER;
+}
+
+void itm_decode(struct itm_decoder *decoder, const uint8_t *buf, size_t length)
+{
+	struct itm_stats *stats = &decoder->stats;
+	enum itm_state state = decoder->state;
+
+	for (size_t i = 0; i < length; i++) {
+		uint8_t b = buf[i];
+
+		switch (state) {
+		case ITM_STATE_HEADER:
+			state = itm_header(decoder, b);
+			break;
+
+		case ITM_STATE_PAYLOAD: {
+			uint8_t header = decoder->header;
+			decoder->payload[decoder->count++] = b;
+
+			if (!(header & 4)) {
+				unsigned port = header >> 3;
+				if (decoder->sink_mask & (1u << port)) {
+					decoder->out[port][decoder->out_length[port]++] = b;
+					if (decoder->out_length[port] == ITM_OUT_SIZE)
+						itm_flush_port(decoder, port);
+				}
+				if (decoder->count == decoder->size) {
+					stats->stimulus_bytes[port] += decoder->size;
+					state = ITM_STATE_HEADER;
+				}
+			} else if (decoder->count == decoder->size) {
+				itm_hardware_packet(decoder);
+				state = ITM_STATE_HEADER;
+			}
+			break;
+		}
+
+		case ITM_STATE_CONTINUATION:
+			if (!(b & 0x80))
+				state = ITM_STATE_HEADER;
+			break;
+
+		case ITM_STATE_SYNC:
+			if (b == 0x00) {
+				decoder->zeros++;
+				break;
+			}
+			if (b == 0x80 && decoder->zeros >= ITM_SYNC_ZEROS) {
+				stats->sync++;
+				state = ITM_STATE_HEADER;
+				break;
+			}
+			/* zeros that are not part of a sync packet, e.g. an
+			 * idle line; start over with this byte */
+			state = itm_header(decoder, b);
+			break;
+		}
+	}
+
+	decoder->state = state;
+
+	uint32_t mask = decoder->sink_mask;
+	for (unsigned port = 0; mask; port++, mask >>= 1) {
+		if ((mask & 1) && decoder->out_length[port])
+			itm_flush_port(decoder, port);
+	}
+}
@@ -0,0 +1,71 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef OPENOCD_TARGET_ARMV7M_ITM_H
+#define OPENOCD_TARGET_ARMV7M_ITM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file
+ * Streaming decoder for the ITM/DWT packet protocol (ARMv7-M ARM,
+ * appendix D4) as captured from an unformatted SWO port.
+ */
+
+#define ITM_STIMULUS_PORTS	32
+#define ITM_EXCEPTIONS		512
+
+/** Receives the payload of one stimulus port; must not block. */
+typedef void (*itm_sink_t)(unsigned port, const uint8_t *buf,
+		size_t length, void *priv);
+
+struct itm_stats {
+	uint64_t sync;
+	uint64_t overflow;
+	uint64_t local_timestamp;
+	uint64_t global_timestamp;
+	uint64_t extension;
+	uint64_t invalid;
+	uint64_t stimulus_bytes[ITM_STIMULUS_PORTS];
+	uint64_t event_counter;
+	uint64_t pc_samples;
+	uint64_t sleep_samples;
+	uint64_t data_trace;
+	uint64_t exception_entry;
+	uint64_t exception_exit;
+	uint64_t exception_return;
+	uint32_t exceptions[ITM_EXCEPTIONS];	/**< entries per exception number */
+	uint32_t last_pc;
+};
+
+struct itm_decoder;
+
+struct itm_decoder *itm_decoder_new(void);
+void itm_decoder_free(struct itm_decoder *decoder);
+
+/** Decodes a chunk of the trace stream; packets may span chunks. */
+void itm_decode(struct itm_decoder *decoder, const uint8_t *buf, size_t length);
+
+struct itm_stats *itm_decoder_stats(struct itm_decoder *decoder);
+void itm_decoder_reset_stats(struct itm_decoder *decoder);
+
+int itm_register_sink(struct itm_decoder *decoder, unsigned port,
+		itm_sink_t sink, void *priv);
+int itm_unregister_sink(struct itm_decoder *decoder, unsigned port,
+		itm_sink_t sink, void *priv);
+
+#endif /* OPENOCD_TARGET_ARMV7M_ITM_H */
@@ -24,30 +24,51 @@
 #include <target/cortex_m.h>
 #include <target/armv7m_trace.h>
 #include <jtag/interface.h>
+#include <server/server.h>
 
 #define TRACE_BUF_SIZE	4096
+/* buffers drained per poll at most, the rest is left for the next one */
+#define TRACE_POLL_MAX_BUFS	16
+
+/* the ITM packets can only be found in the stream without TPIU framing */
+static bool armv7m_trace_formatted(struct armv7m_trace_config *trace_config)
+{
+	return trace_config->pin_protocol == TPIU_PIN_PROTOCOL_SYNC ||
+		trace_config->formatter;
+}
 
 static int armv7m_poll_trace(void *target)
 {
 	struct armv7m_common *armv7m = target_to_armv7m(target);
+	struct armv7m_trace_config *trace_config = &armv7m->trace_config;
 	uint8_t buf[TRACE_BUF_SIZE];
-	size_t size = sizeof(buf);
+	size_t size;
 	int retval;
+	int bufs = 0;
+
+	/* drain what the adapter has buffered, so a fast SWO stream does not
+	 * depend on how often this callback runs, but without starving the
+	 * servers if the stream never pauses */
+	do {
+		size = sizeof(buf);
+		retval = adapter_poll_trace(buf, &size);
+		if (retval != ERROR_OK || !size)
+			return retval;
 
-	retval = adapter_poll_trace(buf, &size);
-	if (retval != ERROR_OK || !size)
-		return retval;
+		target_call_trace_callbacks(target, size, buf);
 
-	target_call_trace_callbacks(target, size, buf);
+		if (trace_config->itm_decode && !armv7m_trace_formatted(trace_config))
+			itm_decode(trace_config->itm_decoder, buf, size);
 
-	if (armv7m->trace_config.trace_file != NULL) {
-		if (fwrite(buf, 1, size, armv7m->trace_config.trace_file) == size)
-			fflush(armv7m->trace_config.trace_file);
-		else {
-			LOG_ERROR("Error writing to the trace destination file");
-			return ERROR_FAIL;
+		if (trace_config->trace_file != NULL) {
+			if (fwrite(buf, 1, size, trace_config->trace_file) == size)
+				fflush(trace_config->trace_file);
+			else {
+				LOG_ERROR("Error writing to the trace destination file");
+				return ERROR_FAIL;
+			}
 		}
-	}
+	} while (size == sizeof(buf) && ++bufs < TRACE_POLL_MAX_BUFS);
 
 	return ERROR_OK;
 }
@@ -301,6 +322,174 @@ COMMAND_HANDLER(handle_itm_ports_command)
 		return ERROR_OK;
 }
 
+static int armv7m_itm_decoder_enable(struct armv7m_common *armv7m)
+{
+	struct armv7m_trace_config *trace_config = &armv7m->trace_config;
+
+	if (!trace_config->itm_decoder) {
+		trace_config->itm_decoder = itm_decoder_new();
+		if (!trace_config->itm_decoder)
+			return ERROR_FAIL;
+	}
+	trace_config->itm_decode = true;
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_itm_decode_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+	bool enable;
+
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_ON_OFF(CMD_ARGV[0], enable);
+	if (!enable) {
+		armv7m->trace_config.itm_decode = false;
+		return ERROR_OK;
+	}
+
+	return armv7m_itm_decoder_enable(armv7m);
+}
+
+COMMAND_HANDLER(handle_itm_stats_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+	struct armv7m_trace_config *trace_config = &armv7m->trace_config;
+
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (!trace_config->itm_decoder) {
+		command_print(CMD, "ITM decoding not enabled");
+		return ERROR_OK;
+	}
+
+	if (CMD_ARGC == 1) {
+		if (strcmp(CMD_ARGV[0], "reset"))
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		itm_decoder_reset_stats(trace_config->itm_decoder);
+		return ERROR_OK;
+	}
+
+	if (armv7m_trace_formatted(trace_config))
+		command_print(CMD, "trace stream uses the TPIU formatter and is not decoded");
+
+	struct itm_stats *stats = itm_decoder_stats(trace_config->itm_decoder);
+	command_print(CMD, "sync %" PRIu64 " overflow %" PRIu64 " invalid %" PRIu64,
+			stats->sync, stats->overflow, stats->invalid);
+	command_print(CMD, "timestamps local %" PRIu64 " global %" PRIu64
+			" extension %" PRIu64, stats->local_timestamp,
+			stats->global_timestamp, stats->extension);
+	for (unsigned i = 0; i < ITM_STIMULUS_PORTS; i++) {
+		if (stats->stimulus_bytes[i])
+			command_print(CMD, "stimulus port %u: %" PRIu64 " bytes",
+					i, stats->stimulus_bytes[i]);
+	}
+	command_print(CMD, "pc samples %" PRIu64 " (last 0x%08" PRIx32 ") sleeping %" PRIu64,
+			stats->pc_samples, stats->last_pc, stats->sleep_samples);
+	command_print(CMD, "event counter %" PRIu64 " data trace %" PRIu64,
+			stats->event_counter, stats->data_trace);
+	command_print(CMD, "exceptions entry %" PRIu64 " exit %" PRIu64 " return %" PRIu64,
+			stats->exception_entry, stats->exception_exit, stats->exception_return);
+	for (unsigned i = 0; i < ITM_EXCEPTIONS; i++) {
+		if (stats->exceptions[i])
+			command_print(CMD, "exception %u: %" PRIu32 " entries",
+					i, stats->exceptions[i]);
+	}
+
+	return ERROR_OK;
+}
+
+/* Each "itm server" forwards one stimulus port to its TCP connections */
+struct itm_service {
+	struct target *target;
+	unsigned port;
+};
+
+static void itm_server_sink(unsigned port, const uint8_t *buf, size_t length, void *priv)
+{
+	struct connection *connection = priv;
+
+	connection_write(connection, buf, length);
+}
+
+static int itm_new_connection(struct connection *connection)
+{
+	struct itm_service *service = connection->service->priv;
+	struct armv7m_common *armv7m = target_to_armv7m(service->target);
+
+	return itm_register_sink(armv7m->trace_config.itm_decoder, service->port,
+			itm_server_sink, connection);
+}
+
+static int itm_input(struct connection *connection)
+{
+	uint8_t buf[64];
+
+	/* nothing is sent to the target, just notice the client leaving */
+	int length = connection_read(connection, buf, sizeof(buf));
+	if (length <= 0)
+		return ERROR_SERVER_REMOTE_CLOSED;
+
+	return ERROR_OK;
+}
+
+static int itm_connection_closed(struct connection *connection)
+{
+	struct itm_service *service = connection->service->priv;
+	struct armv7m_common *armv7m = target_to_armv7m(service->target);
+
+	itm_unregister_sink(armv7m->trace_config.itm_decoder, service->port,
+			itm_server_sink, connection);
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_itm_server_start_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+	unsigned port;
+
+	if (CMD_ARGC != 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_NUMBER(uint, CMD_ARGV[1], port);
+	if (port >= ITM_STIMULUS_PORTS) {
+		command_print(CMD, "stimulus port must be below %d", ITM_STIMULUS_PORTS);
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	int retval = armv7m_itm_decoder_enable(armv7m);
+	if (retval != ERROR_OK)
+		return retval;
+
+	struct itm_service *service = malloc(sizeof(*service));
+	if (!service) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+	service->target = target;
+	service->port = port;
+
+	retval = add_service("itm", CMD_ARGV[0], CONNECTION_LIMIT_UNLIMITED,
+			itm_new_connection, itm_input, itm_connection_closed, service);
+	if (retval != ERROR_OK)
+		free(service);
+	return retval;
+}
+
+COMMAND_HANDLER(handle_itm_server_stop_command)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	return remove_service("itm", CMD_ARGV[0]);
+}
+
 static const struct command_registration tpiu_command_handlers[] = {
 	{
 		.name = "config",
@@ -315,6 +504,24 @@ static const struct command_registration tpiu_command_handlers[] = {
 	COMMAND_REGISTRATION_DONE
 };
 
+static const struct command_registration itm_server_command_handlers[] = {
+	{
+		.name = "start",
+		.handler = handle_itm_server_start_command,
+		.mode = COMMAND_ANY,
+		.help = "Serve the data of an ITM stimulus port on a TCP port",
+		.usage = "<tcp port> <stimulus port>",
+	},
+	{
+		.name = "stop",
+		.handler = handle_itm_server_stop_command,
+		.mode = COMMAND_ANY,
+		.help = "Stop serving ITM data on a TCP port",
+		.usage = "<tcp port>",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
 static const struct command_registration itm_command_handlers[] = {
 	{
 		.name = "port",
@@ -330,6 +537,27 @@ static const struct command_registration itm_command_handlers[] = {
 		.help = "Enable or disable all ITM stimulus ports",
 		.usage = "(0|1|on|off)",
 	},
+	{
+		.name = "decode",
+		.handler = handle_itm_decode_command,
+		.mode = COMMAND_ANY,
+		.help = "Enable or disable decoding of the captured ITM/DWT packets",
+		.usage = "(0|1|on|off)",
+	},
+	{
+		.name = "stats",
+		.handler = handle_itm_stats_command,
+		.mode = COMMAND_ANY,
+		.help = "Display or reset the decoded packet counters",
+		.usage = "['reset']",
+	},
+	{
+		.name = "server",
+		.mode = COMMAND_ANY,
+		.help = "itm server command group",
+		.usage = "",
+		.chain = itm_server_command_handlers,
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
@@ -19,6 +19,7 @@
 #define OPENOCD_TARGET_ARMV7M_TRACE_H
 
 #include <target/target.h>
+#include <target/armv7m_itm.h>
 #include <command.h>
 
 /**
@@ -75,6 +76,11 @@ struct armv7m_trace_config {
 	unsigned int trace_freq;
 	/** Handle to output trace data in INTERNAL capture mode */
 	FILE *trace_file;
+
+	/** Decode ITM/DWT packets of the captured stream */
+	bool itm_decode;
+	/** Decoder state, allocated when decoding is first enabled */
+	struct itm_decoder *itm_decoder;
 };
 
 extern const struct command_registration armv7m_trace_command_handlers[];
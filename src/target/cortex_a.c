@@ -612,20 +612,134 @@ static struct target *get_cortex_a(struct target *target, int32_t coreid)
 }
 static int cortex_a_halt(struct target *target);
 
+/*
+ * The SMP group operations queue the same DRCR/DSCR access on all
+ * selected PEs and run the DAP queues once, so the PEs of a group are
+ * halted and restarted together and polled in one transaction.
+ */
+
+/* Reads DSCR of the selected PEs into cpudbg_dscr */
+static int cortex_a_read_dscr_smp(struct target *target)
+{
+	struct adiv5_dap_set daps = { .count = 0 };
+	struct target_list *head;
+	int retval = ERROR_OK;
+
+	foreach_smp_target(head, target->head) {
+		struct cortex_a_common *cortex_a = target_to_cortex_a(head->target);
+		struct armv7a_common *armv7a = &cortex_a->armv7a_common;
+
+		if (!cortex_a->smp_selected)
+			continue;
+
+		retval = dap_set_add(&daps, armv7a->debug_ap->dap);
+		if (retval == ERROR_OK)
+			retval = mem_ap_read_u32(armv7a->debug_ap,
+					armv7a->debug_base + CPUDBG_DSCR, &cortex_a->cpudbg_dscr);
+		if (retval != ERROR_OK)
+			break;
+	}
+
+	int run = dap_set_run(&daps);
+	return retval != ERROR_OK ? retval : run;
+}
+
+/* Writes @a value to the register at @a offset of each selected PE */
+static int cortex_a_write_smp(struct target *target, unsigned offset, uint32_t value)
+{
+	struct adiv5_dap_set daps = { .count = 0 };
+	struct target_list *head;
+	int retval = ERROR_OK;
+
+	foreach_smp_target(head, target->head) {
+		struct cortex_a_common *cortex_a = target_to_cortex_a(head->target);
+		struct armv7a_common *armv7a = &cortex_a->armv7a_common;
+
+		if (!cortex_a->smp_selected)
+			continue;
+
+		retval = dap_set_add(&daps, armv7a->debug_ap->dap);
+		if (retval == ERROR_OK)
+			retval = mem_ap_write_u32(armv7a->debug_ap,
+					armv7a->debug_base + offset, value);
+		if (retval != ERROR_OK)
+			break;
+	}
+
+	int run = dap_set_run(&daps);
+	return retval != ERROR_OK ? retval : run;
+}
+
+/* Waits until all selected PEs show @a value in the @a mask bits of DSCR;
+ * each PE is deselected once it does */
+static int cortex_a_wait_dscr_smp(struct target *target, uint32_t mask, uint32_t value)
+{
+	int64_t then = timeval_ms();
+
+	for (;;) {
+		struct target_list *head;
+		bool done = true;
+
+		int retval = cortex_a_read_dscr_smp(target);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("Could not read DSCR register");
+			return retval;
+		}
+
+		foreach_smp_target(head, target->head) {
+			struct cortex_a_common *cortex_a = target_to_cortex_a(head->target);
+
+			if (!cortex_a->smp_selected)
+				continue;
+			if ((cortex_a->cpudbg_dscr & mask) == value)
+				cortex_a->smp_selected = false;
+			else
+				done = false;
+		}
+
+		if (done)
+			return ERROR_OK;
+
+		if (timeval_ms() > then + 1000) {
+			LOG_ERROR("timeout waiting for DSCR bit change");
+			return ERROR_FAIL;
+		}
+	}
+}
+
 static int cortex_a_halt_smp(struct target *target)
 {
-	int retval = 0;
 	struct target_list *head;
-	struct target *curr;
-	head = target->head;
-	while (head != (struct target_list *)NULL) {
-		curr = head->target;
+	int retval;
+
+	/*
+	 * Tell all other cores to halt by writing DRCR with 0x1 and wait
+	 * for them together.
+	 */
+	foreach_smp_target(head, target->head) {
+		struct target *curr = head->target;
+
+		target_to_cortex_a(curr)->smp_selected = (curr != target) &&
+			(curr->state != TARGET_HALTED) && target_was_examined(curr);
+	}
+
+	retval = cortex_a_write_smp(target, CPUDBG_DRCR, DRCR_HALT);
+	if (retval == ERROR_OK)
+		retval = cortex_a_wait_dscr_smp(target, DSCR_CORE_HALTED, DSCR_CORE_HALTED);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Error waiting for halt");
+		return retval;
+	}
+
+	foreach_smp_target(head, target->head) {
+		struct target *curr = head->target;
+
 		if ((curr != target) && (curr->state != TARGET_HALTED)
 			&& target_was_examined(curr))
-			retval += cortex_a_halt(curr);
-		head = head->next;
+			curr->debug_reason = DBG_REASON_DBGRQ;
 	}
-	return retval;
+
+	return ERROR_OK;
 }
 
 static int update_halt_gdb(struct target *target)
@@ -909,24 +1023,78 @@ static int cortex_a_internal_restart(struct target *target)
 
 static int cortex_a_restore_smp(struct target *target, int handle_breakpoints)
 {
-	int retval = 0;
+	int retval = ERROR_OK;
 	struct target_list *head;
 	struct target *curr;
 	target_addr_t address;
-	head = target->head;
-	while (head != (struct target_list *)NULL) {
+
+	foreach_smp_target(head, target->head) {
 		curr = head->target;
-		if ((curr != target) && (curr->state != TARGET_RUNNING)
-			&& target_was_examined(curr)) {
+		target_to_cortex_a(curr)->smp_selected = (curr != target) &&
+			(curr->state != TARGET_RUNNING) && target_was_examined(curr);
+		if (target_to_cortex_a(curr)->smp_selected) {
 			/*  resume current address , not in step mode */
-			retval += cortex_a_internal_restore(curr, 1, &address,
+			retval = cortex_a_internal_restore(curr, 1, &address,
 					handle_breakpoints, 0);
-			retval += cortex_a_internal_restart(curr);
+			if (retval != ERROR_OK)
+				return retval;
 		}
-		head = head->next;
+	}
 
+	/*
+	 * cortex_a_internal_restart() for all cores: clear ITRen, then
+	 * restart them with one queued DRCR write each
+	 */
+	retval = cortex_a_read_dscr_smp(target);
+	if (retval != ERROR_OK)
+		return retval;
+
+	struct adiv5_dap_set daps = { .count = 0 };
+	foreach_smp_target(head, target->head) {
+		struct cortex_a_common *cortex_a = target_to_cortex_a(head->target);
+		struct armv7a_common *armv7a = &cortex_a->armv7a_common;
+
+		if (!cortex_a->smp_selected)
+			continue;
+
+		if ((cortex_a->cpudbg_dscr & DSCR_INSTR_COMP) == 0)
+			LOG_ERROR("DSCR InstrCompl must be set before leaving debug!");
+
+		retval = dap_set_add(&daps, armv7a->debug_ap->dap);
+		if (retval == ERROR_OK)
+			retval = mem_ap_write_u32(armv7a->debug_ap,
+					armv7a->debug_base + CPUDBG_DSCR,
+					cortex_a->cpudbg_dscr & ~DSCR_ITR_EN);
+		if (retval != ERROR_OK)
+			break;
 	}
-	return retval;
+	int run = dap_set_run(&daps);
+	if (retval == ERROR_OK)
+		retval = run;
+
+	if (retval == ERROR_OK)
+		retval = cortex_a_write_smp(target, CPUDBG_DRCR,
+				DRCR_RESTART | DRCR_CLEAR_EXCEPTIONS);
+	if (retval == ERROR_OK)
+		retval = cortex_a_wait_dscr_smp(target, DSCR_CORE_RESTARTED, DSCR_CORE_RESTARTED);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Error waiting for resume");
+		return retval;
+	}
+
+	foreach_smp_target(head, target->head) {
+		curr = head->target;
+		if ((curr != target) && (curr->state != TARGET_RUNNING)
+			&& target_was_examined(curr)) {
+			curr->debug_reason = DBG_REASON_NOTHALTED;
+			curr->state = TARGET_RUNNING;
+
+			/* registers are now invalid */
+			register_cache_invalidate(target_to_armv7a(curr)->arm.core_cache);
+		}
+	}
+
+	return ERROR_OK;
 }
 
 static int cortex_a_resume(struct target *target, int current,
@@ -2918,6 +3086,9 @@ static int cortex_a_virt2phys(struct target *target,
 		return ERROR_OK;
 	}
 
+	if (armv7a_mmu_tlb_lookup(target, (uint32_t)virt, phys))
+		return ERROR_OK;
+
 	/* mmu must be enable in order to get a correct translation */
 	retval = cortex_a_mmu_modify(target, 1);
 	if (retval != ERROR_OK)
@@ -99,6 +99,9 @@ struct cortex_a_common {
 	enum cortex_a_isrmasking_mode isrmasking_mode;
 	enum cortex_a_dacrfixup_mode dacrfixup_mode;
 
+	/* PE takes part in the current queued SMP group operation */
+	bool smp_selected;
+
 	struct armv7a_common armv7a_common;
 
 };
@@ -554,7 +554,8 @@ static int cortex_m_debug_entry(struct target *target)
 	return ERROR_OK;
 }
 
-static int cortex_m_poll(struct target *target)
+/* Handles the DHCSR value found in dcb_dhcsr by a poll */
+static int cortex_m_poll_status(struct target *target)
 {
 	int detected_failure = ERROR_OK;
 	int retval = ERROR_OK;
@@ -562,13 +563,6 @@ static int cortex_m_poll(struct target *target)
 	struct cortex_m_common *cortex_m = target_to_cm(target);
 	struct armv7m_common *armv7m = &cortex_m->armv7m;
 
-	/* Read from Debug Halting Control and Status Register */
-	retval = mem_ap_read_atomic_u32(armv7m->debug_ap, DCB_DHCSR, &cortex_m->dcb_dhcsr);
-	if (retval != ERROR_OK) {
-		target->state = TARGET_UNKNOWN;
-		return retval;
-	}
-
 	/* Recover from lockup.  See ARMv7-M architecture spec,
 	 * section B1.5.15 "Unrecoverable exception cases".
 	 */
@@ -664,6 +658,47 @@ static int cortex_m_poll(struct target *target)
 	return retval;
 }
 
+static int cortex_m_poll(struct target *target)
+{
+	struct cortex_m_common *cortex_m = target_to_cm(target);
+	struct armv7m_common *armv7m = &cortex_m->armv7m;
+
+	/* Read from Debug Halting Control and Status Register */
+	int retval = mem_ap_read_atomic_u32(armv7m->debug_ap, DCB_DHCSR, &cortex_m->dcb_dhcsr);
+	if (retval != ERROR_OK) {
+		target->state = TARGET_UNKNOWN;
+		return retval;
+	}
+
+	return cortex_m_poll_status(target);
+}
+
+/* Background polling of several cores: the DHCSR reads are queued
+ * and run as one transaction per DAP */
+static void cortex_m_poll_batch(struct target **targets, unsigned count, int *results)
+{
+	struct adiv5_dap_set daps = { .count = 0 };
+	int retval = ERROR_OK;
+
+	for (unsigned i = 0; i < count && retval == ERROR_OK; i++) {
+		struct cortex_m_common *cortex_m = target_to_cm(targets[i]);
+		struct armv7m_common *armv7m = &cortex_m->armv7m;
+
+		retval = dap_set_add(&daps, armv7m->debug_ap->dap);
+		if (retval == ERROR_OK)
+			retval = mem_ap_read_u32(armv7m->debug_ap, DCB_DHCSR, &cortex_m->dcb_dhcsr);
+	}
+	int run = dap_set_run(&daps);
+
+	/* on a failed transaction find out which core is at fault */
+	for (unsigned i = 0; i < count; i++) {
+		if (retval != ERROR_OK || run != ERROR_OK)
+			results[i] = cortex_m_poll(targets[i]);
+		else
+			results[i] = cortex_m_poll_status(targets[i]);
+	}
+}
+
 static int cortex_m_halt(struct target *target)
 {
 	LOG_DEBUG("target->state: %s",
@@ -1788,6 +1823,106 @@ static int cortex_m_write_memory(struct target *target, target_addr_t address,
 	return mem_ap_write_buf(armv7m->debug_ap, buffer, size, count, address);
 }
 
+/* Aligned words go straight into the DAP queue; see cortex_m_mem_batch() */
+static bool cortex_m_mem_batch_queued(const struct target_mem_op *op)
+{
+	return op->size == 4 && !(op->address & 0x3u) && op->address <= UINT32_MAX;
+}
+
+static int cortex_m_mem_batch(struct target *target, struct target_mem_op *ops,
+	unsigned count, unsigned *failed)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+	struct adiv5_ap *ap = armv7m->debug_ap;
+	unsigned first = 0;	/* first operation in the pending DAP queue */
+	int retval = ERROR_OK;
+
+	uint32_t *words = calloc(count, sizeof(*words));
+	if (!words) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	for (unsigned i = 0; i < count; i++) {
+		struct target_mem_op *op = &ops[i];
+
+		if (cortex_m_mem_batch_queued(op)) {
+			if (op->write)
+				retval = mem_ap_write_u32(ap, op->address, op->value);
+			else
+				retval = mem_ap_read_u32(ap, op->address, &words[i]);
+			if (retval != ERROR_OK) {
+				*failed = first;
+				break;
+			}
+			continue;
+		}
+
+		/* other sizes use the buffer path, which runs the queue itself */
+		retval = dap_run(ap->dap);
+		if (retval != ERROR_OK) {
+			*failed = first;
+			break;
+		}
+		first = i;
+
+		uint8_t buf[8];
+		uint32_t size = op->size == 8 ? 4 : op->size;
+		uint32_t n = op->size == 8 ? 2 : 1;
+		if (op->write) {
+			switch (op->size) {
+			case 8:
+				target_buffer_set_u64(target, buf, op->value);
+				break;
+			case 4:
+				target_buffer_set_u32(target, buf, op->value);
+				break;
+			case 2:
+				target_buffer_set_u16(target, buf, op->value);
+				break;
+			default:
+				buf[0] = op->value;
+			}
+			retval = cortex_m_write_memory(target, op->address, size, n, buf);
+		} else {
+			retval = cortex_m_read_memory(target, op->address, size, n, buf);
+			switch (op->size) {
+			case 8:
+				op->value = target_buffer_get_u64(target, buf);
+				break;
+			case 4:
+				op->value = target_buffer_get_u32(target, buf);
+				break;
+			case 2:
+				op->value = target_buffer_get_u16(target, buf);
+				break;
+			default:
+				op->value = buf[0];
+			}
+		}
+		if (retval != ERROR_OK) {
+			*failed = i;
+			break;
+		}
+		first = i + 1;
+	}
+
+	if (retval == ERROR_OK) {
+		retval = dap_run(ap->dap);
+		if (retval != ERROR_OK)
+			*failed = first;
+	}
+
+	unsigned done = retval == ERROR_OK ? count : first;
+	for (unsigned i = 0; i < done; i++) {
+		if (!ops[i].write && cortex_m_mem_batch_queued(&ops[i]))
+			ops[i].value = words[i];
+	}
+
+	free(words);
+	return retval;
+}
+
 static int cortex_m_init_target(struct command_context *cmd_ctx,
 	struct target *target)
 {
@@ -1804,11 +1939,44 @@ void cortex_m_deinit_target(struct target *target)
 
 	cortex_m_dwt_free(target);
 	armv7m_free_reg_cache(target);
+	itm_decoder_free(cortex_m->armv7m.trace_config.itm_decoder);
 
 	free(target->private_config);
 	free(cortex_m);
 }
 
+static int cortex_m_profile_sample(struct target *target, uint32_t *samples,
+	uint32_t max_num_samples, uint32_t *num_samples)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+
+	if (!armv7m->debug_ap)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	/* all reads go out in one queued run of the DAP */
+	int retval = mem_ap_read_buf_noincr(armv7m->debug_ap, (uint8_t *)samples,
+			4, max_num_samples, DWT_PCSR);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* PCSR reads as zero when not implemented, and as all ones while
+	 * the core is halted */
+	uint32_t count = 0;
+	bool implemented = false;
+	for (uint32_t i = 0; i < max_num_samples; i++) {
+		uint32_t pc = target_buffer_get_u32(target, (uint8_t *)&samples[i]);
+		if (pc)
+			implemented = true;
+		if (pc != 0xffffffff)
+			samples[count++] = pc;
+	}
+	if (!implemented)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	*num_samples = count;
+	return ERROR_OK;
+}
+
 int cortex_m_profiling(struct target *target, uint32_t *samples,
 			      uint32_t max_num_samples, uint32_t *num_samples, uint32_t seconds)
 {
@@ -2649,6 +2817,7 @@ struct target_type cortexm_target = {
 	.deprecated_name = "cortex_m3",
 
 	.poll = cortex_m_poll,
+	.poll_batch = cortex_m_poll_batch,
 	.arch_state = armv7m_arch_state,
 
 	.target_request_data = cortex_m_target_request_data,
@@ -2666,6 +2835,8 @@ struct target_type cortexm_target = {
 
 	.read_memory = cortex_m_read_memory,
 	.write_memory = cortex_m_write_memory,
+	.mem_batch = cortex_m_mem_batch,
+	.profile_sample = cortex_m_profile_sample,
 	.checksum_memory = armv7m_checksum_memory,
 	.blank_check_memory = armv7m_blank_check_memory,
 
@@ -0,0 +1,76 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include "mmu_tlb.h"
+
+/* direct mapped; mix in the context so that two address spaces using
+ * the same virtual pages do not evict each other all the time */
+static struct mmu_tlb_entry *mmu_tlb_slot(struct mmu_tlb *tlb,
+		uint64_t context, uint32_t va)
+{
+	uint32_t page = va / MMU_TLB_PAGE_SIZE;
+	uint32_t hash = page ^ (uint32_t)(context >> 14) ^ (uint32_t)(context >> 46);
+
+	return &tlb->entry[hash % MMU_TLB_ENTRIES];
+}
+
+bool mmu_tlb_lookup(struct mmu_tlb *tlb, uint64_t context, uint32_t va,
+		target_addr_t *pa, uint32_t *attr)
+{
+	uint32_t page = va & ~(MMU_TLB_PAGE_SIZE - 1);
+	struct mmu_tlb_entry *e = mmu_tlb_slot(tlb, context, va);
+
+	if (!e->valid || e->va != page || e->context != context) {
+		tlb->misses++;
+		return false;
+	}
+
+	tlb->hits++;
+	*pa = e->pa + (va - page);
+	if (attr)
+		*attr = e->attr;
+	return true;
+}
+
+void mmu_tlb_insert(struct mmu_tlb *tlb, uint64_t context, uint32_t va,
+		target_addr_t pa, uint32_t attr)
+{
+	uint32_t page = va & ~(MMU_TLB_PAGE_SIZE - 1);
+	struct mmu_tlb_entry *e = mmu_tlb_slot(tlb, context, va);
+
+	if (!e->valid)
+		tlb->used++;
+	e->valid = true;
+	e->context = context;
+	e->va = page;
+	e->pa = pa - (va - page);
+	e->attr = attr;
+}
+
+void mmu_tlb_flush(struct mmu_tlb *tlb)
+{
+	if (!tlb->used)
+		return;
+
+	for (unsigned i = 0; i < MMU_TLB_ENTRIES; i++)
+		tlb->entry[i].valid = false;
+	tlb->used = 0;
+	tlb->flushes++;
+}
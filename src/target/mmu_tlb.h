@@ -0,0 +1,61 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef OPENOCD_TARGET_MMU_TLB_H
+#define OPENOCD_TARGET_MMU_TLB_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <helper/types.h>
+
+/**
+ * @file
+ * Host side cache of virtual to physical translations, so repeated
+ * accesses to the same page do not walk the page tables on the target
+ * again.  Entries are tagged with a context, e.g. the translation table
+ * base, and the whole cache is dropped whenever the target runs.
+ */
+
+#define MMU_TLB_PAGE_SIZE	4096
+#define MMU_TLB_ENTRIES		256
+
+struct mmu_tlb_entry {
+	bool valid;
+	uint64_t context;
+	uint32_t va;
+	target_addr_t pa;
+	uint32_t attr;
+};
+
+struct mmu_tlb {
+	struct mmu_tlb_entry entry[MMU_TLB_ENTRIES];
+	unsigned used;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t flushes;
+};
+
+/**
+ * Looks up the page holding @a va; on a hit stores the translated
+ * address in @a pa and the attributes of the mapping in @a attr.
+ */
+bool mmu_tlb_lookup(struct mmu_tlb *tlb, uint64_t context, uint32_t va,
+		target_addr_t *pa, uint32_t *attr);
+/** Remembers that @a va translates to @a pa; only the page is kept. */
+void mmu_tlb_insert(struct mmu_tlb *tlb, uint64_t context, uint32_t va,
+		target_addr_t pa, uint32_t attr);
+void mmu_tlb_flush(struct mmu_tlb *tlb);
+
+#endif /* OPENOCD_TARGET_MMU_TLB_H */
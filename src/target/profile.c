@@ -0,0 +1,315 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <helper/log.h>
+#include "target.h"
+#include "profile.h"
+
+#define PROFILE_HIST_MIN_BITS	10
+
+/* Open addressing hash of sampled addresses; a bucket with a zero count
+ * is free.  The table doubles once it is three quarters full. */
+struct profile_hist {
+	struct profile_bucket *buckets;
+	unsigned bits;
+	uint32_t used;
+	uint64_t samples;
+};
+
+static uint32_t profile_hash(const struct profile_hist *hist, uint32_t pc)
+{
+	return (pc * 0x9e3779b1u) >> (32 - hist->bits);
+}
+
+static struct profile_bucket *profile_hist_find(struct profile_hist *hist, uint32_t pc)
+{
+	uint32_t mask = (1u << hist->bits) - 1;
+	uint32_t i = profile_hash(hist, pc);
+
+	while (hist->buckets[i].count && hist->buckets[i].pc != pc)
+		i = (i + 1) & mask;
+	return &hist->buckets[i];
+}
+
+static int profile_hist_resize(struct profile_hist *hist, unsigned bits)
+{
+	struct profile_bucket *old = hist->buckets;
+	uint32_t old_size = old ? 1u << hist->bits : 0;
+
+	hist->buckets = calloc(1u << bits, sizeof(*hist->buckets));
+	if (!hist->buckets) {
+		hist->buckets = old;
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+	hist->bits = bits;
+
+	for (uint32_t i = 0; i < old_size; i++) {
+		if (old[i].count)
+			*profile_hist_find(hist, old[i].pc) = old[i];
+	}
+	free(old);
+	return ERROR_OK;
+}
+
+struct profile_hist *profile_hist_new(void)
+{
+	struct profile_hist *hist = calloc(1, sizeof(*hist));
+	if (!hist || profile_hist_resize(hist, PROFILE_HIST_MIN_BITS) != ERROR_OK) {
+		free(hist);
+		return NULL;
+	}
+	return hist;
+}
+
+void profile_hist_free(struct profile_hist *hist)
+{
+	if (!hist)
+		return;
+	free(hist->buckets);
+	free(hist);
+}
+
+int profile_hist_add(struct profile_hist *hist, const uint32_t *samples,
+		uint32_t num_samples)
+{
+	for (uint32_t i = 0; i < num_samples; i++) {
+		if (4 * (hist->used + 1) > 3 * (1u << hist->bits)) {
+			int retval = profile_hist_resize(hist, hist->bits + 1);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+
+		struct profile_bucket *b = profile_hist_find(hist, samples[i]);
+		if (!b->count) {
+			b->pc = samples[i];
+			hist->used++;
+		}
+		if (b->count != UINT32_MAX)
+			b->count++;
+	}
+	hist->samples += num_samples;
+
+	return ERROR_OK;
+}
+
+uint64_t profile_hist_samples(const struct profile_hist *hist)
+{
+	return hist->samples;
+}
+
+uint32_t profile_hist_addresses(const struct profile_hist *hist)
+{
+	return hist->used;
+}
+
+/* Returns the used buckets in a new array, sorted by address */
+static struct profile_bucket *profile_hist_sorted(const struct profile_hist *hist,
+		int (*compare)(const void *, const void *))
+{
+	struct profile_bucket *sorted = malloc((hist->used + 1) * sizeof(*sorted));
+	if (!sorted) {
+		LOG_ERROR("Out of memory");
+		return NULL;
+	}
+
+	uint32_t n = 0;
+	for (uint32_t i = 0; i < (1u << hist->bits); i++) {
+		if (hist->buckets[i].count)
+			sorted[n++] = hist->buckets[i];
+	}
+	qsort(sorted, n, sizeof(*sorted), compare);
+
+	return sorted;
+}
+
+static int profile_compare_pc(const void *a, const void *b)
+{
+	const struct profile_bucket *x = a, *y = b;
+	return (x->pc > y->pc) - (x->pc < y->pc);
+}
+
+static int profile_compare_count(const void *a, const void *b)
+{
+	const struct profile_bucket *x = a, *y = b;
+	return (x->count < y->count) - (x->count > y->count);
+}
+
+uint32_t profile_hist_top(const struct profile_hist *hist,
+		struct profile_bucket *top, uint32_t max)
+{
+	struct profile_bucket *sorted = profile_hist_sorted(hist, profile_compare_count);
+	if (!sorted)
+		return 0;
+
+	uint32_t n = MIN(max, hist->used);
+	memcpy(top, sorted, n * sizeof(*top));
+	free(sorted);
+
+	return n;
+}
+
+static void writeData(FILE *f, const void *data, size_t len)
+{
+	size_t written = fwrite(data, 1, len, f);
+	if (written != len)
+		LOG_ERROR("failed to write %zu bytes: %s", len, strerror(errno));
+}
+
+static void writeLong(FILE *f, int l, struct target *target)
+{
+	uint8_t val[4];
+
+	target_buffer_set_u32(target, val, l);
+	writeData(f, val, 4);
+}
+
+static void writeString(FILE *f, char *s)
+{
+	writeData(f, s, strlen(s));
+}
+
+typedef unsigned char UNIT[2];  /* unit of profiling */
+
+/* Dump a gmon.out histogram file. */
+int profile_hist_write_gmon(const struct profile_hist *hist, const char *filename,
+		bool with_range, uint32_t start_address, uint32_t end_address,
+		struct target *target, uint32_t duration_ms)
+{
+	uint32_t i;
+
+	if (!hist->used) {
+		LOG_ERROR("No profiling samples to write");
+		return ERROR_FAIL;
+	}
+
+	struct profile_bucket *sorted = profile_hist_sorted(hist, profile_compare_pc);
+	if (!sorted)
+		return ERROR_FAIL;
+
+	FILE *f = fopen(filename, "w");
+	if (f == NULL) {
+		free(sorted);
+		LOG_ERROR("Can't open %s: %s", filename, strerror(errno));
+		return ERROR_FAIL;
+	}
+	writeString(f, "gmon");
+	writeLong(f, 0x00000001, target); /* Version */
+	writeLong(f, 0, target); /* padding */
+	writeLong(f, 0, target); /* padding */
+	writeLong(f, 0, target); /* padding */
+
+	uint8_t zero = 0;  /* GMON_TAG_TIME_HIST */
+	writeData(f, &zero, 1);
+
+	/* figure out bucket size */
+	uint32_t min;
+	uint32_t max;
+	if (with_range) {
+		min = start_address;
+		max = end_address;
+	} else {
+		min = sorted[0].pc;
+		/* max should be (largest sample + 1)
+		 * Refer to binutils/gprof/hist.c (find_histogram_for_pc) */
+		max = sorted[hist->used - 1].pc + 1;
+	}
+
+	uint32_t addressSpace = max - min;
+	if (addressSpace < 2)
+		addressSpace = 2;
+
+	/* FIXME: What is the reasonable number of buckets?
+	 * The profiling result will be more accurate if there are enough buckets. */
+	static const uint32_t maxBuckets = 128 * 1024; /* maximum buckets. */
+	uint32_t numBuckets = addressSpace / sizeof(UNIT);
+	if (numBuckets > maxBuckets)
+		numBuckets = maxBuckets;
+	uint32_t *buckets = calloc(numBuckets, sizeof(*buckets));
+	if (buckets == NULL) {
+		free(sorted);
+		fclose(f);
+		return ERROR_FAIL;
+	}
+	for (i = 0; i < hist->used; i++) {
+		uint32_t address = sorted[i].pc;
+
+		if ((address < min) || (max <= address))
+			continue;
+
+		uint64_t index_t = (uint64_t)(address - min) * numBuckets / addressSpace;
+		buckets[index_t] += sorted[i].count;
+	}
+	free(sorted);
+
+	/* append binary memory gmon.out &profile_hist_hdr ((char*)&profile_hist_hdr + sizeof(struct gmon_hist_hdr)) */
+	writeLong(f, min, target);			/* low_pc */
+	writeLong(f, max, target);			/* high_pc */
+	writeLong(f, numBuckets, target);	/* # of buckets */
+	float sample_rate = hist->samples / (MAX(duration_ms, 1) / 1000.0);
+	writeLong(f, sample_rate, target);
+	writeString(f, "seconds");
+	for (i = 0; i < (15-strlen("seconds")); i++)
+		writeData(f, &zero, 1);
+	writeString(f, "s");
+
+	/*append binary memory gmon.out profile_hist_data (profile_hist_data + profile_hist_hdr.hist_size) */
+
+	char *data = malloc(2 * numBuckets);
+	if (data != NULL) {
+		for (i = 0; i < numBuckets; i++) {
+			uint32_t val = MIN(buckets[i], 65535);
+			data[i * 2] = val & 0xff;
+			data[i * 2 + 1] = (val >> 8) & 0xff;
+		}
+		writeData(f, data, numBuckets * 2);
+		free(data);
+	}
+	free(buckets);
+
+	fclose(f);
+	return ERROR_OK;
+}
+
+/* One "frame count" line per address, as consumed by flame graph tools;
+ * without unwinding every stack is a single frame. */
+int profile_hist_write_folded(const struct profile_hist *hist, const char *filename)
+{
+	struct profile_bucket *sorted = profile_hist_sorted(hist, profile_compare_pc);
+	if (!sorted)
+		return ERROR_FAIL;
+
+	FILE *f = fopen(filename, "w");
+	if (f == NULL) {
+		free(sorted);
+		LOG_ERROR("Can't open %s: %s", filename, strerror(errno));
+		return ERROR_FAIL;
+	}
+
+	for (uint32_t i = 0; i < hist->used; i++)
+		fprintf(f, "0x%08" PRIx32 " %" PRIu32 "\n", sorted[i].pc, sorted[i].count);
+
+	free(sorted);
+	int retval = ferror(f) ? ERROR_FAIL : ERROR_OK;
+	if (fclose(f) || retval != ERROR_OK) {
+		LOG_ERROR("failed to write %s", filename);
+		return ERROR_FAIL;
+	}
+	return ERROR_OK;
+}
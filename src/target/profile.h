@@ -0,0 +1,60 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef OPENOCD_TARGET_PROFILE_H
+#define OPENOCD_TARGET_PROFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct target;
+
+/**
+ * @file
+ * Address histogram of program counter samples, filled incrementally
+ * while profiling runs and written out as gmon.out or folded stacks.
+ */
+
+struct profile_bucket {
+	uint32_t pc;
+	uint32_t count;
+};
+
+struct profile_hist;
+
+struct profile_hist *profile_hist_new(void);
+void profile_hist_free(struct profile_hist *hist);
+
+int profile_hist_add(struct profile_hist *hist, const uint32_t *samples,
+		uint32_t num_samples);
+
+/** Total number of samples added. */
+uint64_t profile_hist_samples(const struct profile_hist *hist);
+/** Number of distinct addresses sampled. */
+uint32_t profile_hist_addresses(const struct profile_hist *hist);
+
+/**
+ * Copies the @a max most frequent addresses to @a top, most frequent
+ * first, and returns how many were copied.
+ */
+uint32_t profile_hist_top(const struct profile_hist *hist,
+		struct profile_bucket *top, uint32_t max);
+
+int profile_hist_write_gmon(const struct profile_hist *hist, const char *filename,
+		bool with_range, uint32_t start_address, uint32_t end_address,
+		struct target *target, uint32_t duration_ms);
+int profile_hist_write_folded(const struct profile_hist *hist, const char *filename);
+
+#endif /* OPENOCD_TARGET_PROFILE_H */
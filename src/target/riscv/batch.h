@@ -54,7 +54,9 @@ int riscv_batch_run(struct riscv_batch *batch);
 void riscv_batch_add_dmi_write(struct riscv_batch *batch, unsigned address, uint64_t data);
 
 /* DMI reads must be handled in two parts: the first one schedules a read and
- * provides a key, the second one actually obtains the value of that read .*/
+ * provides a key, the second one actually obtains the value of that read .
+ * The value is captured by the scan following the read, so consecutive reads
+ * are pipelined. */
 size_t riscv_batch_add_dmi_read(struct riscv_batch *batch, unsigned address);
 uint64_t riscv_batch_get_dmi_read(struct riscv_batch *batch, size_t key);
 
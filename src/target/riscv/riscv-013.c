@@ -37,6 +37,8 @@ static void riscv013_clear_abstract_error(struct target *target);
 /* Implementations of the functions in riscv_info_t. */
 static int riscv013_get_register(struct target *target,
 		riscv_reg_t *value, int hid, int rid);
+static int riscv013_read_registers(struct target *target, const uint32_t *numbers,
+		unsigned count, riscv_reg_t *values, bool *read);
 static int riscv013_set_register(struct target *target, int hartid, int regid, uint64_t value);
 static int riscv013_select_current_hart(struct target *target);
 static int riscv013_halt_current_hart(struct target *target);
@@ -71,6 +73,8 @@ void write_memory_sba_simple(struct target *target, target_addr_t addr, uint32_t
 void read_memory_sba_simple(struct target *target, target_addr_t addr,
 		uint32_t *rd_buf, uint32_t read_size, uint32_t sbcs);
 static int	riscv013_test_compliance(struct target *target);
+static void riscv013_get_delays(struct target *target, struct riscv_delays *delays);
+static void riscv013_set_delays(struct target *target, const struct riscv_delays *delays);
 
 /**
  * Since almost everything can be accomplish by scanning the dbus register, all
@@ -194,10 +198,21 @@ typedef struct {
 	 * go low. */
 	unsigned int ac_busy_delay;
 
+	/* Number of scans queued per batch.  It grows while batches go through
+	 * without a busy response, and is halved on every busy response. */
+	unsigned int batch_scans;
+
+	/* Scans since the last busy response.  Once enough of them are counted,
+	 * the delays above are reduced again. */
+	unsigned int clean_scans;
+
 	bool abstract_read_csr_supported;
 	bool abstract_write_csr_supported;
 	bool abstract_read_fpr_supported;
 	bool abstract_write_fpr_supported;
+	/* Cleared once a batched register read with FPRs in it failed.  FPRs
+	 * are then read one at a time, which finds out why. */
+	bool batch_read_fpr_supported;
 
 	/* When a function returns some error due to a failure indicated by the
 	 * target in cmderr, the caller can look here to see what that error was.
@@ -428,9 +443,50 @@ static uint32_t dtmcontrol_scan(struct target *target, uint32_t out)
 	return in;
 }
 
+/* Batches start this small and grow up to the maximum */
+#define BATCH_MIN_SCANS		32
+#define BATCH_MAX_SCANS		1024
+
+/* Learned delays are reduced after this many scans without a busy response */
+#define BUSY_DECAY_SCANS	4096
+
+static void busy_seen(riscv013_info_t *info)
+{
+	info->clean_scans = 0;
+	info->batch_scans = MAX(info->batch_scans / 2, BATCH_MIN_SCANS);
+}
+
+/* Counts scans that went through without a busy response.  When the busy
+ * rate stays this low, the delays learned earlier are slowly given back,
+ * so a single busy response does not slow down every later access. */
+static void clean_scans_seen(struct target *target, size_t scans)
+{
+	riscv013_info_t *info = get_info(target);
+	info->clean_scans += scans;
+	if (info->clean_scans < BUSY_DECAY_SCANS)
+		return;
+	info->clean_scans = 0;
+
+	if (!info->dmi_busy_delay && !info->ac_busy_delay &&
+			!info->bus_master_read_delay && !info->bus_master_write_delay)
+		return;
+	if (info->dmi_busy_delay)
+		info->dmi_busy_delay -= info->dmi_busy_delay / 8 + 1;
+	if (info->ac_busy_delay)
+		info->ac_busy_delay -= info->ac_busy_delay / 8 + 1;
+	if (info->bus_master_read_delay)
+		info->bus_master_read_delay -= info->bus_master_read_delay / 8 + 1;
+	if (info->bus_master_write_delay)
+		info->bus_master_write_delay -= info->bus_master_write_delay / 8 + 1;
+	LOG_DEBUG("dmi_busy_delay=%d, ac_busy_delay=%d, bus_master_read_delay=%d, "
+			"bus_master_write_delay=%d", info->dmi_busy_delay, info->ac_busy_delay,
+			info->bus_master_read_delay, info->bus_master_write_delay);
+}
+
 static void increase_dmi_busy_delay(struct target *target)
 {
 	riscv013_info_t *info = get_info(target);
+	busy_seen(info);
 	info->dmi_busy_delay += info->dmi_busy_delay / 10 + 1;
 	LOG_DEBUG("dtmcs_idle=%d, dmi_busy_delay=%d, ac_busy_delay=%d",
 			info->dtmcs_idle, info->dmi_busy_delay,
@@ -464,6 +520,7 @@ static dmi_status_t dmi_scan(struct target *target, uint32_t *address_in,
 		if (r->reset_delays_wait < 0) {
 			info->dmi_busy_delay = 0;
 			info->ac_busy_delay = 0;
+			info->batch_scans = BATCH_MIN_SCANS;
 		}
 	}
 
@@ -499,7 +556,10 @@ static dmi_status_t dmi_scan(struct target *target, uint32_t *address_in,
 
 	dump_field(idle_count, &field);
 
-	return buf_get_u32(in, DTM_DMI_OP_OFFSET, DTM_DMI_OP_LENGTH);
+	dmi_status_t status = buf_get_u32(in, DTM_DMI_OP_OFFSET, DTM_DMI_OP_LENGTH);
+	if (status == DMI_STATUS_SUCCESS)
+		clean_scans_seen(target, 1);
+	return status;
 }
 
 /* If dmi_busy_encountered is non-NULL, this function will use it to tell the
@@ -652,6 +712,7 @@ int dmstatus_read(struct target *target, uint32_t *dmstatus,
 static void increase_ac_busy_delay(struct target *target)
 {
 	riscv013_info_t *info = get_info(target);
+	busy_seen(info);
 	info->ac_busy_delay += info->ac_busy_delay / 10 + 1;
 	LOG_DEBUG("dtmcs_idle=%d, dmi_busy_delay=%d, ac_busy_delay=%d",
 			info->dtmcs_idle, info->dmi_busy_delay,
@@ -1587,6 +1648,27 @@ int riscv013_authdata_write(struct target *target, uint32_t value)
 	return ERROR_OK;
 }
 
+static void riscv013_get_delays(struct target *target, struct riscv_delays *delays)
+{
+	RISCV013_INFO(info);
+	delays->dmi_busy = info->dmi_busy_delay;
+	delays->ac_busy = info->ac_busy_delay;
+	delays->bus_master_read = info->bus_master_read_delay;
+	delays->bus_master_write = info->bus_master_write_delay;
+	delays->batch_scans = info->batch_scans;
+}
+
+static void riscv013_set_delays(struct target *target, const struct riscv_delays *delays)
+{
+	RISCV013_INFO(info);
+	info->dmi_busy_delay = delays->dmi_busy;
+	info->ac_busy_delay = delays->ac_busy;
+	info->bus_master_read_delay = delays->bus_master_read;
+	info->bus_master_write_delay = delays->bus_master_write;
+	info->batch_scans = MIN(MAX(delays->batch_scans, BATCH_MIN_SCANS), BATCH_MAX_SCANS);
+	info->clean_scans = 0;
+}
+
 static int init_target(struct command_context *cmd_ctx,
 		struct target *target)
 {
@@ -1594,6 +1676,7 @@ static int init_target(struct command_context *cmd_ctx,
 	riscv_info_t *generic_info = (riscv_info_t *) target->arch_info;
 
 	generic_info->get_register = &riscv013_get_register;
+	generic_info->read_registers = &riscv013_read_registers;
 	generic_info->set_register = &riscv013_set_register;
 	generic_info->select_current_hart = &riscv013_select_current_hart;
 	generic_info->is_halted = &riscv013_is_halted;
@@ -1617,6 +1700,8 @@ static int init_target(struct command_context *cmd_ctx,
 	generic_info->dmi_write = &dmi_write;
 	generic_info->test_sba_config_reg = &riscv013_test_sba_config_reg;
 	generic_info->test_compliance = &riscv013_test_compliance;
+	generic_info->get_delays = &riscv013_get_delays;
+	generic_info->set_delays = &riscv013_set_delays;
 	generic_info->version_specific = calloc(1, sizeof(riscv013_info_t));
 	if (!generic_info->version_specific)
 		return ERROR_FAIL;
@@ -1628,6 +1713,9 @@ static int init_target(struct command_context *cmd_ctx,
 	info->bus_master_read_delay = 0;
 	info->bus_master_write_delay = 0;
 	info->ac_busy_delay = 0;
+	info->batch_scans = BATCH_MIN_SCANS;
+	if (generic_info->delays_configured)
+		riscv013_set_delays(target, &generic_info->configured_delays);
 
 	/* Assume all these abstract commands are supported until we learn
 	 * otherwise.
@@ -1638,6 +1726,7 @@ static int init_target(struct command_context *cmd_ctx,
 	info->abstract_write_csr_supported = true;
 	info->abstract_read_fpr_supported = true;
 	info->abstract_write_fpr_supported = true;
+	info->batch_read_fpr_supported = true;
 
 	return ERROR_OK;
 }
@@ -1835,37 +1924,6 @@ static void log_memory_access(target_addr_t address, uint64_t value,
 	LOG_DEBUG(fmt, value);
 }
 
-/* Read the relevant sbdata regs depending on size, and put the results into
- * buffer. */
-static int read_memory_bus_word(struct target *target, target_addr_t address,
-		uint32_t size, uint8_t *buffer)
-{
-	uint32_t value;
-	if (size > 12) {
-		if (dmi_read(target, &value, DMI_SBDATA3) != ERROR_OK)
-			return ERROR_FAIL;
-		write_to_buf(buffer + 12, value, 4);
-		log_memory_access(address + 12, value, 4, true);
-	}
-	if (size > 8) {
-		if (dmi_read(target, &value, DMI_SBDATA2) != ERROR_OK)
-			return ERROR_FAIL;
-		write_to_buf(buffer + 8, value, 4);
-		log_memory_access(address + 8, value, 4, true);
-	}
-	if (size > 4) {
-		if (dmi_read(target, &value, DMI_SBDATA1) != ERROR_OK)
-			return ERROR_FAIL;
-		write_to_buf(buffer + 4, value, 4);
-		log_memory_access(address + 4, value, 4, true);
-	}
-	if (dmi_read(target, &value, DMI_SBDATA0) != ERROR_OK)
-		return ERROR_FAIL;
-	write_to_buf(buffer, value, MIN(size, 4));
-	log_memory_access(address, value, MIN(size, 4), true);
-	return ERROR_OK;
-}
-
 static uint32_t sb_sbaccess(unsigned size_bytes)
 {
 	switch (size_bytes) {
@@ -2014,8 +2072,75 @@ static int read_memory_bus_v0(struct target *target, target_addr_t address,
 	return ERROR_OK;
 }
 
+/* Returns whether any operation in a batch that was run got a busy
+ * response.  The DTM ignores everything after that until dmireset. */
+static bool batch_dmi_busy(struct riscv_batch *batch)
+{
+	for (size_t i = 0; i < batch->used_scans; i++) {
+		struct scan_field *field = batch->fields + i;
+		uint64_t in = buf_get_u64(field->in_value, 0, field->num_bits);
+		if (get_field(in, DTM_DMI_OP) == DMI_STATUS_BUSY)
+			return true;
+	}
+	return false;
+}
+
+static int batch_run(struct target *target, struct riscv_batch *batch)
+{
+	RISCV013_INFO(info);
+	RISCV_INFO(r);
+	if (r->reset_delays_wait >= 0) {
+		r->reset_delays_wait -= batch->used_scans;
+		if (r->reset_delays_wait <= 0) {
+			batch->idle_count = 0;
+			info->dmi_busy_delay = 0;
+			info->ac_busy_delay = 0;
+			info->batch_scans = BATCH_MIN_SCANS;
+		}
+	}
+
+	int result = riscv_batch_run(batch);
+	if (result != ERROR_OK || batch_dmi_busy(batch))
+		return result;
+
+	clean_scans_seen(target, batch->used_scans);
+	/* The target kept up with a batch of about the current size; try a
+	 * bigger one next time */
+	if (2 * batch->used_scans >= batch->allocated_scans)
+		info->batch_scans = MIN(info->batch_scans + info->batch_scans / 4,
+				BATCH_MAX_SCANS);
+	return ERROR_OK;
+}
+
+static const unsigned sbdata[4] = { DMI_SBDATA0, DMI_SBDATA1, DMI_SBDATA2, DMI_SBDATA3 };
+
+/* After an sbbusyerror or a busy DMI response some accesses did not happen.
+ * sbaddress points past the last bus access that was started.  For reads
+ * the data of that access may not have reached us yet, so it is repeated;
+ * data lost to a busy DMI response is handled by the caller. */
+static int sb_resume_address(struct target *target, target_addr_t batch_address,
+		target_addr_t end_address, uint32_t size, bool read, target_addr_t *next_address)
+{
+	if (dmi_write(target, DMI_SBCS, DMI_SBCS_SBBUSYERROR) != ERROR_OK)
+		return ERROR_FAIL;
+
+	target_addr_t address = sb_read_address(target);
+	if (read)
+		address -= size;
+	if (address < batch_address || address > end_address) {
+		LOG_DEBUG("sbaddress 0x%" TARGET_PRIxADDR " is outside the batch, "
+				"repeating it from 0x%" TARGET_PRIxADDR, address, batch_address);
+		address = batch_address;
+	}
+	*next_address = address;
+	return ERROR_OK;
+}
+
 /**
- * Read the requested memory using the system bus interface.
+ * Read the requested memory using the system bus interface.  The sbdata
+ * reads are queued in batches; every sbdata0 read but the last one starts
+ * the next bus access, and the bus access time is spent as idle cycles
+ * after each scan.
  */
 static int read_memory_bus_v1(struct target *target, target_addr_t address,
 		uint32_t size, uint32_t count, uint8_t *buffer)
@@ -2023,6 +2148,7 @@ static int read_memory_bus_v1(struct target *target, target_addr_t address,
 	RISCV013_INFO(info);
 	target_addr_t next_address = address;
 	target_addr_t end_address = address + count * size;
+	unsigned words = DIV_ROUND_UP(size, 4);
 
 	while (next_address < end_address) {
 		uint32_t sbcs = set_field(0, DMI_SBCS_SBREADONADDR, 1);
@@ -2034,65 +2160,89 @@ static int read_memory_bus_v1(struct target *target, target_addr_t address,
 		/* This address write will trigger the first read. */
 		sb_write_address(target, next_address);
 
-		if (info->bus_master_read_delay) {
-			jtag_add_runtest(info->bus_master_read_delay, TAP_IDLE);
-			if (jtag_execute_queue() != ERROR_OK) {
-				LOG_ERROR("Failed to scan idle sequence");
+		bool retry = false;
+		while (next_address < end_address && !retry) {
+			/* each access takes a read of every sbdata register it uses,
+			 * the last one an sbcs write as well */
+			unsigned scans = info->batch_scans;
+			uint32_t start = (next_address - address) / size;
+			uint32_t n = MIN(count - start, scans / (words + 1));
+
+			struct riscv_batch *batch = riscv_batch_alloc(target, scans,
+					info->dmi_busy_delay + info->bus_master_read_delay);
+			for (uint32_t i = start; i < start + n; i++) {
+				if (count > 1 && i == count - 1)
+					riscv_batch_add_dmi_write(batch, DMI_SBCS,
+							set_field(sbcs, DMI_SBCS_SBREADONDATA, 0));
+				for (unsigned j = words; j-- > 0; )
+					riscv_batch_add_dmi_read(batch, sbdata[j]);
+			}
+
+			if (batch_run(target, batch) != ERROR_OK) {
+				riscv_batch_free(batch);
 				return ERROR_FAIL;
 			}
-		}
 
-		for (uint32_t i = (next_address - address) / size; i < count - 1; i++) {
-			read_memory_bus_word(target, address + i * size, size,
-					buffer + i * size);
-		}
+			/* After a busy response the DTM ignores the rest of the batch;
+			 * only take the elements whose reads all succeeded, the data
+			 * captured for the others is garbage */
+			size_t key = 0;
+			uint32_t received = n;
+			for (uint32_t i = start; i < start + n; i++) {
+				for (unsigned j = words; j-- > 0; key++) {
+					uint64_t dmi_out = riscv_batch_get_dmi_read(batch, key);
+					if (received == n &&
+							get_field(dmi_out, DTM_DMI_OP) != DMI_STATUS_SUCCESS)
+						received = i - start;
+					if (i - start >= received)
+						continue;
+					uint32_t value = get_field(dmi_out, DTM_DMI_DATA);
+					write_to_buf(buffer + i * size + 4 * j, value, MIN(size, 4));
+					log_memory_access(address + i * size + 4 * j, value,
+							MIN(size, 4), true);
+				}
+			}
 
-		sbcs = set_field(sbcs, DMI_SBCS_SBREADONDATA, 0);
-		dmi_write(target, DMI_SBCS, sbcs);
+			bool dmi_busy = batch_dmi_busy(batch);
+			riscv_batch_free(batch);
+			if (dmi_busy)
+				increase_dmi_busy_delay(target);
 
-		read_memory_bus_word(target, address + (count - 1) * size, size,
-				buffer + (count - 1) * size);
+			if (read_sbcs_nonbusy(target, &sbcs) != ERROR_OK)
+				return ERROR_FAIL;
 
-		if (read_sbcs_nonbusy(target, &sbcs) != ERROR_OK)
-			return ERROR_FAIL;
+			if (get_field(sbcs, DMI_SBCS_SBBUSYERROR) || dmi_busy) {
+				/* We read while the target was busy. Slow down and try again,
+				 * from the first element that didn't arrive intact. */
+				target_addr_t resume_address = next_address + received * size;
+				if (get_field(sbcs, DMI_SBCS_SBBUSYERROR)) {
+					info->bus_master_read_delay += info->bus_master_read_delay / 10 + 1;
+					target_addr_t sb_address;
+					if (sb_resume_address(target, next_address, end_address, size, true,
+								&sb_address) != ERROR_OK)
+						return ERROR_FAIL;
+					resume_address = MIN(resume_address, sb_address);
+				}
+				next_address = resume_address;
+				retry = true;
+				continue;
+			}
 
-		if (get_field(sbcs, DMI_SBCS_SBBUSYERROR)) {
-			/* We read while the target was busy. Slow down and try again. */
-			dmi_write(target, DMI_SBCS, DMI_SBCS_SBBUSYERROR);
-			next_address = sb_read_address(target);
-			info->bus_master_read_delay += info->bus_master_read_delay / 10 + 1;
-			continue;
-		}
+			unsigned error = get_field(sbcs, DMI_SBCS_SBERROR);
+			if (error != 0) {
+				/* Some error indicating the bus access failed, but not because of
+				 * something we did wrong. */
+				dmi_write(target, DMI_SBCS, DMI_SBCS_SBERROR);
+				return ERROR_FAIL;
+			}
 
-		unsigned error = get_field(sbcs, DMI_SBCS_SBERROR);
-		if (error == 0) {
-			next_address = end_address;
-		} else {
-			/* Some error indicating the bus access failed, but not because of
-			 * something we did wrong. */
-			dmi_write(target, DMI_SBCS, DMI_SBCS_SBERROR);
-			return ERROR_FAIL;
+			next_address += n * size;
 		}
 	}
 
 	return ERROR_OK;
 }
 
-static int batch_run(const struct target *target, struct riscv_batch *batch)
-{
-	RISCV013_INFO(info);
-	RISCV_INFO(r);
-	if (r->reset_delays_wait >= 0) {
-		r->reset_delays_wait -= batch->used_scans;
-		if (r->reset_delays_wait <= 0) {
-			batch->idle_count = 0;
-			info->dmi_busy_delay = 0;
-			info->ac_busy_delay = 0;
-		}
-	}
-	return riscv_batch_run(batch);
-}
-
 /**
  * Read the requested memory, taking care to execute every read exactly once,
  * even if cmderr=busy is encountered.
@@ -2152,7 +2302,7 @@ static int read_memory_progbuf_inner(struct target *target, target_addr_t addres
 		LOG_DEBUG("creating burst to read from 0x%" PRIx64
 				" up to 0x%" PRIx64, read_addr, fin_addr);
 		assert(read_addr >= address && read_addr < fin_addr);
-		struct riscv_batch *batch = riscv_batch_alloc(target, 32,
+		struct riscv_batch *batch = riscv_batch_alloc(target, info->batch_scans,
 				info->dmi_busy_delay + info->ac_busy_delay);
 
 		size_t reads = 0;
@@ -2504,69 +2654,59 @@ static int write_memory_bus_v1(struct target *target, target_addr_t address,
 
 	target_addr_t next_address = address;
 	target_addr_t end_address = address + count * size;
+	unsigned words = DIV_ROUND_UP(size, 4);
 
 	sb_write_address(target, next_address);
 	while (next_address < end_address) {
-		for (uint32_t i = (next_address - address) / size; i < count; i++) {
+		unsigned scans = info->batch_scans;
+		uint32_t start = (next_address - address) / size;
+		uint32_t n = MIN(count - start, scans / words);
+
+		/* Every sbdata0 write starts a bus access */
+		struct riscv_batch *batch = riscv_batch_alloc(target, scans,
+				info->dmi_busy_delay + info->bus_master_write_delay);
+		for (uint32_t i = start; i < start + n; i++) {
 			const uint8_t *p = buffer + i * size;
-			if (size > 12)
-				dmi_write(target, DMI_SBDATA3,
-						((uint32_t) p[12]) |
-						(((uint32_t) p[13]) << 8) |
-						(((uint32_t) p[14]) << 16) |
-						(((uint32_t) p[15]) << 24));
-			if (size > 8)
-				dmi_write(target, DMI_SBDATA2,
-						((uint32_t) p[8]) |
-						(((uint32_t) p[9]) << 8) |
-						(((uint32_t) p[10]) << 16) |
-						(((uint32_t) p[11]) << 24));
-			if (size > 4)
-				dmi_write(target, DMI_SBDATA1,
-						((uint32_t) p[4]) |
-						(((uint32_t) p[5]) << 8) |
-						(((uint32_t) p[6]) << 16) |
-						(((uint32_t) p[7]) << 24));
-			uint32_t value = p[0];
-			if (size > 2) {
-				value |= ((uint32_t) p[2]) << 16;
-				value |= ((uint32_t) p[3]) << 24;
+			for (unsigned j = words; j-- > 0; ) {
+				uint32_t value = buf_get_u32(p + 4 * j, 0, 8 * MIN(size, 4));
+				riscv_batch_add_dmi_write(batch, sbdata[j], value);
+				log_memory_access(address + i * size + 4 * j, value,
+						MIN(size, 4), false);
 			}
-			if (size > 1)
-				value |= ((uint32_t) p[1]) << 8;
-			dmi_write(target, DMI_SBDATA0, value);
-
-			log_memory_access(address + i * size, value, size, false);
+		}
 
-			if (info->bus_master_write_delay) {
-				jtag_add_runtest(info->bus_master_write_delay, TAP_IDLE);
-				if (jtag_execute_queue() != ERROR_OK) {
-					LOG_ERROR("Failed to scan idle sequence");
-					return ERROR_FAIL;
-				}
-			}
+		if (batch_run(target, batch) != ERROR_OK) {
+			riscv_batch_free(batch);
+			return ERROR_FAIL;
 		}
+		bool dmi_busy = batch_dmi_busy(batch);
+		riscv_batch_free(batch);
+		if (dmi_busy)
+			increase_dmi_busy_delay(target);
 
 		if (read_sbcs_nonbusy(target, &sbcs) != ERROR_OK)
 			return ERROR_FAIL;
 
-		if (get_field(sbcs, DMI_SBCS_SBBUSYERROR)) {
+		if (get_field(sbcs, DMI_SBCS_SBBUSYERROR) || dmi_busy) {
 			/* We wrote while the target was busy. Slow down and try again. */
-			dmi_write(target, DMI_SBCS, DMI_SBCS_SBBUSYERROR);
-			next_address = sb_read_address(target);
-			info->bus_master_write_delay += info->bus_master_write_delay / 10 + 1;
+			if (get_field(sbcs, DMI_SBCS_SBBUSYERROR))
+				info->bus_master_write_delay += info->bus_master_write_delay / 10 + 1;
+			if (sb_resume_address(target, next_address, end_address, size, false,
+						&next_address) != ERROR_OK)
+				return ERROR_FAIL;
+			sb_write_address(target, next_address);
 			continue;
 		}
 
 		unsigned error = get_field(sbcs, DMI_SBCS_SBERROR);
-		if (error == 0) {
-			next_address = end_address;
-		} else {
+		if (error != 0) {
 			/* Some error indicating the bus access failed, but not because of
 			 * something we did wrong. */
 			dmi_write(target, DMI_SBCS, DMI_SBCS_SBERROR);
 			return ERROR_FAIL;
 		}
+
+		next_address += n * size;
 	}
 
 	return ERROR_OK;
@@ -2629,7 +2769,7 @@ static int write_memory_progbuf(struct target *target, target_addr_t address,
 
 		struct riscv_batch *batch = riscv_batch_alloc(
 				target,
-				32,
+				info->batch_scans,
 				info->dmi_busy_delay + info->ac_busy_delay);
 
 		/* To write another word, we put it in S1 and execute the program. */
@@ -2830,6 +2970,140 @@ static int riscv013_get_register(struct target *target,
 	return result;
 }
 
+/* Returns the register that an abstract command reads for @a number, or
+ * -1 if it is not read in a batch.  CSRs other than dpc may not exist, and
+ * the cmderr of one of them would fail the whole batch. */
+static int batch_register_number(struct target *target, uint32_t number)
+{
+	RISCV013_INFO(info);
+
+	if (number <= GDB_REGNO_XPR31)
+		return number;
+	if (number >= GDB_REGNO_FPR0 && number <= GDB_REGNO_FPR31 &&
+			info->abstract_read_fpr_supported &&
+			info->batch_read_fpr_supported)
+		return number;
+	if (number == GDB_REGNO_PC && info->abstract_read_csr_supported)
+		return GDB_REGNO_DPC;
+	return -1;
+}
+
+/* Queues one abstract command and the reads of its result per register,
+ * and checks cmderr once per batch.  A batch that fails with a busy
+ * response is repeated with the increased delays.  A batch with FPRs that
+ * fails because the command is not supported or raised an exception is
+ * repeated without FPRs.  After any other error the remaining registers
+ * are left to the caller. */
+static int riscv013_read_registers(struct target *target, const uint32_t *numbers,
+		unsigned count, riscv_reg_t *values, bool *read)
+{
+	RISCV013_INFO(info);
+
+	size_t *keys = calloc(2 * count, sizeof(*keys));
+	if (!keys) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	for (unsigned i = 0; i < count; i++)
+		read[i] = false;
+
+	int result = ERROR_OK;
+	unsigned retries = 0;
+	unsigned i = 0;
+	while (i < count) {
+		unsigned scans = info->batch_scans;
+		struct riscv_batch *batch = riscv_batch_alloc(target, scans,
+				info->dmi_busy_delay + info->ac_busy_delay);
+
+		unsigned end;
+		bool fprs = false;
+		for (end = i; end < count && batch->used_scans + 3 <= scans; end++) {
+			if (numbers[end] == GDB_REGNO_ZERO)
+				continue;
+			int number = batch_register_number(target, numbers[end]);
+			if (number < 0)
+				continue;
+			if (number >= GDB_REGNO_FPR0 && number <= GDB_REGNO_FPR31)
+				fprs = true;
+
+			unsigned size = register_size(target, number);
+			riscv_batch_add_dmi_write(batch, DMI_COMMAND,
+					access_register_command(target, number, size,
+						AC_ACCESS_REGISTER_TRANSFER));
+			keys[2 * end] = riscv_batch_add_dmi_read(batch, DMI_DATA0);
+			if (size > 32)
+				keys[2 * end + 1] = riscv_batch_add_dmi_read(batch, DMI_DATA1);
+		}
+
+		result = batch_run(target, batch);
+		if (result != ERROR_OK) {
+			riscv_batch_free(batch);
+			break;
+		}
+		bool dmi_busy = batch_dmi_busy(batch);
+		if (dmi_busy)
+			increase_dmi_busy_delay(target);
+
+		uint32_t abstractcs;
+		result = wait_for_idle(target, &abstractcs);
+		if (result != ERROR_OK) {
+			riscv_batch_free(batch);
+			break;
+		}
+		info->cmderr = get_field(abstractcs, DMI_ABSTRACTCS_CMDERR);
+		if (info->cmderr != CMDERR_NONE) {
+			LOG_DEBUG("batched register read failed; abstractcs=0x%x", abstractcs);
+			riscv013_clear_abstract_error(target);
+			if (info->cmderr == CMDERR_BUSY)
+				increase_ac_busy_delay(target);
+		}
+
+		if (info->cmderr == CMDERR_BUSY || (dmi_busy && info->cmderr == CMDERR_NONE)) {
+			riscv_batch_free(batch);
+			if (++retries > 8)
+				break;
+			continue;
+		}
+		if (fprs && (info->cmderr == CMDERR_NOT_SUPPORTED ||
+					info->cmderr == CMDERR_EXCEPTION)) {
+			LOG_DEBUG("Disabling batched reads from FPRs.");
+			info->batch_read_fpr_supported = false;
+			riscv_batch_free(batch);
+			continue;
+		}
+		if (info->cmderr != CMDERR_NONE) {
+			riscv_batch_free(batch);
+			break;
+		}
+
+		for (; i < end; i++) {
+			if (numbers[i] == GDB_REGNO_ZERO) {
+				values[i] = 0;
+				read[i] = true;
+				continue;
+			}
+			int number = batch_register_number(target, numbers[i]);
+			if (number < 0)
+				continue;
+
+			values[i] = get_field(riscv_batch_get_dmi_read(batch, keys[2 * i]),
+					DTM_DMI_DATA);
+			if (register_size(target, number) > 32)
+				values[i] |= (uint64_t)get_field(riscv_batch_get_dmi_read(batch,
+							keys[2 * i + 1]), DTM_DMI_DATA) << 32;
+			read[i] = true;
+			LOG_DEBUG("{%d} reg[0x%x] = 0x%" PRIx64, riscv_current_hartid(target),
+					numbers[i], values[i]);
+		}
+		riscv_batch_free(batch);
+		retries = 0;
+	}
+
+	free(keys);
+	return result;
+}
+
 static int riscv013_set_register(struct target *target, int hid, int rid, uint64_t value)
 {
 	LOG_DEBUG("writing 0x%" PRIx64 " to register %s on hart %d", value,
@@ -187,6 +187,11 @@ int riscv_reset_timeout_sec = DEFAULT_RESET_TIMEOUT_SEC;
 
 bool riscv_prefer_sba;
 
+/* Delays set with `riscv delays` before `init`, when there is no
+ * riscv_info_t to hold them yet. */
+static bool riscv_delays_configured;
+static struct riscv_delays riscv_configured_delays;
+
 typedef struct {
 	uint16_t low, high;
 } range_t;
@@ -259,6 +264,8 @@ static int riscv_init_target(struct command_context *cmd_ctx,
 	riscv_info_t *info = (riscv_info_t *) target->arch_info;
 	riscv_info_init(target, info);
 	info->cmd_ctx = cmd_ctx;
+	info->delays_configured = riscv_delays_configured;
+	info->configured_delays = riscv_configured_delays;
 
 	select_dtmcontrol.num_bits = target->tap->ir_length;
 	select_dbus.num_bits = target->tap->ir_length;
@@ -926,6 +933,59 @@ static int riscv_write_memory(struct target *target, target_addr_t address,
 	return tt->write_memory(target, address, size, count, buffer);
 }
 
+/* CSRs (and possibly other extension) registers may change value at any
+ * time, so only these are kept in the register cache. */
+static bool register_cacheable(unsigned number)
+{
+	return number <= GDB_REGNO_XPR31 ||
+		(number >= GDB_REGNO_FPR0 && number <= GDB_REGNO_FPR31) ||
+		number == GDB_REGNO_PC;
+}
+
+/* Reads the registers in @a reg_list that are not valid in one go, if the
+ * target can; @a done tells which ones were read. */
+static void riscv_read_registers(struct target *target, struct reg **reg_list,
+		int reg_list_size, bool *done)
+{
+	RISCV_INFO(r);
+	if (!r->read_registers)
+		return;
+
+	uint32_t *numbers = calloc(reg_list_size, sizeof(*numbers));
+	int *index = calloc(reg_list_size, sizeof(*index));
+	riscv_reg_t *values = calloc(reg_list_size, sizeof(*values));
+	bool *read = calloc(reg_list_size, sizeof(*read));
+	if (!numbers || !index || !values || !read)
+		goto done;
+
+	unsigned count = 0;
+	for (int i = 0; i < reg_list_size; i++) {
+		if (reg_list[i]->valid || !reg_list[i]->exist)
+			continue;
+		numbers[count] = reg_list[i]->number;
+		index[count++] = i;
+	}
+
+	/* Whatever was not read is read one by one */
+	r->read_registers(target, numbers, count, values, read);
+
+	for (unsigned i = 0; i < count; i++) {
+		if (!read[i])
+			continue;
+		struct reg *reg = reg_list[index[i]];
+		buf_set_u64(reg->value, 0, reg->size, values[i]);
+		if (register_cacheable(reg->number))
+			reg->valid = true;
+		done[index[i]] = true;
+	}
+
+done:
+	free(numbers);
+	free(index);
+	free(values);
+	free(read);
+}
+
 static int riscv_get_gdb_reg_list_internal(struct target *target,
 		struct reg **reg_list[], int *reg_list_size,
 		enum target_register_class reg_class, bool read)
@@ -958,11 +1018,22 @@ static int riscv_get_gdb_reg_list_internal(struct target *target,
 	if (!*reg_list)
 		return ERROR_FAIL;
 
+	bool *done = calloc(*reg_list_size, sizeof(*done));
+	if (!done) {
+		free(*reg_list);
+		*reg_list = NULL;
+		return ERROR_FAIL;
+	}
+
+	for (int i = 0; i < *reg_list_size; i++)
+		(*reg_list)[i] = &target->reg_cache->reg_list[i];
+	if (read)
+		riscv_read_registers(target, *reg_list, *reg_list_size, done);
+
 	for (int i = 0; i < *reg_list_size; i++) {
 		assert(!target->reg_cache->reg_list[i].valid ||
 				target->reg_cache->reg_list[i].size > 0);
-		(*reg_list)[i] = &target->reg_cache->reg_list[i];
-		if (read && !target->reg_cache->reg_list[i].valid) {
+		if (read && !done[i] && !target->reg_cache->reg_list[i].valid) {
 			if (target->reg_cache->reg_list[i].type->get(
 						&target->reg_cache->reg_list[i]) != ERROR_OK)
 				/* This function is called when first connecting to gdb,
@@ -972,6 +1043,7 @@ static int riscv_get_gdb_reg_list_internal(struct target *target,
 				read = false;
 		}
 	}
+	free(done);
 
 	return ERROR_OK;
 }
@@ -1131,6 +1203,159 @@ static int riscv_checksum_memory(struct target *target,
 	return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
 }
 
+/* Checks as many blocks as fit in the working area in one run of a small
+ * algorithm; returns the number of blocks checked. A timeout is an error:
+ * riscv_run_algorithm() doesn't restore the hart's registers then, so
+ * there is no continuing with the remaining blocks. */
+static int riscv_blank_check_memory(struct target *target,
+		struct target_memory_check_block *blocks, int num_blocks,
+		uint8_t erased_value)
+{
+	struct working_area *erase_check_algorithm;
+	struct working_area *erase_check_params;
+	struct reg_param reg_params[2];
+	int retval;
+
+	static const uint8_t riscv32_erase_check_code[] = {
+#include "../../../contrib/loaders/erase_check/riscv32_erase_check.inc"
+	};
+	static const uint8_t riscv64_erase_check_code[] = {
+#include "../../../contrib/loaders/erase_check/riscv64_erase_check.inc"
+	};
+
+	int xlen = riscv_xlen(target);
+	const uint8_t *code;
+	uint32_t code_size;
+	if (xlen == 64) {
+		code = riscv64_erase_check_code;
+		code_size = sizeof(riscv64_erase_check_code);
+	} else {
+		code = riscv32_erase_check_code;
+		code_size = sizeof(riscv32_erase_check_code);
+	}
+
+	/* The algorithm checks whole aligned words, and a zero size ends the
+	 * list; leave any other block to the caller's fallback */
+	int blocks_to_check = 0;
+	while (blocks_to_check < num_blocks &&
+			blocks[blocks_to_check].size >= 4 &&
+			!(blocks[blocks_to_check].size % 4) &&
+			!(blocks[blocks_to_check].address % 4))
+		blocks_to_check++;
+	if (!blocks_to_check)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	/* make sure we have a working area */
+	if (target_alloc_working_area(target, code_size,
+			&erase_check_algorithm) != ERROR_OK)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	retval = target_write_buffer(target, erase_check_algorithm->address,
+			code_size, code);
+	if (retval != ERROR_OK)
+		goto cleanup1;
+
+	/* Each block is a size in words, replaced by the result, and an
+	 * address; both XLEN bits wide */
+	unsigned block_size = 2 * xlen / 8;
+	uint32_t avail = target_get_working_area_avail(target);
+	if (avail / block_size < 2) {
+		retval = ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		goto cleanup1;
+	}
+	if ((int)(avail / block_size - 1) < blocks_to_check)
+		blocks_to_check = avail / block_size - 1;
+
+	uint32_t param_size = (blocks_to_check + 1) * block_size;
+	uint8_t *params = calloc(1, param_size);
+	if (!params) {
+		retval = ERROR_FAIL;
+		goto cleanup1;
+	}
+
+	uint32_t total_size = 0;
+	for (int i = 0; i < blocks_to_check; i++) {
+		blocks[i].result = UINT32_MAX;	/* erase state unknown */
+		total_size += blocks[i].size;
+		buf_set_u64(params + i * block_size, 0, xlen, blocks[i].size / 4);
+		buf_set_u64(params + i * block_size + block_size / 2, 0, xlen,
+				blocks[i].address);
+	}
+
+	if (target_alloc_working_area(target, param_size,
+			&erase_check_params) != ERROR_OK) {
+		retval = ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		goto cleanup2;
+	}
+
+	retval = target_write_buffer(target, erase_check_params->address,
+			param_size, params);
+	if (retval != ERROR_OK)
+		goto cleanup3;
+
+	uint32_t erased_word = erased_value | (erased_value << 8)
+			| (erased_value << 16) | ((uint32_t)erased_value << 24);
+
+	LOG_DEBUG("Starting erase check of %d blocks, parameters@"
+			TARGET_ADDR_FMT, blocks_to_check, erase_check_params->address);
+
+	init_reg_param(&reg_params[0], "a0", xlen, PARAM_OUT);
+	buf_set_u64(reg_params[0].value, 0, xlen, erase_check_params->address);
+
+	init_reg_param(&reg_params[1], "a1", xlen, PARAM_OUT);
+	buf_set_u64(reg_params[1].value, 0, xlen, erased_word);
+
+	/* assume CPU clk at least 1 MHz */
+	int timeout = 2000 + total_size * 3 / 1000;
+
+	/* the algorithm ends with an ebreak */
+	retval = target_run_algorithm(target,
+			0, NULL,
+			ARRAY_SIZE(reg_params), reg_params,
+			erase_check_algorithm->address,
+			erase_check_algorithm->address + code_size - 4,
+			timeout, NULL);
+
+	if (retval != ERROR_OK) {
+		LOG_ERROR("error executing RISC-V erase check algorithm");
+		goto cleanup4;
+	}
+
+	retval = target_read_buffer(target, erase_check_params->address,
+			param_size, params);
+	if (retval != ERROR_OK)
+		goto cleanup4;
+
+	/* the algorithm ran to its end, so every size was replaced by a
+	 * result; anything else means the parameters were overwritten */
+	for (int i = 0; i < blocks_to_check; i++) {
+		uint64_t result = buf_get_u64(params + i * block_size, 0, xlen);
+		if (result != 0 && result != 1) {
+			LOG_ERROR("erase check returned bad result 0x%" PRIx64
+					" for block at " TARGET_ADDR_FMT, result, blocks[i].address);
+			retval = ERROR_FAIL;
+			goto cleanup4;
+		}
+	}
+	for (int i = 0; i < blocks_to_check; i++)
+		blocks[i].result = buf_get_u64(params + i * block_size, 0, xlen);
+
+	retval = blocks_to_check;	/* return number of blocks really checked */
+
+cleanup4:
+	destroy_reg_param(&reg_params[0]);
+	destroy_reg_param(&reg_params[1]);
+
+cleanup3:
+	target_free_working_area(target, erase_check_params);
+cleanup2:
+	free(params);
+cleanup1:
+	target_free_working_area(target, erase_check_algorithm);
+
+	return retval;
+}
+
 /*** OpenOCD Helper Functions ***/
 
 enum riscv_poll_hart {
@@ -1754,6 +1979,55 @@ COMMAND_HANDLER(riscv_reset_delays)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(riscv_delays)
+{
+	if (CMD_ARGC != 0 && CMD_ARGC != 5) {
+		LOG_ERROR("Command takes no or exactly 5 arguments");
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	}
+
+	struct target *target = get_current_target(CMD_CTX);
+	RISCV_INFO(r);
+
+	struct riscv_delays delays;
+	if (CMD_ARGC == 5) {
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], delays.dmi_busy);
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[1], delays.ac_busy);
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[2], delays.bus_master_read);
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[3], delays.bus_master_write);
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[4], delays.batch_scans);
+
+		if (!r) {
+			/* Before `init`; riscv_init_target() picks these up. */
+			riscv_delays_configured = true;
+			riscv_configured_delays = delays;
+			return ERROR_OK;
+		}
+
+		r->delays_configured = true;
+		r->configured_delays = delays;
+		/* Not examined yet; the values are applied when it is. */
+		if (!r->set_delays)
+			return ERROR_OK;
+		r->set_delays(target, &delays);
+	}
+
+	if (r && r->get_delays) {
+		r->get_delays(target, &delays);
+	} else if (r && r->delays_configured) {
+		delays = r->configured_delays;
+	} else if (!r && riscv_delays_configured) {
+		delays = riscv_configured_delays;
+	} else {
+		LOG_ERROR("No delays are known until the target is examined.");
+		return ERROR_FAIL;
+	}
+
+	command_print(CMD, "%u %u %u %u %u", delays.dmi_busy, delays.ac_busy,
+			delays.bus_master_read, delays.bus_master_write, delays.batch_scans);
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(riscv_set_ir)
 {
 	if (CMD_ARGC != 2) {
@@ -1877,6 +2151,15 @@ static const struct command_registration riscv_exec_command_handlers[] = {
 			"command resets those learned values after `wait` scans. It's only "
 			"useful for testing OpenOCD itself."
 	},
+	{
+		.name = "delays",
+		.handler = riscv_delays,
+		.mode = COMMAND_ANY,
+		.usage = "riscv delays [dmi_busy ac_busy bus_master_read "
+			"bus_master_write batch_scans]",
+		.help = "Display or set the learned Run-Test/Idle delays and the "
+			"number of scans queued per batch."
+	},
 	{
 		.name = "set_ir",
 		.handler = riscv_set_ir,
@@ -1981,6 +2264,7 @@ struct target_type riscv_target = {
 	.write_memory = riscv_write_memory,
 
 	.checksum_memory = riscv_checksum_memory,
+	.blank_check_memory = riscv_blank_check_memory,
 
 	.get_gdb_reg_list = riscv_get_gdb_reg_list,
 
@@ -2456,11 +2740,7 @@ static int register_get(struct reg *reg)
 	if (result != ERROR_OK)
 		return result;
 	buf_set_u64(reg->value, 0, reg->size, value);
-	/* CSRs (and possibly other extension) registers may change value at any
-	 * time. */
-	if (reg->number <= GDB_REGNO_XPR31 ||
-			(reg->number >= GDB_REGNO_FPR0 && reg->number <= GDB_REGNO_FPR31) ||
-			reg->number == GDB_REGNO_PC)
+	if (register_cacheable(reg->number))
 		reg->valid = true;
 	LOG_DEBUG("[%d]{%d} read 0x%" PRIx64 " from %s (valid=%d)",
 			target->coreid, riscv_current_hartid(target), value, reg->name,
@@ -2479,11 +2759,7 @@ static int register_set(struct reg *reg, uint8_t *buf)
 			target->coreid, riscv_current_hartid(target), value, reg->name,
 			reg->valid);
 	struct reg *r = &target->reg_cache->reg_list[reg->number];
-	/* CSRs (and possibly other extension) registers may change value at any
-	 * time. */
-	if (reg->number <= GDB_REGNO_XPR31 ||
-			(reg->number >= GDB_REGNO_FPR0 && reg->number <= GDB_REGNO_FPR31) ||
-			reg->number == GDB_REGNO_PC)
+	if (register_cacheable(reg->number))
 		r->valid = true;
 	memcpy(r->value, buf, (r->size + 7) / 8);
 
@@ -40,6 +40,16 @@ typedef struct {
 	unsigned custom_number;
 } riscv_reg_info_t;
 
+/* Access timing learned from busy responses of the target, in run-test/idle
+ * cycles, and the number of scans queued per batch. */
+struct riscv_delays {
+	unsigned dmi_busy;
+	unsigned ac_busy;
+	unsigned bus_master_read;
+	unsigned bus_master_write;
+	unsigned batch_scans;
+};
+
 typedef struct {
 	unsigned dtm_version;
 
@@ -104,6 +114,11 @@ typedef struct {
 	 * implementations. */
 	int (*get_register)(struct target *target,
 		riscv_reg_t *value, int hid, int rid);
+	/* Optional.  Reads several registers of the current hart at once;
+	 * values[i] is only set where read[i] is true, the caller reads the
+	 * others one by one. */
+	int (*read_registers)(struct target *target, const uint32_t *numbers,
+			unsigned count, riscv_reg_t *values, bool *read);
 	int (*set_register)(struct target *, int hartid, int regid,
 			uint64_t value);
 	int (*select_current_hart)(struct target *);
@@ -134,6 +149,14 @@ typedef struct {
 			uint32_t num_words, target_addr_t illegal_address, bool run_sbbusyerror_test);
 
 	int (*test_compliance)(struct target *target);
+
+	void (*get_delays)(struct target *target, struct riscv_delays *delays);
+	void (*set_delays)(struct target *target, const struct riscv_delays *delays);
+
+	/* Delays set with `riscv delays`, applied each time the target is
+	 * examined. */
+	bool delays_configured;
+	struct riscv_delays configured_delays;
 } riscv_info_t;
 
 /* Wall-clock timeout for a command/access. Settable via RISC-V Target commands.*/
@@ -0,0 +1,555 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <helper/log.h>
+#include <helper/command.h>
+#include "target.h"
+#include "rtt.h"
+
+/* Control block layout, all fields 32 bit:
+ *   char acID[16];
+ *   int MaxNumUpBuffers, MaxNumDownBuffers;
+ *   struct { sName, pBuffer, SizeOfBuffer, WrOff, RdOff, Flags; } aUp[], aDown[];
+ */
+#define RTT_CB_ID_LENGTH	16
+#define RTT_CB_HEADER_SIZE	24
+#define RTT_CHANNEL_SIZE	24
+#define RTT_CHANNEL_NAME	0
+#define RTT_CHANNEL_BUFFER	4
+#define RTT_CHANNEL_LENGTH	8
+#define RTT_CHANNEL_WROFF	12
+#define RTT_CHANNEL_RDOFF	16
+#define RTT_CHANNEL_FLAGS	20
+
+#define RTT_MAX_CHANNELS	64
+#define RTT_NAME_LENGTH		32
+#define RTT_SCAN_CHUNK		4096
+
+#define RTT_DEFAULT_MIN_INTERVAL	5
+#define RTT_DEFAULT_MAX_INTERVAL	100
+
+struct rtt_channel {
+	char name[RTT_NAME_LENGTH];
+	uint32_t buffer;
+	uint32_t size;
+	uint32_t flags;
+};
+
+struct rtt_sink {
+	unsigned channel;
+	rtt_sink_t sink;
+	void *priv;
+	struct rtt_sink *next;
+};
+
+static struct {
+	struct target *target;
+	bool configured;
+	bool started;
+	target_addr_t search_address;
+	uint32_t search_size;
+	char id[RTT_CB_ID_LENGTH + 1];
+
+	target_addr_t address;
+	unsigned num_up;
+	unsigned num_down;
+	struct rtt_channel up[RTT_MAX_CHANNELS];
+	struct rtt_channel down[RTT_MAX_CHANNELS];
+
+	/* scratch space for the up-channel descriptors and their data */
+	uint8_t desc[RTT_MAX_CHANNELS * RTT_CHANNEL_SIZE];
+	uint8_t *data;
+	uint32_t data_size;
+
+	/* poll interval adapts between these limits to the data rate */
+	unsigned interval;
+	unsigned min_interval;
+	unsigned max_interval;
+	bool read_failed;
+
+	struct rtt_sink *sinks;
+} rtt = {
+	.id = "SEGGER RTT",
+	.min_interval = RTT_DEFAULT_MIN_INTERVAL,
+	.max_interval = RTT_DEFAULT_MAX_INTERVAL,
+};
+
+static int rtt_poll(void *priv);
+
+bool rtt_started(void)
+{
+	return rtt.started;
+}
+
+int rtt_register_sink(unsigned channel, rtt_sink_t sink, void *priv)
+{
+	struct rtt_sink *s = malloc(sizeof(*s));
+	if (!s) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	s->channel = channel;
+	s->sink = sink;
+	s->priv = priv;
+	s->next = rtt.sinks;
+	rtt.sinks = s;
+
+	return ERROR_OK;
+}
+
+int rtt_unregister_sink(unsigned channel, rtt_sink_t sink, void *priv)
+{
+	for (struct rtt_sink **p = &rtt.sinks; *p; p = &(*p)->next) {
+		struct rtt_sink *s = *p;
+		if (s->channel == channel && s->sink == sink && s->priv == priv) {
+			*p = s->next;
+			free(s);
+			return ERROR_OK;
+		}
+	}
+	return ERROR_FAIL;
+}
+
+static bool rtt_channel_has_sink(unsigned channel)
+{
+	for (struct rtt_sink *s = rtt.sinks; s; s = s->next) {
+		if (s->channel == channel)
+			return true;
+	}
+	return false;
+}
+
+static void rtt_schedule(void)
+{
+	target_register_timer_callback(rtt_poll, rtt.interval,
+			TARGET_TIMER_TYPE_ONESHOT, NULL);
+}
+
+static int rtt_find_control_block(target_addr_t *address)
+{
+	size_t id_length = strlen(rtt.id);
+	uint8_t *buf = malloc(RTT_SCAN_CHUNK);
+	if (!buf) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	/* consecutive chunks overlap by the ID length so that an ID crossing
+	 * a chunk boundary is found too */
+	uint32_t offset = 0;
+	int retval = ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	while (offset + id_length <= rtt.search_size) {
+		uint32_t length = MIN(RTT_SCAN_CHUNK, rtt.search_size - offset);
+
+		int ret = target_read_buffer(rtt.target, rtt.search_address + offset,
+				length, buf);
+		if (ret != ERROR_OK) {
+			retval = ret;
+			break;
+		}
+
+		for (uint32_t i = 0; i + id_length <= length; i++) {
+			if (buf[i] == rtt.id[0] && !memcmp(buf + i, rtt.id, id_length)) {
+				*address = rtt.search_address + offset + i;
+				free(buf);
+				return ERROR_OK;
+			}
+		}
+
+		if (offset + length >= rtt.search_size)
+			break;
+		offset += length - (id_length - 1);
+		keep_alive();
+	}
+
+	free(buf);
+	return retval;
+}
+
+static void rtt_parse_channel(struct rtt_channel *channel, const uint8_t *desc)
+{
+	struct target *target = rtt.target;
+	uint32_t name = target_buffer_get_u32(target, desc + RTT_CHANNEL_NAME);
+
+	channel->buffer = target_buffer_get_u32(target, desc + RTT_CHANNEL_BUFFER);
+	channel->size = target_buffer_get_u32(target, desc + RTT_CHANNEL_LENGTH);
+	channel->flags = target_buffer_get_u32(target, desc + RTT_CHANNEL_FLAGS);
+
+	memset(channel->name, 0, sizeof(channel->name));
+	if (name && target_read_buffer(target, name, sizeof(channel->name) - 1,
+			(uint8_t *)channel->name) != ERROR_OK)
+		channel->name[0] = '\0';
+}
+
+static int rtt_read_control_block(void)
+{
+	struct target *target = rtt.target;
+	uint8_t header[RTT_CB_HEADER_SIZE];
+
+	int retval = target_read_buffer(target, rtt.address, sizeof(header), header);
+	if (retval != ERROR_OK)
+		return retval;
+
+	uint32_t num_up = target_buffer_get_u32(target, header + RTT_CB_ID_LENGTH);
+	uint32_t num_down = target_buffer_get_u32(target, header + RTT_CB_ID_LENGTH + 4);
+	if (num_up > RTT_MAX_CHANNELS || num_down > RTT_MAX_CHANNELS) {
+		LOG_ERROR("rtt: invalid control block at " TARGET_ADDR_FMT
+				" (%" PRIu32 " up, %" PRIu32 " down channels)",
+				rtt.address, num_up, num_down);
+		return ERROR_FAIL;
+	}
+	rtt.num_up = num_up;
+	rtt.num_down = num_down;
+
+	uint8_t desc[2 * RTT_MAX_CHANNELS * RTT_CHANNEL_SIZE];
+	retval = target_read_buffer(target, rtt.address + RTT_CB_HEADER_SIZE,
+			(num_up + num_down) * RTT_CHANNEL_SIZE, desc);
+	if (retval != ERROR_OK)
+		return retval;
+
+	for (unsigned i = 0; i < num_up; i++)
+		rtt_parse_channel(&rtt.up[i], desc + i * RTT_CHANNEL_SIZE);
+	for (unsigned i = 0; i < num_down; i++)
+		rtt_parse_channel(&rtt.down[i], desc + (num_up + i) * RTT_CHANNEL_SIZE);
+
+	return ERROR_OK;
+}
+
+/* Drains one up-channel whose descriptor was read by rtt_poll().  Returns
+ * the number of bytes passed on, or a negative error code. */
+static int rtt_read_channel(unsigned channel, const uint8_t *desc, bool *busy)
+{
+	struct target *target = rtt.target;
+	uint32_t buffer = target_buffer_get_u32(target, desc + RTT_CHANNEL_BUFFER);
+	uint32_t size = target_buffer_get_u32(target, desc + RTT_CHANNEL_LENGTH);
+	uint32_t wr = target_buffer_get_u32(target, desc + RTT_CHANNEL_WROFF);
+	uint32_t rd = target_buffer_get_u32(target, desc + RTT_CHANNEL_RDOFF);
+
+	if (wr == rd)
+		return 0;
+	if (wr >= size || rd >= size) {
+		LOG_DEBUG("rtt: channel %u offsets out of range", channel);
+		return 0;
+	}
+
+	if (size > rtt.data_size) {
+		uint8_t *data = realloc(rtt.data, size);
+		if (!data) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+		rtt.data = data;
+		rtt.data_size = size;
+	}
+
+	/* the part up to the end of the ring first, then the wrapped part */
+	uint32_t length = wr > rd ? wr - rd : size - rd;
+	int retval = target_read_buffer(target, buffer + rd, length, rtt.data);
+	if (retval == ERROR_OK && wr < rd && wr > 0) {
+		retval = target_read_buffer(target, buffer, wr, rtt.data + length);
+		length += wr;
+	}
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = target_write_u32(target, rtt.address + RTT_CB_HEADER_SIZE
+			+ channel * RTT_CHANNEL_SIZE + RTT_CHANNEL_RDOFF, wr);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (length > size / 2)
+		*busy = true;
+
+	for (struct rtt_sink *s = rtt.sinks; s; s = s->next) {
+		if (s->channel == channel)
+			s->sink(channel, rtt.data, length, s->priv);
+	}
+
+	return length;
+}
+
+static int rtt_poll(void *priv)
+{
+	if (!rtt.started)
+		return ERROR_OK;
+
+	struct target *target = rtt.target;
+	bool busy = false;
+	uint32_t total = 0;
+	int retval = ERROR_OK;
+
+	if (target_was_examined(target) && rtt.sinks) {
+		/* one block read fetches the offsets of every up-channel */
+		retval = target_read_buffer(target, rtt.address + RTT_CB_HEADER_SIZE,
+				rtt.num_up * RTT_CHANNEL_SIZE, rtt.desc);
+
+		for (unsigned i = 0; retval == ERROR_OK && i < rtt.num_up; i++) {
+			if (!rtt_channel_has_sink(i))
+				continue;
+			int length = rtt_read_channel(i, rtt.desc + i * RTT_CHANNEL_SIZE, &busy);
+			if (length < 0)
+				retval = length;
+			else
+				total += length;
+		}
+
+		if (retval != ERROR_OK && !rtt.read_failed)
+			LOG_WARNING("rtt: failed to read control block, will retry");
+		rtt.read_failed = retval != ERROR_OK;
+	}
+
+	if (busy)
+		rtt.interval = rtt.min_interval;
+	else if (total)
+		rtt.interval = MAX(rtt.interval / 2, rtt.min_interval);
+	else
+		rtt.interval = MIN(rtt.interval * 2, rtt.max_interval);
+
+	rtt_schedule();
+	return ERROR_OK;
+}
+
+int rtt_write_channel(unsigned channel, const uint8_t *buf, size_t *length)
+{
+	if (!rtt.started)
+		return ERROR_FAIL;
+	if (channel >= rtt.num_down) {
+		LOG_ERROR("rtt: no down-channel %u", channel);
+		return ERROR_FAIL;
+	}
+
+	struct target *target = rtt.target;
+	target_addr_t address = rtt.address + RTT_CB_HEADER_SIZE
+			+ (rtt.num_up + channel) * RTT_CHANNEL_SIZE;
+	uint8_t desc[RTT_CHANNEL_SIZE];
+
+	int retval = target_read_buffer(target, address, sizeof(desc), desc);
+	if (retval != ERROR_OK)
+		return retval;
+
+	uint32_t buffer = target_buffer_get_u32(target, desc + RTT_CHANNEL_BUFFER);
+	uint32_t size = target_buffer_get_u32(target, desc + RTT_CHANNEL_LENGTH);
+	uint32_t wr = target_buffer_get_u32(target, desc + RTT_CHANNEL_WROFF);
+	uint32_t rd = target_buffer_get_u32(target, desc + RTT_CHANNEL_RDOFF);
+	if (wr >= size || rd >= size) {
+		*length = 0;
+		return ERROR_OK;
+	}
+
+	/* one byte stays free so that a full ring differs from an empty one */
+	uint32_t space = rd > wr ? rd - wr - 1 : size - wr + rd - 1;
+	uint32_t count = MIN(*length, space);
+	uint32_t first = MIN(count, size - wr);
+
+	retval = target_write_buffer(target, buffer + wr, first, buf);
+	if (retval == ERROR_OK && count > first)
+		retval = target_write_buffer(target, buffer, count - first, buf + first);
+	if (retval == ERROR_OK)
+		retval = target_write_u32(target, address + RTT_CHANNEL_WROFF,
+				(wr + count) % size);
+	if (retval != ERROR_OK)
+		return retval;
+
+	*length = count;
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_rtt_setup_command)
+{
+	if (CMD_ARGC < 2 || CMD_ARGC > 3)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	target_addr_t address;
+	uint32_t size;
+	COMMAND_PARSE_ADDRESS(CMD_ARGV[0], address);
+	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[1], size);
+
+	if (CMD_ARGC == 3) {
+		if (!strlen(CMD_ARGV[2]) || strlen(CMD_ARGV[2]) > RTT_CB_ID_LENGTH) {
+			command_print(CMD, "control block ID must be 1 to %d characters",
+					RTT_CB_ID_LENGTH);
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+		strcpy(rtt.id, CMD_ARGV[2]);
+	}
+
+	rtt.target = get_current_target(CMD_CTX);
+	rtt.search_address = address;
+	rtt.search_size = size;
+	rtt.configured = true;
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_rtt_start_command)
+{
+	if (CMD_ARGC)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (!rtt.configured) {
+		command_print(CMD, "rtt: run 'rtt setup' first");
+		return ERROR_FAIL;
+	}
+	if (rtt.started)
+		return ERROR_OK;
+
+	int retval = rtt_find_control_block(&rtt.address);
+	if (retval == ERROR_TARGET_RESOURCE_NOT_AVAILABLE) {
+		command_print(CMD, "rtt: no control block '%s' in " TARGET_ADDR_FMT
+				" + 0x%" PRIx32, rtt.id, rtt.search_address, rtt.search_size);
+		return retval;
+	}
+	if (retval == ERROR_OK)
+		retval = rtt_read_control_block();
+	if (retval != ERROR_OK)
+		return retval;
+
+	command_print(CMD, "rtt: control block at " TARGET_ADDR_FMT
+			", %u up and %u down channels", rtt.address, rtt.num_up, rtt.num_down);
+
+	rtt.started = true;
+	rtt.read_failed = false;
+	rtt.interval = rtt.min_interval;
+	rtt_schedule();
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_rtt_stop_command)
+{
+	if (CMD_ARGC)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (rtt.started) {
+		rtt.started = false;
+		target_unregister_timer_callback(rtt_poll, NULL);
+	}
+
+	free(rtt.data);
+	rtt.data = NULL;
+	rtt.data_size = 0;
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_rtt_channels_command)
+{
+	if (CMD_ARGC)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (!rtt.started) {
+		command_print(CMD, "rtt: not started");
+		return ERROR_FAIL;
+	}
+
+	/* names and sizes may be set up after the control block */
+	int retval = rtt_read_control_block();
+	if (retval != ERROR_OK)
+		return retval;
+
+	for (unsigned i = 0; i < rtt.num_up; i++)
+		command_print(CMD, "up %u: \"%s\" size %" PRIu32 " flags 0x%" PRIx32,
+				i, rtt.up[i].name, rtt.up[i].size, rtt.up[i].flags);
+	for (unsigned i = 0; i < rtt.num_down; i++)
+		command_print(CMD, "down %u: \"%s\" size %" PRIu32 " flags 0x%" PRIx32,
+				i, rtt.down[i].name, rtt.down[i].size, rtt.down[i].flags);
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_rtt_polling_interval_command)
+{
+	if (CMD_ARGC > 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC > 0) {
+		unsigned min_interval, max_interval;
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], min_interval);
+		max_interval = MAX(min_interval, rtt.max_interval);
+		if (CMD_ARGC == 2)
+			COMMAND_PARSE_NUMBER(uint, CMD_ARGV[1], max_interval);
+		if (!min_interval || max_interval < min_interval)
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+
+		rtt.min_interval = min_interval;
+		rtt.max_interval = max_interval;
+		rtt.interval = min_interval;
+	}
+
+	command_print(CMD, "rtt polling interval %u to %u ms",
+			rtt.min_interval, rtt.max_interval);
+	return ERROR_OK;
+}
+
+static const struct command_registration rtt_subcommand_handlers[] = {
+	{
+		.name = "setup",
+		.handler = handle_rtt_setup_command,
+		.mode = COMMAND_ANY,
+		.help = "set the RAM range searched for the RTT control block "
+			"and optionally its ID (default \"SEGGER RTT\")",
+		.usage = "address size [ID]",
+	},
+	{
+		.name = "start",
+		.handler = handle_rtt_start_command,
+		.mode = COMMAND_EXEC,
+		.help = "find the control block and start polling",
+		.usage = "",
+	},
+	{
+		.name = "stop",
+		.handler = handle_rtt_stop_command,
+		.mode = COMMAND_EXEC,
+		.help = "stop polling",
+		.usage = "",
+	},
+	{
+		.name = "channels",
+		.handler = handle_rtt_channels_command,
+		.mode = COMMAND_EXEC,
+		.help = "list the up- and down-channels",
+		.usage = "",
+	},
+	{
+		.name = "polling_interval",
+		.handler = handle_rtt_polling_interval_command,
+		.mode = COMMAND_ANY,
+		.help = "display or set the range of the adaptive poll interval",
+		.usage = "[min_ms [max_ms]]",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static const struct command_registration rtt_command_handlers[] = {
+	{
+		.name = "rtt",
+		.mode = COMMAND_ANY,
+		.help = "Real-Time Transfer command group",
+		.usage = "",
+		.chain = rtt_subcommand_handlers,
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+int rtt_register_commands(struct command_context *cmd_ctx)
+{
+	return register_commands(cmd_ctx, NULL, rtt_command_handlers);
+}
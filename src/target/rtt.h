@@ -0,0 +1,50 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef OPENOCD_TARGET_RTT_H
+#define OPENOCD_TARGET_RTT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct command_context;
+
+/* Real-Time Transfer: ring buffers in target RAM, described by a control
+ * block starting with an ID string, which the target fills ("up") or
+ * drains ("down") while it runs.  The host side only needs background
+ * memory access. */
+
+/**
+ * Receives data read from an up-channel.  Called from the RTT poll
+ * timer; must not block.
+ */
+typedef int (*rtt_sink_t)(unsigned channel, const uint8_t *buf,
+		size_t length, void *priv);
+
+int rtt_register_sink(unsigned channel, rtt_sink_t sink, void *priv);
+int rtt_unregister_sink(unsigned channel, rtt_sink_t sink, void *priv);
+
+/**
+ * Writes up to @a length bytes into down-channel @a channel.  On return
+ * @a length holds the number of bytes that fitted into the buffer.
+ */
+int rtt_write_channel(unsigned channel, const uint8_t *buf, size_t *length);
+
+bool rtt_started(void);
+
+int rtt_register_commands(struct command_context *cmd_ctx);
+
+#endif /* OPENOCD_TARGET_RTT_H */
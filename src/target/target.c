@@ -55,6 +55,9 @@
 #include "rtos/rtos.h"
 #include "transport/transport.h"
 #include "arm_cti.h"
+#include "rtt.h"
+#include "profile.h"
+#include "mmu_tlb.h"
 
 /* default halt wait timeout (ms) */
 #define DEFAULT_HALT_TIMEOUT 5000
@@ -67,6 +70,10 @@ static int target_array2mem(Jim_Interp *interp, struct target *target,
 		int argc, Jim_Obj * const *argv);
 static int target_mem2array(Jim_Interp *interp, struct target *target,
 		int argc, Jim_Obj * const *argv);
+static int target_bin2mem(Jim_Interp *interp, struct target *target,
+		int argc, Jim_Obj * const *argv);
+static int target_mem2bin(Jim_Interp *interp, struct target *target,
+		int argc, Jim_Obj * const *argv);
 static int target_register_user_commands(struct command_context *cmd_ctx);
 static int target_get_gdb_fileio_info_default(struct target *target,
 		struct gdb_fileio_info *fileio_info);
@@ -529,20 +536,16 @@ struct target *get_current_target_or_null(struct command_context *cmd_ctx)
 		: cmd_ctx->current_target;
 }
 
-int target_poll(struct target *target)
+/* Bookkeeping after the target type has polled @a target */
+static int target_poll_done(struct target *target, int retval)
 {
-	int retval;
-
-	/* We can't poll until after examine */
-	if (!target_was_examined(target)) {
-		/* Fail silently lest we pollute the log */
-		return ERROR_FAIL;
-	}
-
-	retval = target->type->poll(target);
 	if (retval != ERROR_OK)
 		return retval;
 
+	/* a running target may change its page tables at any time */
+	if (target->tlb && target->state != TARGET_HALTED)
+		mmu_tlb_flush(target->tlb);
+
 	if (target->halt_issued) {
 		if (target->state == TARGET_HALTED)
 			target->halt_issued = false;
@@ -559,6 +562,26 @@ int target_poll(struct target *target)
 	return ERROR_OK;
 }
 
+int target_poll(struct target *target)
+{
+	/* We can't poll until after examine */
+	if (!target_was_examined(target)) {
+		/* Fail silently lest we pollute the log */
+		return ERROR_FAIL;
+	}
+
+	return target_poll_done(target, target->type->poll(target));
+}
+
+/* Background polling runs at full rate again after the target was told
+ * to change its state */
+static void target_poll_wake(struct target *target)
+{
+	target->poll_idle.times = 0;
+	target->poll_idle.count = 0;
+	target->poll_unchanged = 0;
+}
+
 int target_halt(struct target *target)
 {
 	int retval;
@@ -574,6 +597,7 @@ int target_halt(struct target *target)
 
 	target->halt_issued = true;
 	target->halt_issued_time = timeval_ms();
+	target_poll_wake(target);
 
 	return ERROR_OK;
 }
@@ -621,6 +645,9 @@ int target_resume(struct target *target, int current, target_addr_t address,
 
 	target_call_event_callbacks(target, TARGET_EVENT_RESUME_START);
 
+	if (target->tlb)
+		mmu_tlb_flush(target->tlb);
+
 	/* note that resume *must* be asynchronous. The CPU can halt before
 	 * we poll. The CPU can even halt at the current PC as a result of
 	 * a software breakpoint being inserted by (a bug?) the application.
@@ -629,6 +656,7 @@ int target_resume(struct target *target, int current, target_addr_t address,
 	if (retval != ERROR_OK)
 		return retval;
 
+	target_poll_wake(target);
 	target_call_event_callbacks(target, TARGET_EVENT_RESUME_END);
 
 	return retval;
@@ -1080,6 +1108,150 @@ int target_run_flash_async_algorithm(struct target *target,
 	return retval;
 }
 
+/* Memory accesses collected by "target batch" for one target.  Operations
+ * before 'flushed' have been executed; reads keep their results in the
+ * array until the batch completes. */
+struct target_mem_batch {
+	struct target_mem_op *ops;
+	unsigned count;
+	unsigned alloc;
+	unsigned flushed;
+	bool flushing;
+	int retval;
+	unsigned failed;
+};
+
+static int target_mem_batch_default(struct target *target,
+		struct target_mem_op *ops, unsigned count, unsigned *failed)
+{
+	for (unsigned i = 0; i < count; i++) {
+		struct target_mem_op *op = &ops[i];
+		uint8_t buf[8];
+		int retval;
+
+		if (op->write) {
+			switch (op->size) {
+			case 8:
+				target_buffer_set_u64(target, buf, op->value);
+				break;
+			case 4:
+				target_buffer_set_u32(target, buf, op->value);
+				break;
+			case 2:
+				target_buffer_set_u16(target, buf, op->value);
+				break;
+			default:
+				buf[0] = op->value;
+			}
+			retval = target_write_memory(target, op->address, op->size, 1, buf);
+		} else {
+			retval = target_read_memory(target, op->address, op->size, 1, buf);
+			if (retval == ERROR_OK) {
+				switch (op->size) {
+				case 8:
+					op->value = target_buffer_get_u64(target, buf);
+					break;
+				case 4:
+					op->value = target_buffer_get_u32(target, buf);
+					break;
+				case 2:
+					op->value = target_buffer_get_u16(target, buf);
+					break;
+				default:
+					op->value = buf[0];
+				}
+			}
+		}
+		if (retval != ERROR_OK) {
+			*failed = i;
+			return retval;
+		}
+	}
+	return ERROR_OK;
+}
+
+/* Run the operations collected so far.  Any immediate memory access has
+ * to call this first so it is ordered after what the script issued. */
+static int target_mem_batch_flush(struct target *target)
+{
+	struct target_mem_batch *batch = target->mem_batch;
+
+	if (!batch || batch->flushing)
+		return ERROR_OK;
+	if (batch->retval != ERROR_OK)
+		return batch->retval;
+	if (batch->flushed == batch->count)
+		return ERROR_OK;
+
+	unsigned count = batch->count - batch->flushed;
+	unsigned failed = 0;
+	int retval;
+
+	batch->flushing = true;
+	if (target->type->mem_batch)
+		retval = target->type->mem_batch(target, batch->ops + batch->flushed,
+				count, &failed);
+	else
+		retval = target_mem_batch_default(target, batch->ops + batch->flushed,
+				count, &failed);
+	batch->flushing = false;
+
+	if (retval != ERROR_OK) {
+		batch->retval = retval;
+		batch->failed = batch->flushed + failed;
+	}
+	batch->flushed = batch->count;
+	return retval;
+}
+
+static int target_mem_batch_add(struct target *target, bool write,
+		unsigned size, target_addr_t address, uint64_t value)
+{
+	struct target_mem_batch *batch = target->mem_batch;
+
+	if (batch->count == batch->alloc) {
+		unsigned alloc = batch->alloc ? batch->alloc * 2 : 64;
+		struct target_mem_op *ops = realloc(batch->ops, alloc * sizeof(*ops));
+		if (!ops) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+		batch->ops = ops;
+		batch->alloc = alloc;
+	}
+
+	batch->ops[batch->count++] = (struct target_mem_op) {
+		.write = write,
+		.size = size,
+		.address = address,
+		.value = value,
+	};
+	return ERROR_OK;
+}
+
+/**
+ * Performs @a ops in as few transactions as the target allows.  Returns
+ * ERROR_TARGET_RESOURCE_NOT_AVAILABLE without accessing the target if it
+ * cannot queue them, as single accesses would be slower than the block
+ * reads the caller can fall back to.
+ */
+int target_run_mem_ops(struct target *target, struct target_mem_op *ops,
+		unsigned count, unsigned *failed)
+{
+	if (!target_was_examined(target)) {
+		LOG_ERROR("Target not examined yet");
+		return ERROR_FAIL;
+	}
+	if (!target->type->mem_batch)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	int retval = target_mem_batch_flush(target);
+	if (retval != ERROR_OK)
+		return retval;
+
+	*failed = 0;
+	return target->type->mem_batch(target, ops, count, failed);
+}
+
 int target_read_memory(struct target *target,
 		target_addr_t address, uint32_t size, uint32_t count, uint8_t *buffer)
 {
@@ -1087,6 +1259,9 @@ int target_read_memory(struct target *target,
 		LOG_ERROR("Target not examined yet");
 		return ERROR_FAIL;
 	}
+	int retval = target_mem_batch_flush(target);
+	if (retval != ERROR_OK)
+		return retval;
 	if (!target->type->read_memory) {
 		LOG_ERROR("Target %s doesn't support read_memory", target_name(target));
 		return ERROR_FAIL;
@@ -1101,6 +1276,9 @@ int target_read_phys_memory(struct target *target,
 		LOG_ERROR("Target not examined yet");
 		return ERROR_FAIL;
 	}
+	int retval = target_mem_batch_flush(target);
+	if (retval != ERROR_OK)
+		return retval;
 	if (!target->type->read_phys_memory) {
 		LOG_ERROR("Target %s doesn't support read_phys_memory", target_name(target));
 		return ERROR_FAIL;
@@ -1115,6 +1293,9 @@ int target_write_memory(struct target *target,
 		LOG_ERROR("Target not examined yet");
 		return ERROR_FAIL;
 	}
+	int retval = target_mem_batch_flush(target);
+	if (retval != ERROR_OK)
+		return retval;
 	if (!target->type->write_memory) {
 		LOG_ERROR("Target %s doesn't support write_memory", target_name(target));
 		return ERROR_FAIL;
@@ -1129,10 +1310,16 @@ int target_write_phys_memory(struct target *target,
 		LOG_ERROR("Target not examined yet");
 		return ERROR_FAIL;
 	}
+	int retval = target_mem_batch_flush(target);
+	if (retval != ERROR_OK)
+		return retval;
 	if (!target->type->write_phys_memory) {
 		LOG_ERROR("Target %s doesn't support write_phys_memory", target_name(target));
 		return ERROR_FAIL;
 	}
+	/* the write may patch a page table */
+	if (target->tlb)
+		mmu_tlb_flush(target->tlb);
 	return target->type->write_phys_memory(target, address, size, count, buffer);
 }
 
@@ -1230,6 +1417,9 @@ bool target_supports_gdb_connection(struct target *target)
 int target_step(struct target *target,
 		int current, target_addr_t address, int handle_breakpoints)
 {
+	target_poll_wake(target);
+	if (target->tlb)
+		mmu_tlb_flush(target->tlb);
 	return target->type->step(target, current, address, handle_breakpoints);
 }
 
@@ -1568,7 +1758,7 @@ int target_unregister_timer_callback(int (*callback)(void *priv), void *priv)
 
 	for (struct target_timer_callback *c = target_timer_callbacks;
 	     c; c = c->next) {
-		if ((c->callback == callback) && (c->priv == priv)) {
+		if (!c->removed && (c->callback == callback) && (c->priv == priv)) {
 			c->removed = true;
 			return ERROR_OK;
 		}
@@ -1587,6 +1777,11 @@ int target_call_event_callbacks(struct target *target, enum target_event event)
 		target_call_event_callbacks(target, TARGET_EVENT_GDB_HALT);
 	}
 
+	/* SMP siblings are resumed by the backend, not by target_resume() */
+	if (target->tlb && (event == TARGET_EVENT_RESUMED ||
+			event == TARGET_EVENT_RESET_ASSERT))
+		mmu_tlb_flush(target->tlb);
+
 	LOG_DEBUG("target event %i (%s)", event,
 			Jim_Nvp_value2name_simple(nvp_target_event, event)->name);
 
@@ -1684,6 +1879,31 @@ static int target_call_timer_callbacks_check_time(int checktime)
 	return ERROR_OK;
 }
 
+/* don't wake up more often than this for a pending timer */
+#define TARGET_TIMER_MIN_SLEEP_MS	1
+
+unsigned int target_timer_next_event(unsigned int max_ms)
+{
+	struct timeval now;
+	gettimeofday(&now, NULL);
+
+	unsigned int next = max_ms;
+	for (struct target_timer_callback *c = target_timer_callbacks; c; c = c->next) {
+		/* periodic callbacks, e.g. the 1ms target request polls, run
+		 * on the regular poll period */
+		if (c->removed || c->type != TARGET_TIMER_TYPE_ONESHOT)
+			continue;
+		int64_t us = (int64_t)(c->when.tv_sec - now.tv_sec) * 1000000
+			+ (c->when.tv_usec - now.tv_usec);
+		int64_t ms = (us + 999) / 1000;
+		if (ms < TARGET_TIMER_MIN_SLEEP_MS)
+			ms = TARGET_TIMER_MIN_SLEEP_MS;
+		if (ms < next)
+			next = ms;
+	}
+	return next;
+}
+
 int target_call_timer_callbacks(void)
 {
 	return target_call_timer_callbacks_check_time(1);
@@ -2030,6 +2250,51 @@ static void target_destroy(struct target *target)
 	free(target);
 }
 
+/* Lists used by handle_target() to poll the targets, kept across polls
+ * and only reallocated when more targets are defined. */
+static struct {
+	unsigned size;
+	struct target **poll;
+	struct target **batch;
+	int *results;
+	int *batch_results;
+	bool *polled;
+	enum target_state *prev_state;
+} poll_lists;
+
+static void target_free_poll_lists(void)
+{
+	free(poll_lists.poll);
+	free(poll_lists.batch);
+	free(poll_lists.results);
+	free(poll_lists.batch_results);
+	free(poll_lists.polled);
+	free(poll_lists.prev_state);
+	memset(&poll_lists, 0, sizeof(poll_lists));
+}
+
+static int target_alloc_poll_lists(unsigned num_targets)
+{
+	if (num_targets <= poll_lists.size)
+		return ERROR_OK;
+
+	target_free_poll_lists();
+	poll_lists.poll = calloc(num_targets, sizeof(*poll_lists.poll));
+	poll_lists.batch = calloc(num_targets, sizeof(*poll_lists.batch));
+	poll_lists.results = calloc(num_targets, sizeof(*poll_lists.results));
+	poll_lists.batch_results = calloc(num_targets, sizeof(*poll_lists.batch_results));
+	poll_lists.polled = calloc(num_targets, sizeof(*poll_lists.polled));
+	poll_lists.prev_state = calloc(num_targets, sizeof(*poll_lists.prev_state));
+	if (!poll_lists.poll || !poll_lists.batch || !poll_lists.results ||
+			!poll_lists.batch_results || !poll_lists.polled || !poll_lists.prev_state) {
+		target_free_poll_lists();
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+	poll_lists.size = num_targets;
+	return ERROR_OK;
+}
+
 void target_quit(void)
 {
 	struct target_event_callback *pe = target_event_callbacks;
@@ -2057,6 +2322,7 @@ void target_quit(void)
 	}
 
 	all_targets = NULL;
+	target_free_poll_lists();
 }
 
 int target_arch_state(struct target *target)
@@ -2163,6 +2429,10 @@ int target_write_buffer(struct target *target, target_addr_t address, uint32_t s
 		return ERROR_FAIL;
 	}
 
+	int retval = target_mem_batch_flush(target);
+	if (retval != ERROR_OK)
+		return retval;
+
 	return target->type->write_buffer(target, address, size, buffer);
 }
 
@@ -2225,6 +2495,10 @@ int target_read_buffer(struct target *target, target_addr_t address, uint32_t si
 		return ERROR_FAIL;
 	}
 
+	int retval = target_mem_batch_flush(target);
+	if (retval != ERROR_OK)
+		return retval;
+
 	return target->type->read_buffer(target, address, size, buffer);
 }
 
@@ -2754,13 +3028,32 @@ static int handle_target(void *priv)
 		recursive = 0;
 	}
 
+	/* only poll targets if we've got power and srst isn't asserted */
+	if (powerDropout || srstAsserted || !is_jtag_poll_safe())
+		return retval;
+
 	/* Poll targets for state changes unless that's globally disabled.
 	 * Skip targets that are currently disabled.
 	 */
-	for (struct target *target = all_targets;
-			is_jtag_poll_safe() && target;
-			target = target->next) {
+	unsigned num_targets = 0;
+	for (struct target *target = all_targets; target; target = target->next)
+		num_targets++;
+
+	if (num_targets == 0)
+		return retval;
+	if (target_alloc_poll_lists(num_targets) != ERROR_OK)
+		return ERROR_FAIL;
+
+	struct target **poll = poll_lists.poll;
+	struct target **batch = poll_lists.batch;
+	int *results = poll_lists.results;
+	int *batch_results = poll_lists.batch_results;
+	bool *polled = poll_lists.polled;
+	enum target_state *prev_state = poll_lists.prev_state;
+	memset(polled, 0, num_targets * sizeof(*polled));
 
+	unsigned count = 0;
+	for (struct target *target = all_targets; target; target = target->next) {
 		if (!target_was_examined(target))
 			continue;
 
@@ -2774,39 +3067,88 @@ static int handle_target(void *priv)
 		}
 		target->backoff.count = 0;
 
-		/* only poll target if we've got power and srst isn't asserted */
-		if (!powerDropout && !srstAsserted) {
-			/* polling may fail silently until the target has been examined */
-			retval = target_poll(target);
-			if (retval != ERROR_OK) {
-				/* 100ms polling interval. Increase interval between polling up to 5000ms */
-				if (target->backoff.times * polling_interval < 5000) {
-					target->backoff.times *= 2;
-					target->backoff.times++;
-				}
+		if (target->poll_idle.times > target->poll_idle.count && !target->halt_issued) {
+			/* nothing happened lately, poll it less often */
+			target->poll_idle.count++;
+			continue;
+		}
+		target->poll_idle.count = 0;
 
-				/* Tell GDB to halt the debugger. This allows the user to
-				 * run monitor commands to handle the situation.
-				 */
-				target_call_event_callbacks(target, TARGET_EVENT_GDB_HALT);
+		prev_state[count] = target->state;
+		poll[count++] = target;
+	}
+
+	/* Targets of a type that can poll several at once have their status
+	 * reads queued into one transaction per adapter.  SMP groups update
+	 * the state of other PEs while polling, so they are polled alone. */
+	for (unsigned i = 0; i < count; i++) {
+		void (*poll_batch)(struct target **, unsigned, int *) = poll[i]->type->poll_batch;
+
+		if (polled[i] || poll[i]->smp || !poll_batch)
+			continue;
+
+		unsigned n = 0;
+		for (unsigned j = i; j < count; j++) {
+			if (poll[j]->type->poll_batch == poll_batch && !poll[j]->smp)
+				batch[n++] = poll[j];
+		}
+		if (n < 2)
+			continue;
+
+		poll_batch(batch, n, batch_results);
+		for (unsigned j = i, k = 0; j < count && k < n; j++) {
+			if (poll[j] != batch[k])
+				continue;
+			results[j] = target_poll_done(poll[j], batch_results[k++]);
+			polled[j] = true;
+		}
+	}
+
+	for (unsigned i = 0; i < count && is_jtag_poll_safe(); i++) {
+		struct target *target = poll[i];
+
+		/* polling may fail silently until the target has been examined */
+		retval = polled[i] ? results[i] : target_poll(target);
+
+		if (retval == ERROR_OK && target->state == prev_state[i] && !target->halt_issued) {
+			/* After a second without a state change, poll only
+			 * every 2nd, then every 4th interval */
+			if (++target->poll_unchanged >= 1000 / polling_interval &&
+					target->poll_idle.times < 3) {
+				target->poll_idle.times *= 2;
+				target->poll_idle.times++;
 			}
-			if (target->backoff.times > 0) {
-				LOG_USER("Polling target %s failed, trying to reexamine", target_name(target));
-				target_reset_examined(target);
-				retval = target_examine_one(target);
-				/* Target examination could have failed due to unstable connection,
-				 * but we set the examined flag anyway to repoll it later */
-				if (retval != ERROR_OK) {
-					target->examined = true;
-					LOG_USER("Examination failed, GDB will be halted. Polling again in %dms",
-						 target->backoff.times * polling_interval);
-					return retval;
-				}
+		} else
+			target_poll_wake(target);
+
+		if (retval != ERROR_OK) {
+			/* 100ms polling interval. Increase interval between polling up to 5000ms */
+			if (target->backoff.times * polling_interval < 5000) {
+				target->backoff.times *= 2;
+				target->backoff.times++;
 			}
 
-			/* Since we succeeded, we reset backoff count */
-			target->backoff.times = 0;
+			/* Tell GDB to halt the debugger. This allows the user to
+			 * run monitor commands to handle the situation.
+			 */
+			target_call_event_callbacks(target, TARGET_EVENT_GDB_HALT);
 		}
+		if (target->backoff.times > 0) {
+			LOG_USER("Polling target %s failed, trying to reexamine", target_name(target));
+			target_reset_examined(target);
+			retval = target_examine_one(target);
+			/* Target examination could have failed due to unstable connection,
+			 * but we set the examined flag anyway to repoll it later */
+			if (retval != ERROR_OK) {
+				target->examined = true;
+				LOG_USER("Examination failed, GDB will be halted. Polling again in %dms",
+					 target->backoff.times * polling_interval);
+				break;
+			}
+		}
+
+		/* Since we succeeded, we reset backoff count */
+		target->backoff.times = 0;
 	}
 
 	return retval;
@@ -3225,13 +3567,24 @@ COMMAND_HANDLER(handle_md_command)
 	if (CMD_ARGC == 2)
 		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[1], count);
 
+	struct target *target = get_current_target(CMD_CTX);
+	if (target->mem_batch && !physical) {
+		/* results are returned by "target batch" */
+		for (unsigned i = 0; i < count; i++) {
+			int retval = target_mem_batch_add(target, false, size,
+					address + i * size, 0);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+		return ERROR_OK;
+	}
+
 	uint8_t *buffer = calloc(count, size);
 	if (buffer == NULL) {
 		LOG_ERROR("Failed to allocate md read buffer");
 		return ERROR_FAIL;
 	}
 
-	struct target *target = get_current_target(CMD_CTX);
 	int retval = fn(target, address, size, count, buffer);
 	if (ERROR_OK == retval)
 		target_handle_md_output(CMD, target, address, size, count, buffer);
@@ -3344,6 +3697,16 @@ COMMAND_HANDLER(handle_mw_command)
 			return ERROR_COMMAND_SYNTAX_ERROR;
 	}
 
+	if (target->mem_batch && !physical) {
+		for (unsigned i = 0; i < count; i++) {
+			int retval = target_mem_batch_add(target, true, wordsize,
+					address + i * wordsize, value);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+		return ERROR_OK;
+	}
+
 	return target_fill_mem(target, address, fn, wordsize, value, count);
 }
 
@@ -3921,183 +4284,398 @@ COMMAND_HANDLER(handle_virt2phys_command)
 	return retval;
 }
 
-static void writeData(FILE *f, const void *data, size_t len)
+static struct mmu_tlb *get_current_tlb(struct command_invocation *cmd)
 {
-	size_t written = fwrite(data, 1, len, f);
-	if (written != len)
-		LOG_ERROR("failed to write %zu bytes: %s", len, strerror(errno));
+	struct target *target = get_current_target(CMD_CTX);
+
+	if (!target->tlb)
+		command_print(CMD, "target %s does not cache MMU translations",
+			target_name(target));
+	return target->tlb;
 }
 
-static void writeLong(FILE *f, int l, struct target *target)
+COMMAND_HANDLER(handle_mmu_flush_command)
 {
-	uint8_t val[4];
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	struct mmu_tlb *tlb = get_current_tlb(CMD);
+	if (!tlb)
+		return ERROR_FAIL;
 
-	target_buffer_set_u32(target, val, l);
-	writeData(f, val, 4);
+	mmu_tlb_flush(tlb);
+	return ERROR_OK;
 }
 
-static void writeString(FILE *f, char *s)
+COMMAND_HANDLER(handle_mmu_stats_command)
 {
-	writeData(f, s, strlen(s));
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	struct mmu_tlb *tlb = get_current_tlb(CMD);
+	if (!tlb)
+		return ERROR_FAIL;
+
+	if (CMD_ARGC == 1) {
+		if (strcmp(CMD_ARGV[0], "reset"))
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		tlb->hits = 0;
+		tlb->misses = 0;
+		tlb->flushes = 0;
+		return ERROR_OK;
+	}
+
+	uint64_t lookups = tlb->hits + tlb->misses;
+	command_print(CMD, "%u of %u entries in use", tlb->used, MMU_TLB_ENTRIES);
+	command_print(CMD, "%" PRIu64 " hits, %" PRIu64 " misses (%u%% hit rate), %" PRIu64 " flushes",
+		tlb->hits, tlb->misses,
+		lookups ? (unsigned)(tlb->hits * 100 / lookups) : 0,
+		tlb->flushes);
+	return ERROR_OK;
 }
 
-typedef unsigned char UNIT[2];  /* unit of profiling */
+static const struct command_registration mmu_command_handlers[] = {
+	{
+		.name = "flush",
+		.handler = handle_mmu_flush_command,
+		.mode = COMMAND_EXEC,
+		.help = "drop all cached virtual to physical translations",
+		.usage = "",
+	},
+	{
+		.name = "stats",
+		.handler = handle_mmu_stats_command,
+		.mode = COMMAND_EXEC,
+		.help = "show or reset translation cache hit counts",
+		.usage = "['reset']",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+/* Live profiling: samples are taken from a timer callback and added to
+ * the histogram until "profile stop" or the deadline.  The callback is a
+ * one-shot timer re-armed every time, as the server loop only wakes early
+ * for those, and it samples for a few milliseconds per call. */
+#define PROFILE_BATCH		1024
+#define PROFILE_TOP			10
+#define PROFILE_REARM_MS	1
+#define PROFILE_BUDGET_MS	2
+
+static struct {
+	struct target *target;
+	struct profile_hist *hist;
+	bool running;
+	bool use_sample_hook;
+	bool halted_by_us;
+	int64_t start_ms;
+	int64_t stop_ms;
+	int64_t deadline_ms;
+	uint32_t samples[PROFILE_BATCH];
+} profile_session;
+
+static int target_profile_timer(void *priv);
 
-/* Dump a gmon.out histogram file. */
-static void write_gmon(uint32_t *samples, uint32_t sampleNum, const char *filename, bool with_range,
-			uint32_t start_address, uint32_t end_address, struct target *target, uint32_t duration_ms)
+/* Takes one sample by halting and resuming the target, one step per call */
+static int target_profile_sample_halt(struct target *target, uint32_t *sample,
+		uint32_t *num_samples)
 {
-	uint32_t i;
-	FILE *f = fopen(filename, "w");
-	if (f == NULL)
-		return;
-	writeString(f, "gmon");
-	writeLong(f, 0x00000001, target); /* Version */
-	writeLong(f, 0, target); /* padding */
-	writeLong(f, 0, target); /* padding */
-	writeLong(f, 0, target); /* padding */
-
-	uint8_t zero = 0;  /* GMON_TAG_TIME_HIST */
-	writeData(f, &zero, 1);
-
-	/* figure out bucket size */
-	uint32_t min;
-	uint32_t max;
-	if (with_range) {
-		min = start_address;
-		max = end_address;
-	} else {
-		min = samples[0];
-		max = samples[0];
-		for (i = 0; i < sampleNum; i++) {
-			if (min > samples[i])
-				min = samples[i];
-			if (max < samples[i])
-				max = samples[i];
-		}
+	*num_samples = 0;
 
-		/* max should be (largest sample + 1)
-		 * Refer to binutils/gprof/hist.c (find_histogram_for_pc) */
-		max++;
-	}
+	int retval = target_poll(target);
+	if (retval != ERROR_OK)
+		return retval;
 
-	int addressSpace = max - min;
-	assert(addressSpace >= 2);
+	if (target->state == TARGET_RUNNING) {
+		profile_session.halted_by_us = true;
+		return target_halt(target);
+	}
+	if (target->state != TARGET_HALTED || !profile_session.halted_by_us)
+		return ERROR_OK;
 
-	/* FIXME: What is the reasonable number of buckets?
-	 * The profiling result will be more accurate if there are enough buckets. */
-	static const uint32_t maxBuckets = 128 * 1024; /* maximum buckets. */
-	uint32_t numBuckets = addressSpace / sizeof(UNIT);
-	if (numBuckets > maxBuckets)
-		numBuckets = maxBuckets;
-	int *buckets = malloc(sizeof(int) * numBuckets);
-	if (buckets == NULL) {
-		fclose(f);
-		return;
+	struct reg *reg = register_get_by_name(target->reg_cache, "pc", 1);
+	if (reg) {
+		*sample = buf_get_u32(reg->value, 0, 32);
+		*num_samples = 1;
 	}
-	memset(buckets, 0, sizeof(int) * numBuckets);
-	for (i = 0; i < sampleNum; i++) {
-		uint32_t address = samples[i];
+	profile_session.halted_by_us = false;
+	/* current pc, addr = 0, do not handle breakpoints, not debugging */
+	return target_resume(target, 1, 0, 0, 0);
+}
 
-		if ((address < min) || (max <= address))
-			continue;
+static int target_profile_sample(struct target *target)
+{
+	uint32_t num_samples = 0;
+	int retval;
 
-		long long a = address - min;
-		long long b = numBuckets;
-		long long c = addressSpace;
-		int index_t = (a * b) / c; /* danger!!!! int32 overflows */
-		buckets[index_t]++;
-	}
-
-	/* append binary memory gmon.out &profile_hist_hdr ((char*)&profile_hist_hdr + sizeof(struct gmon_hist_hdr)) */
-	writeLong(f, min, target);			/* low_pc */
-	writeLong(f, max, target);			/* high_pc */
-	writeLong(f, numBuckets, target);	/* # of buckets */
-	float sample_rate = sampleNum / (duration_ms / 1000.0);
-	writeLong(f, sample_rate, target);
-	writeString(f, "seconds");
-	for (i = 0; i < (15-strlen("seconds")); i++)
-		writeData(f, &zero, 1);
-	writeString(f, "s");
-
-	/*append binary memory gmon.out profile_hist_data (profile_hist_data + profile_hist_hdr.hist_size) */
-
-	char *data = malloc(2 * numBuckets);
-	if (data != NULL) {
-		for (i = 0; i < numBuckets; i++) {
-			int val;
-			val = buckets[i];
-			if (val > 65535)
-				val = 65535;
-			data[i * 2] = val&0xff;
-			data[i * 2 + 1] = (val >> 8) & 0xff;
+	if (profile_session.use_sample_hook) {
+		retval = target->type->profile_sample(target, profile_session.samples,
+				PROFILE_BATCH, &num_samples);
+		if (retval == ERROR_TARGET_RESOURCE_NOT_AVAILABLE) {
+			LOG_INFO("No PC sampling register, halting and resuming the target instead");
+			profile_session.use_sample_hook = false;
+			return ERROR_OK;
 		}
-		free(buckets);
-		writeData(f, data, numBuckets * 2);
-		free(data);
 	} else
-		free(buckets);
+		retval = target_profile_sample_halt(target, profile_session.samples,
+				&num_samples);
+	if (retval != ERROR_OK)
+		return retval;
 
-	fclose(f);
+	return profile_hist_add(profile_session.hist, profile_session.samples, num_samples);
 }
 
-/* profiling samples the CPU PC as quickly as OpenOCD is able,
- * which will be used as a random sampling of PC */
-COMMAND_HANDLER(handle_profile_command)
+static void target_profile_stop(void)
 {
-	struct target *target = get_current_target(CMD_CTX);
+	if (!profile_session.running)
+		return;
 
-	if ((CMD_ARGC != 2) && (CMD_ARGC != 4))
-		return ERROR_COMMAND_SYNTAX_ERROR;
+	target_unregister_timer_callback(target_profile_timer, NULL);
+	profile_session.running = false;
+	profile_session.stop_ms = timeval_ms();
+	LOG_INFO("Profiling stopped, %" PRIu64 " samples",
+			profile_hist_samples(profile_session.hist));
+}
 
-	const uint32_t MAX_PROFILE_SAMPLE_NUM = 10000;
-	uint32_t offset;
-	uint32_t num_of_samples;
-	int retval = ERROR_OK;
+static int target_profile_timer(void *priv)
+{
+	if (!profile_session.running)
+		return ERROR_OK;
 
-	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[0], offset);
+	int64_t now = timeval_ms();
+	int64_t until = now + PROFILE_BUDGET_MS;
+	do {
+		int retval = target_profile_sample(profile_session.target);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("Error while sampling the PC, profiling stopped");
+			target_profile_stop();
+			return retval;
+		}
+		now = timeval_ms();
+	} while (now < until);
 
-	uint32_t *samples = malloc(sizeof(uint32_t) * MAX_PROFILE_SAMPLE_NUM);
-	if (samples == NULL) {
-		LOG_ERROR("No memory to store samples.");
-		return ERROR_FAIL;
+	if (profile_session.deadline_ms && now >= profile_session.deadline_ms) {
+		target_profile_stop();
+		return ERROR_OK;
 	}
 
-	uint64_t timestart_ms = timeval_ms();
-	/**
-	 * Some cores let us sample the PC without the
-	 * annoying halt/resume step; for example, ARMv7 PCSR.
-	 * Provide a way to use that more efficient mechanism.
-	 */
-	retval = target_profiling(target, samples, MAX_PROFILE_SAMPLE_NUM,
-				&num_of_samples, offset);
-	if (retval != ERROR_OK) {
-		free(samples);
-		return retval;
-	}
-	uint32_t duration_ms = timeval_ms() - timestart_ms;
+	return target_register_timer_callback(target_profile_timer, PROFILE_REARM_MS,
+			TARGET_TIMER_TYPE_ONESHOT, NULL);
+}
 
-	assert(num_of_samples <= MAX_PROFILE_SAMPLE_NUM);
+static int target_profile_begin(struct target *target)
+{
+	target_profile_stop();
+	profile_hist_free(profile_session.hist);
 
-	retval = target_poll(target);
-	if (retval != ERROR_OK) {
-		free(samples);
+	profile_session.hist = profile_hist_new();
+	if (!profile_session.hist)
+		return ERROR_FAIL;
+
+	profile_session.target = target;
+	profile_session.use_sample_hook = target->type->profile_sample != NULL;
+	profile_session.halted_by_us = false;
+	profile_session.start_ms = timeval_ms();
+	profile_session.stop_ms = 0;
+	profile_session.deadline_ms = 0;
+
+	return ERROR_OK;
+}
+
+static uint32_t target_profile_duration(void)
+{
+	int64_t end = profile_session.running || !profile_session.stop_ms ?
+			timeval_ms() : profile_session.stop_ms;
+	return end - profile_session.start_ms;
+}
+
+COMMAND_HANDLER(handle_profile_start_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	uint32_t seconds = 0;
+
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	if (CMD_ARGC == 1)
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[0], seconds);
+
+	if (!target_was_examined(target)) {
+		LOG_ERROR("Target not examined yet");
+		return ERROR_FAIL;
+	}
+
+	int retval = target_profile_begin(target);
+	if (retval != ERROR_OK)
 		return retval;
+
+	if (seconds)
+		profile_session.deadline_ms = profile_session.start_ms + seconds * 1000ULL;
+	profile_session.running = true;
+
+	return target_register_timer_callback(target_profile_timer, PROFILE_REARM_MS,
+			TARGET_TIMER_TYPE_ONESHOT, NULL);
+}
+
+COMMAND_HANDLER(handle_profile_stop_command)
+{
+	if (CMD_ARGC)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	target_profile_stop();
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_profile_status_command)
+{
+	if (CMD_ARGC)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (!profile_session.hist) {
+		command_print(CMD, "no profile");
+		return ERROR_OK;
 	}
-	if (target->state == TARGET_RUNNING) {
-		retval = target_halt(target);
-		if (retval != ERROR_OK) {
-			free(samples);
+
+	uint64_t samples = profile_hist_samples(profile_session.hist);
+	uint32_t duration_ms = target_profile_duration();
+	command_print(CMD, "%s, %" PRIu64 " samples in %" PRIu32 " ms (%" PRIu64
+			" samples/s), %" PRIu32 " addresses",
+			profile_session.running ? "running" : "stopped", samples, duration_ms,
+			duration_ms ? samples * 1000 / duration_ms : 0,
+			profile_hist_addresses(profile_session.hist));
+
+	struct profile_bucket top[PROFILE_TOP];
+	uint32_t n = profile_hist_top(profile_session.hist, top, PROFILE_TOP);
+	for (uint32_t i = 0; i < n; i++)
+		command_print(CMD, "0x%08" PRIx32 " %8" PRIu32 " %5.1f%%", top[i].pc,
+				top[i].count, 100.0 * top[i].count / samples);
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_profile_write_command)
+{
+	if (CMD_ARGC != 2 && CMD_ARGC != 4)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (!profile_session.hist) {
+		command_print(CMD, "no profile");
+		return ERROR_FAIL;
+	}
+
+	uint32_t start_address = 0;
+	uint32_t end_address = 0;
+	bool with_range = CMD_ARGC == 4;
+	if (with_range) {
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[2], start_address);
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[3], end_address);
+	}
+
+	int retval;
+	if (!strcmp(CMD_ARGV[0], "gmon"))
+		retval = profile_hist_write_gmon(profile_session.hist, CMD_ARGV[1],
+				with_range, start_address, end_address,
+				profile_session.target, target_profile_duration());
+	else if (!strcmp(CMD_ARGV[0], "folded") && !with_range)
+		retval = profile_hist_write_folded(profile_session.hist, CMD_ARGV[1]);
+	else
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (retval == ERROR_OK)
+		command_print(CMD, "Wrote %s", CMD_ARGV[1]);
+	return retval;
+}
+
+/* profiling samples the CPU PC as quickly as OpenOCD is able,
+ * which will be used as a random sampling of PC */
+COMMAND_HANDLER(handle_profile_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+
+	if (CMD_ARGC >= 1) {
+		if (!strcmp(CMD_ARGV[0], "start"))
+			return CALL_COMMAND_HANDLER(handle_profile_start_command);
+		if (!strcmp(CMD_ARGV[0], "stop"))
+			return CALL_COMMAND_HANDLER(handle_profile_stop_command);
+		if (!strcmp(CMD_ARGV[0], "status"))
+			return CALL_COMMAND_HANDLER(handle_profile_status_command);
+		if (!strcmp(CMD_ARGV[0], "write"))
+			return CALL_COMMAND_HANDLER(handle_profile_write_command);
+	}
+
+	if ((CMD_ARGC != 2) && (CMD_ARGC != 4))
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	const uint32_t MAX_PROFILE_SAMPLE_NUM = 10000;
+	uint32_t offset;
+	uint32_t num_of_samples;
+	int retval = ERROR_OK;
+
+	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[0], offset);
+
+	retval = target_profile_begin(target);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (profile_session.use_sample_hook) {
+		/* sample without halting, in batches, into the histogram */
+		retval = target_poll(target);
+		if (retval == ERROR_OK && target->state == TARGET_HALTED)
+			retval = target_resume(target, 1, 0, 0, 0);
+		int64_t deadline_ms = profile_session.start_ms + offset * 1000ULL;
+		while (retval == ERROR_OK && profile_session.use_sample_hook &&
+				timeval_ms() < deadline_ms) {
+			retval = target_profile_sample(target);
+			keep_alive();
+		}
+		if (retval == ERROR_OK && !profile_session.use_sample_hook) {
+			/* the fallback below starts from a halted target */
+			retval = target_halt(target);
+			if (retval == ERROR_OK)
+				retval = target_wait_state(target, TARGET_HALTED, 1000);
+		}
+		if (retval != ERROR_OK)
 			return retval;
+	}
+
+	if (!profile_session.use_sample_hook) {
+		uint32_t *samples = malloc(sizeof(uint32_t) * MAX_PROFILE_SAMPLE_NUM);
+		if (samples == NULL) {
+			LOG_ERROR("No memory to store samples.");
+			return ERROR_FAIL;
 		}
+
+		/**
+		 * Some cores let us sample the PC without the
+		 * annoying halt/resume step; for example, ARMv7 PCSR.
+		 * Provide a way to use that more efficient mechanism.
+		 */
+		retval = target_profiling(target, samples, MAX_PROFILE_SAMPLE_NUM,
+					&num_of_samples, offset);
+		if (retval == ERROR_OK) {
+			assert(num_of_samples <= MAX_PROFILE_SAMPLE_NUM);
+			retval = profile_hist_add(profile_session.hist, samples, num_of_samples);
+		}
+		free(samples);
 	}
+	profile_session.stop_ms = timeval_ms();
+	if (retval != ERROR_OK)
+		return retval;
+
+	LOG_INFO("Profiling completed. %" PRIu64 " samples.",
+			profile_hist_samples(profile_session.hist));
 
 	retval = target_poll(target);
-	if (retval != ERROR_OK) {
-		free(samples);
+	if (retval != ERROR_OK)
 		return retval;
+	if (target->state == TARGET_RUNNING) {
+		retval = target_halt(target);
+		if (retval != ERROR_OK)
+			return retval;
 	}
 
+	retval = target_poll(target);
+	if (retval != ERROR_OK)
+		return retval;
+
 	uint32_t start_address = 0;
 	uint32_t end_address = 0;
 	bool with_range = false;
@@ -4107,11 +4685,11 @@ COMMAND_HANDLER(handle_profile_command)
 		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[3], end_address);
 	}
 
-	write_gmon(samples, num_of_samples, CMD_ARGV[1],
-		   with_range, start_address, end_address, target, duration_ms);
-	command_print(CMD, "Wrote %s", CMD_ARGV[1]);
+	retval = profile_hist_write_gmon(profile_session.hist, CMD_ARGV[1],
+		   with_range, start_address, end_address, target, target_profile_duration());
+	if (retval == ERROR_OK)
+		command_print(CMD, "Wrote %s", CMD_ARGV[1]);
 
-	free(samples);
 	return retval;
 }
 
@@ -4520,6 +5098,259 @@ static int target_array2mem(Jim_Interp *interp, struct target *target,
 	return e;
 }
 
+/* chunk between keep_alive() calls and upper bound for the blob commands */
+#define TARGET_BLOB_CHUNK	(64 * 1024)
+#define TARGET_BLOB_MAX		(64 * 1024 * 1024)
+
+static int target_blob_options(Jim_Interp *interp, const char *cmd,
+		int argc, Jim_Obj *const *argv, bool *is_phys, bool *is_hex)
+{
+	*is_phys = false;
+	*is_hex = false;
+
+	for (int i = 0; i < argc; i++) {
+		if (Jim_CompareStringImmediate(interp, argv[i], "phys"))
+			*is_phys = true;
+		else if (Jim_CompareStringImmediate(interp, argv[i], "hex"))
+			*is_hex = true;
+		else {
+			Jim_SetResultFormatted(interp, "%s: unknown option '%#s'",
+					cmd, argv[i]);
+			return JIM_ERR;
+		}
+	}
+	return JIM_OK;
+}
+
+/**
+ * Move @a len bytes between target memory and @a buf, in large chunks
+ * straight to or from the caller's buffer.  Physical accesses use the
+ * widest access size the address and length allow.
+ */
+static int target_blob_xfer(struct target *target, target_addr_t addr,
+		uint32_t len, uint8_t *buf, bool is_phys, bool is_write)
+{
+	uint32_t count, width;
+	int retval;
+
+	while (len > 0) {
+		count = MIN(len, TARGET_BLOB_CHUNK);
+
+		if (is_phys) {
+			if (((addr | count) & 3) == 0)
+				width = 4;
+			else if (((addr | count) & 1) == 0)
+				width = 2;
+			else
+				width = 1;
+			if (is_write)
+				retval = target_write_phys_memory(target, addr, width,
+						count / width, buf);
+			else
+				retval = target_read_phys_memory(target, addr, width,
+						count / width, buf);
+		} else if (is_write)
+			retval = target_write_buffer(target, addr, count, buf);
+		else
+			retval = target_read_buffer(target, addr, count, buf);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("%s @ " TARGET_ADDR_FMT ", cnt=%" PRIu32 ", failed",
+					is_write ? "bin2mem: Write" : "mem2bin: Read",
+					addr, count);
+			return retval;
+		}
+
+		addr += count;
+		buf += count;
+		len -= count;
+		keep_alive();
+	}
+
+	return ERROR_OK;
+}
+
+static int jim_mem2bin(Jim_Interp *interp, int argc, Jim_Obj *const *argv)
+{
+	struct command_context *context;
+	struct target *target;
+
+	context = current_command_context(interp);
+	assert(context != NULL);
+
+	target = get_current_target(context);
+	if (target == NULL) {
+		LOG_ERROR("mem2bin: no current target");
+		return JIM_ERR;
+	}
+
+	return target_mem2bin(interp, target, argc - 1, argv + 1);
+}
+
+/*
+ * Returns target memory as one Jim string: raw bytes, or two lowercase
+ * hex digits per byte.  The string's storage is the buffer the target
+ * read lands in, so there is no per element work on the Jim side.
+ */
+static int target_mem2bin(Jim_Interp *interp, struct target *target,
+		int argc, Jim_Obj *const *argv)
+{
+	static const char hex_digits[] = "0123456789abcdef";
+	jim_wide addr, len;
+	bool is_phys, is_hex;
+	uint32_t outlen;
+	uint8_t *buf, *raw;
+	int e;
+
+	/* argv[0] = memory address
+	 * argv[1] = byte count
+	 * argv[2..] = 'phys', 'hex'
+	 */
+	if (argc < 2 || argc > 4) {
+		Jim_WrongNumArgs(interp, 0, argv, "address count ['phys'] ['hex']");
+		return JIM_ERR;
+	}
+
+	e = Jim_GetWide(interp, argv[0], &addr);
+	if (e != JIM_OK)
+		return e;
+	e = Jim_GetWide(interp, argv[1], &len);
+	if (e != JIM_OK)
+		return e;
+	e = target_blob_options(interp, "mem2bin", argc - 2, argv + 2,
+			&is_phys, &is_hex);
+	if (e != JIM_OK)
+		return e;
+
+	if (len <= 0 || len > TARGET_BLOB_MAX) {
+		Jim_SetResultFormatted(interp, "mem2bin: count must be 1..%d",
+				TARGET_BLOB_MAX);
+		return JIM_ERR;
+	}
+	if ((target_addr_t)(addr + len - 1) < (target_addr_t)addr) {
+		Jim_SetResultFormatted(interp, "mem2bin: addr + len - wraps to zero?");
+		return JIM_ERR;
+	}
+
+	outlen = is_hex ? 2 * len : len;
+	buf = malloc(outlen + 1);
+	if (buf == NULL) {
+		Jim_SetResultFormatted(interp, "mem2bin: out of memory");
+		return JIM_ERR;
+	}
+
+	/* for hex, read into the upper half and expand in place */
+	raw = buf + outlen - len;
+	if (target_blob_xfer(target, addr, len, raw, is_phys, false) != ERROR_OK) {
+		free(buf);
+		Jim_SetResultFormatted(interp, "mem2bin: cannot read memory");
+		return JIM_ERR;
+	}
+
+	if (is_hex) {
+		for (uint32_t i = 0; i < len; i++) {
+			uint8_t b = raw[i];
+			buf[2 * i] = hex_digits[b >> 4];
+			buf[2 * i + 1] = hex_digits[b & 0xf];
+		}
+	}
+	buf[outlen] = 0;
+
+	Jim_SetResult(interp, Jim_NewStringObjNoAlloc(interp, (char *)buf, outlen));
+	return JIM_OK;
+}
+
+static int jim_bin2mem(Jim_Interp *interp, int argc, Jim_Obj *const *argv)
+{
+	struct command_context *context;
+	struct target *target;
+
+	context = current_command_context(interp);
+	assert(context != NULL);
+
+	target = get_current_target(context);
+	if (target == NULL) {
+		LOG_ERROR("bin2mem: no current target");
+		return JIM_ERR;
+	}
+
+	return target_bin2mem(interp, target, argc - 1, argv + 1);
+}
+
+/*
+ * Writes a Jim string to target memory: its raw bytes, or with 'hex'
+ * the bytes spelled by its pairs of hex digits.  Raw data goes to the
+ * target straight from the string's own storage.
+ */
+static int target_bin2mem(Jim_Interp *interp, struct target *target,
+		int argc, Jim_Obj *const *argv)
+{
+	jim_wide addr;
+	bool is_phys, is_hex;
+	const char *data;
+	uint8_t *buf = NULL;
+	int len, e;
+
+	/* argv[0] = memory address
+	 * argv[1] = data
+	 * argv[2..] = 'phys', 'hex'
+	 */
+	if (argc < 2 || argc > 4) {
+		Jim_WrongNumArgs(interp, 0, argv, "address data ['phys'] ['hex']");
+		return JIM_ERR;
+	}
+
+	e = Jim_GetWide(interp, argv[0], &addr);
+	if (e != JIM_OK)
+		return e;
+	e = target_blob_options(interp, "bin2mem", argc - 2, argv + 2,
+			&is_phys, &is_hex);
+	if (e != JIM_OK)
+		return e;
+
+	data = Jim_GetString(argv[1], &len);
+	if (is_hex) {
+		if (len & 1) {
+			Jim_SetResultFormatted(interp, "bin2mem: odd number of hex digits");
+			return JIM_ERR;
+		}
+		len /= 2;
+		buf = malloc(len ? len : 1);
+		if (buf == NULL) {
+			Jim_SetResultFormatted(interp, "bin2mem: out of memory");
+			return JIM_ERR;
+		}
+		if (unhexify(buf, data, len) != (size_t)len) {
+			free(buf);
+			Jim_SetResultFormatted(interp, "bin2mem: invalid hex digits");
+			return JIM_ERR;
+		}
+		data = (const char *)buf;
+	}
+
+	if (len == 0 || len > TARGET_BLOB_MAX) {
+		free(buf);
+		Jim_SetResultFormatted(interp, "bin2mem: data must be 1..%d bytes",
+				TARGET_BLOB_MAX);
+		return JIM_ERR;
+	}
+	if ((target_addr_t)(addr + len - 1) < (target_addr_t)addr) {
+		free(buf);
+		Jim_SetResultFormatted(interp, "bin2mem: addr + len - wraps to zero?");
+		return JIM_ERR;
+	}
+
+	/* the target write paths don't modify the buffer */
+	e = target_blob_xfer(target, addr, len, (uint8_t *)data, is_phys, true);
+	free(buf);
+	if (e != ERROR_OK) {
+		Jim_SetResultFormatted(interp, "bin2mem: cannot write memory");
+		return JIM_ERR;
+	}
+
+	Jim_SetEmptyResult(interp);
+	return JIM_OK;
+}
+
 /* FIX? should we propagate errors here rather than printing them
  * and continuing?
  */
@@ -4953,6 +5784,20 @@ static int jim_target_array2mem(Jim_Interp *interp,
 	return target_array2mem(interp, target, argc - 1, argv + 1);
 }
 
+static int jim_target_mem2bin(Jim_Interp *interp,
+		int argc, Jim_Obj *const *argv)
+{
+	struct target *target = Jim_CmdPrivData(interp);
+	return target_mem2bin(interp, target, argc - 1, argv + 1);
+}
+
+static int jim_target_bin2mem(Jim_Interp *interp,
+		int argc, Jim_Obj *const *argv)
+{
+	struct target *target = Jim_CmdPrivData(interp);
+	return target_bin2mem(interp, target, argc - 1, argv + 1);
+}
+
 static int jim_target_tap_disabled(Jim_Interp *interp)
 {
 	Jim_SetResultFormatted(interp, "[TAP is disabled]");
@@ -5289,6 +6134,20 @@ static const struct command_registration target_instance_command_handlers[] = {
 			"from target memory",
 		.usage = "arrayname bitwidth address count",
 	},
+	{
+		.name = "bin2mem",
+		.mode = COMMAND_EXEC,
+		.jim_handler = jim_target_bin2mem,
+		.help = "Writes a binary (or hex) string to target memory",
+		.usage = "address data ['phys'] ['hex']",
+	},
+	{
+		.name = "mem2bin",
+		.mode = COMMAND_EXEC,
+		.jim_handler = jim_target_mem2bin,
+		.help = "Returns target memory as a binary (or hex) string",
+		.usage = "address count ['phys'] ['hex']",
+	},
 	{
 		.name = "eventlist",
 		.handler = handle_target_event_list,
@@ -5685,6 +6544,65 @@ static int jim_target_create(Jim_Interp *interp, int argc, Jim_Obj *const *argv)
 	return target_create(&goi);
 }
 
+static int jim_target_batch(Jim_Interp *interp, int argc, Jim_Obj *const *argv)
+{
+	if (argc != 2) {
+		Jim_WrongNumArgs(interp, 1, argv, "script");
+		return JIM_ERR;
+	}
+	struct command_context *cmd_ctx = current_command_context(interp);
+	assert(cmd_ctx != NULL);
+
+	struct target *target = get_current_target(cmd_ctx);
+	if (!target_was_examined(target)) {
+		Jim_SetResultFormatted(interp, "batch: target %s not examined yet",
+				target_name(target));
+		return JIM_ERR;
+	}
+	if (target->mem_batch) {
+		Jim_SetResultFormatted(interp, "batch: already collecting for target %s",
+				target_name(target));
+		return JIM_ERR;
+	}
+
+	struct target_mem_batch batch = {
+		.retval = ERROR_OK,
+	};
+	target->mem_batch = &batch;
+
+	int e = Jim_EvalObj(interp, argv[1]);
+	if (e == JIM_OK || e == JIM_RETURN || batch.retval != ERROR_OK) {
+		/* operations left over from a script error are dropped */
+		if (target_mem_batch_flush(target) != ERROR_OK || batch.retval != ERROR_OK)
+			e = JIM_ERR;
+		else
+			e = JIM_OK;
+	}
+	target->mem_batch = NULL;
+
+	char buf[80];
+	if (batch.retval != ERROR_OK) {
+		struct target_mem_op *op = &batch.ops[batch.failed];
+		snprintf(buf, sizeof(buf), "batch: operation %u (%s of %u bytes at "
+				TARGET_ADDR_FMT ") failed", batch.failed,
+				op->write ? "write" : "read", op->size, op->address);
+		Jim_SetResultString(interp, buf, -1);
+	} else if (e == JIM_OK) {
+		Jim_Obj *list = Jim_NewListObj(interp, NULL, 0);
+		for (unsigned i = 0; i < batch.count; i++) {
+			struct target_mem_op *op = &batch.ops[i];
+			if (op->write)
+				continue;
+			snprintf(buf, sizeof(buf), "0x%0*" PRIx64, 2 * op->size, op->value);
+			Jim_ListAppendElement(interp, list, Jim_NewStringObj(interp, buf, -1));
+		}
+		Jim_SetResult(interp, list);
+	}
+
+	free(batch.ops);
+	return e;
+}
+
 static const struct command_registration target_subcommand_handlers[] = {
 	{
 		.name = "init",
@@ -5726,6 +6644,14 @@ static const struct command_registration target_subcommand_handlers[] = {
 		.usage = "targetname1 targetname2 ...",
 		.help = "gather several target in a smp list"
 	},
+	{
+		.name = "batch",
+		.mode = COMMAND_EXEC,
+		.jim_handler = jim_target_batch,
+		.usage = "script",
+		.help = "Collect the memory reads and writes issued by the "
+			"script into one transaction and return the values read",
+	},
 
 	COMMAND_REGISTRATION_DONE
 };
@@ -5906,6 +6832,10 @@ static const struct command_registration target_command_handlers[] = {
 
 int target_register_commands(struct command_context *cmd_ctx)
 {
+	int retval = rtt_register_commands(cmd_ctx);
+	if (retval != ERROR_OK)
+		return retval;
+
 	return register_commands(cmd_ctx, NULL, target_command_handlers);
 }
 
@@ -6158,7 +7088,8 @@ static const struct command_registration target_exec_command_handlers[] = {
 		.name = "profile",
 		.handler = handle_profile_command,
 		.mode = COMMAND_EXEC,
-		.usage = "seconds filename [start end]",
+		.usage = "(seconds filename [start end]) | (start [seconds]) | "
+			"stop | status | (write (gmon filename [start end] | folded filename))",
 		.help = "profiling samples the CPU PC",
 	},
 	/** @todo don't register virt2phys() unless target supports it */
@@ -6169,6 +7100,13 @@ static const struct command_registration target_exec_command_handlers[] = {
 		.help = "translate a virtual address into a physical address",
 		.usage = "virtual_address",
 	},
+	{
+		.name = "mmu",
+		.mode = COMMAND_EXEC,
+		.help = "translation cache commands",
+		.usage = "",
+		.chain = mmu_command_handlers,
+	},
 	{
 		.name = "reg",
 		.handler = handle_reg_command,
@@ -6360,6 +7298,21 @@ static const struct command_registration target_exec_command_handlers[] = {
 			"and write the 8/16/32 bit values",
 		.usage = "arrayname bitwidth address count",
 	},
+	{
+		.name = "mem2bin",
+		.mode = COMMAND_EXEC,
+		.jim_handler = jim_mem2bin,
+		.help = "read memory and return it as one binary (or hex) "
+			"string for script processing",
+		.usage = "address count ['phys'] ['hex']",
+	},
+	{
+		.name = "bin2mem",
+		.mode = COMMAND_EXEC,
+		.jim_handler = jim_bin2mem,
+		.help = "write a binary (or hex) string to memory",
+		.usage = "address data ['phys'] ['hex']",
+	},
 	{
 		.name = "reset_nag",
 		.handler = handle_target_reset_nag,
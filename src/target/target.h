@@ -43,6 +43,7 @@ struct mem_param;
 struct reg_param;
 struct target_list;
 struct gdb_fileio_info;
+struct mmu_tlb;
 
 /*
  * TARGET_UNKNOWN = 0: we don't know anything about the target yet
@@ -197,6 +198,13 @@ struct target {
 	bool rtos_auto_detect;				/* A flag that indicates that the RTOS has been specified as "auto"
 										 * and must be detected when symbols are offered */
 	struct backoff_timer backoff;
+	/* background polling of a target whose state does not change is
+	 * slowed down: 'times' ticks are skipped between polls */
+	struct backoff_timer poll_idle;
+	int poll_unchanged;
+	/* cached MMU translations, NULL if the target has no MMU support;
+	 * owned by the architecture code */
+	struct mmu_tlb *tlb;
 	int smp;							/* add some target attributes for smp support */
 	struct target_list *head;
 	/* the gdb service is there in case of smp, we have only one gdb server
@@ -212,6 +220,9 @@ struct target {
 
 	/* The semihosting information, extracted from the target. */
 	struct semihosting *semihosting;
+
+	/* memory accesses being collected by "target batch", or NULL */
+	struct target_mem_batch *mem_batch;
 };
 
 struct target_list {
@@ -336,6 +347,17 @@ struct target_memory_check_block {
 	uint32_t result;
 };
 
+/** A single memory access collected by "target batch". */
+struct target_mem_op {
+	bool write;
+	unsigned size;			/* 1, 2, 4 or 8 bytes */
+	target_addr_t address;
+	uint64_t value;			/* data written, or data read back */
+};
+
+int target_run_mem_ops(struct target *target, struct target_mem_op *ops,
+		unsigned count, unsigned *failed);
+
 int target_register_commands(struct command_context *cmd_ctx);
 int target_examine(void);
 
@@ -394,6 +416,11 @@ int target_register_timer_callback(int (*callback)(void *priv),
 		unsigned int time_ms, enum target_timer_type type, void *priv);
 int target_unregister_timer_callback(int (*callback)(void *priv), void *priv);
 int target_call_timer_callbacks(void);
+/**
+ * Returns the number of milliseconds until the next one-shot timer
+ * callback is due, rounded up, but at most @a max_ms.
+ */
+unsigned int target_timer_next_event(unsigned int max_ms);
 /**
  * Invoke this to ensure that e.g. polling timer callbacks happen before
  * a synchronous command completes.
@@ -28,6 +28,7 @@
 #include <jim-nvp.h>
 
 struct target;
+struct target_mem_op;
 
 /**
  * This holds methods shared between all instances of a given target
@@ -44,6 +45,13 @@ struct target_type {
 
 	/* poll current target status */
 	int (*poll)(struct target *target);
+	/**
+	 * Optional.  Polls @a count targets of this type together: their
+	 * status reads are queued and run as one transaction per adapter,
+	 * then each state change is processed as poll() would.  The
+	 * poll() result of each target is stored in @a results.
+	 */
+	void (*poll_batch)(struct target **targets, unsigned count, int *results);
 	/* Invoked only from target_arch_state().
 	 * Issue USER() w/architecture specific status.  */
 	int (*arch_state)(struct target *target);
@@ -137,6 +145,17 @@ struct target_type {
 	int (*write_buffer)(struct target *target, target_addr_t address,
 			uint32_t size, const uint8_t *buffer);
 
+	/**
+	 * Optional.  Performs a list of single memory accesses in order,
+	 * queueing as many of them as the transport allows before running
+	 * the queue.  Reads store their result in the operation.  On error
+	 * @a failed is set to the index of the first operation whose
+	 * outcome is unknown.  Without this method each access is issued
+	 * through read_memory/write_memory.
+	 */
+	int (*mem_batch)(struct target *target, struct target_mem_op *ops,
+			unsigned count, unsigned *failed);
+
 	int (*checksum_memory)(struct target *target, target_addr_t address,
 			uint32_t count, uint32_t *checksum);
 	int (*blank_check_memory)(struct target *target,
@@ -280,6 +299,16 @@ struct target_type {
 	 */
 	int (*gdb_fileio_end)(struct target *target, int retcode, int fileio_errno, bool ctrl_c);
 
+	/**
+	 * Optional.  Reads up to @a max_num_samples program counter samples
+	 * without halting the target, as one queued transaction, e.g. from
+	 * a PC sampling register.  Returns ERROR_TARGET_RESOURCE_NOT_AVAILABLE
+	 * if the target has no way to do this, so that profiling falls back
+	 * to halting it.
+	 */
+	int (*profile_sample)(struct target *target, uint32_t *samples,
+			uint32_t max_num_samples, uint32_t *num_samples);
+
 	/* do target profiling
 	 */
 	int (*profiling)(struct target *target, uint32_t *samples,
@@ -2996,6 +2996,7 @@ static int xscale_init_arch_info(struct target *target,
 	xscale->armv4_5_mmu.enable_mmu_caches = xscale_enable_mmu_caches;
 	xscale->armv4_5_mmu.has_tiny_pages = 1;
 	xscale->armv4_5_mmu.mmu_enabled = 0;
+	target->tlb = &xscale->armv4_5_mmu.tlb;
 
 	return ERROR_OK;
 }
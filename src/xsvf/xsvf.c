@@ -121,6 +121,32 @@ TDO  (1);
 
 static int xsvf_fd;
 
+/* The file is consumed through a block buffer rather than one read() per
+ * byte.  xsvf_buf_offset is the file offset of xsvf_buf[0]. */
+#define XSVF_BUFFER_SIZE	(64 * 1024)
+static uint8_t xsvf_buf[XSVF_BUFFER_SIZE];
+static off_t xsvf_buf_offset;
+static size_t xsvf_buf_len, xsvf_buf_pos;
+
+/* In deferred mode, XSDR/XSDRTDO compares without XREPEAT retries are
+ * queued as JTAG callbacks instead of flushing the queue after every scan.
+ * Such a compare cannot be retried, so a failure found once the batch has
+ * been executed ends the run just like an immediate mismatch would.  Scans
+ * with retries, e.g. program or erase completion polls, are never deferred:
+ * the batch is flushed before them. */
+#define XSVF_MAX_DEFERRED	256
+struct xsvf_deferred_check {
+	off_t file_offset;	/* offset of the XSDR/XSDRTDO opcode */
+	int xsdrsize;
+	int size;			/* bytes allocated for each of the buffers */
+	uint8_t *captured;
+	uint8_t *expected;
+	uint8_t *mask;
+};
+static struct xsvf_deferred_check xsvf_deferred[XSVF_MAX_DEFERRED];
+static int xsvf_num_deferred;
+static int xsvf_deferred_failed;
+
 /* map xsvf tap state to an openocd "tap_state_t" */
 static tap_state_t xsvf_to_tap(int xsvf_state)
 {
@@ -183,24 +209,158 @@ static tap_state_t xsvf_to_tap(int xsvf_state)
 	return ret;
 }
 
-static int xsvf_read_buffer(int num_bits, int fd, uint8_t *buf)
+static off_t xsvf_tell(void)
 {
-	int num_bytes;
+	return xsvf_buf_offset + xsvf_buf_pos;
+}
+
+/* Read exactly len bytes.  Returns len, 0 at end of file, or -1 on a read
+ * error or when the file ends in the middle of the item. */
+static int xsvf_read(void *buf, size_t len)
+{
+	uint8_t *dst = buf;
+	size_t done = 0;
+
+	while (done < len) {
+		if (xsvf_buf_pos == xsvf_buf_len) {
+			ssize_t n = read(xsvf_fd, xsvf_buf, sizeof(xsvf_buf));
+			if (n < 0)
+				return -1;
+			xsvf_buf_offset += xsvf_buf_len;
+			xsvf_buf_len = n;
+			xsvf_buf_pos = 0;
+			if (n == 0)
+				return done ? -1 : 0;
+		}
+
+		size_t chunk = MIN(len - done, xsvf_buf_len - xsvf_buf_pos);
+		memcpy(dst + done, xsvf_buf + xsvf_buf_pos, chunk);
+		xsvf_buf_pos += chunk;
+		done += chunk;
+	}
+
+	return len;
+}
+
+static int xsvf_read_buffer(int num_bits, uint8_t *buf)
+{
+	int num_bytes = (num_bits + 7) / 8;
+
+	if (xsvf_read(buf, num_bytes) != num_bytes)
+		return ERROR_XSVF_EOF;
 
-	for (num_bytes = (num_bits + 7) / 8; num_bytes > 0; num_bytes--) {
-		/* reverse the order of bytes as they are read sequentially from file */
-		if (read(fd, buf + num_bytes - 1, 1) < 0)
-			return ERROR_XSVF_EOF;
+	/* reverse the order of bytes as they are read sequentially from file */
+	for (int i = 0; i < num_bytes / 2; i++) {
+		uint8_t tmp = buf[i];
+		buf[i] = buf[num_bytes - 1 - i];
+		buf[num_bytes - 1 - i] = tmp;
 	}
 
 	return ERROR_OK;
 }
 
+/* grow a scratch buffer that is kept across commands */
+static int xsvf_reserve(uint8_t **buf, int *size, int num_bytes)
+{
+	uint8_t *ptr;
+
+	if (num_bytes <= *size)
+		return ERROR_OK;
+
+	ptr = realloc(*buf, num_bytes);
+	if (!ptr) {
+		LOG_ERROR("no memory for %d byte scan buffer", num_bytes);
+		return ERROR_FAIL;
+	}
+	*buf = ptr;
+	*size = num_bytes;
+	return ERROR_OK;
+}
+
+static int xsvf_deferred_reserve(struct xsvf_deferred_check *check, int num_bytes)
+{
+	if (num_bytes <= check->size)
+		return ERROR_OK;
+
+	free(check->captured);
+	check->captured = malloc(3 * num_bytes);
+	if (!check->captured) {
+		LOG_ERROR("no memory for deferred XSDR check");
+		check->size = 0;
+		return ERROR_FAIL;
+	}
+	check->expected = check->captured + num_bytes;
+	check->mask = check->expected + num_bytes;
+	check->size = num_bytes;
+	return ERROR_OK;
+}
+
+static void xsvf_deferred_free(void)
+{
+	for (int i = 0; i < XSVF_MAX_DEFERRED; i++) {
+		free(xsvf_deferred[i].captured);
+		xsvf_deferred[i].captured = NULL;
+		xsvf_deferred[i].size = 0;
+	}
+	xsvf_num_deferred = 0;
+}
+
+/* Runs once the queue holding the scan has executed.  Callbacks run in queue
+ * order, so this records the first failing check of the batch. */
+static int xsvf_deferred_check_callback(jtag_callback_data_t data0,
+	jtag_callback_data_t data1,
+	jtag_callback_data_t data2,
+	jtag_callback_data_t data3)
+{
+	int index = (int)data0;
+	struct xsvf_deferred_check *check = &xsvf_deferred[index];
+
+	if (xsvf_deferred_failed < 0 && buf_cmp_mask(check->captured,
+			check->expected, check->mask, check->xsdrsize))
+		xsvf_deferred_failed = index;
+
+	return ERROR_OK;
+}
+
+static int xsvf_deferred_flush(void)
+{
+	xsvf_deferred_failed = -1;
+	xsvf_num_deferred = 0;
+	return jtag_execute_queue();
+}
+
+/* opcodes which only add to the JTAG queue and may follow deferred checks */
+static bool xsvf_opcode_deferrable(uint8_t opcode)
+{
+	switch (opcode) {
+		case XTDOMASK:
+		case XSIR:
+		case XSDR:
+		case XRUNTEST:
+		case XREPEAT:
+		case XSDRSIZE:
+		case XSDRTDO:
+		case XENDIR:
+		case XENDDR:
+		case XSIR2:
+		case XCOMMENT:
+		case XWAIT:
+		case XWAITSTATE:
+			return true;
+		default:
+			return false;
+	}
+}
+
 COMMAND_HANDLER(handle_xsvf_command)
 {
 	uint8_t *dr_out_buf = NULL;				/* from host to device (TDI) */
 	uint8_t *dr_in_buf = NULL;				/* from device to host (TDO) */
 	uint8_t *dr_in_mask = NULL;
+	uint8_t *dr_capture_buf = NULL;			/* captured TDO */
+	int dr_out_size = 0, dr_in_size = 0, dr_mask_size = 0, dr_capture_size = 0;
+	uint8_t *ir_buf = NULL;
+	int ir_size = 0;
 
 	int xsdrsize = 0;
 	int xruntest = 0;					/* number of TCK cycles OR *microseconds */
@@ -225,6 +385,9 @@ COMMAND_HANDLER(handle_xsvf_command)
 	int result;
 	int verbose = 1;
 
+	/* queue XSDR compares which have no XREPEAT retries */
+	bool deferred = false;
+
 	bool collecting_path = false;
 	tap_state_t path[XSTATE_MAX_PATH];
 	unsigned pathlen = 0;
@@ -268,15 +431,50 @@ COMMAND_HANDLER(handle_xsvf_command)
 		++CMD_ARGV;
 	}
 
-	if ((CMD_ARGC > 2) && (strcmp(CMD_ARGV[2], "quiet") == 0))
-		verbose = 0;
+	for (unsigned i = 2; i < CMD_ARGC; i++) {
+		if (strcmp(CMD_ARGV[i], "quiet") == 0)
+			verbose = 0;
+		else if (strcmp(CMD_ARGV[i], "deferred") == 0)
+			deferred = true;
+	}
+
+	xsvf_buf_offset = 0;
+	xsvf_buf_len = 0;
+	xsvf_buf_pos = 0;
+	xsvf_num_deferred = 0;
 
 	LOG_WARNING("XSVF support in OpenOCD is limited. Consider using SVF instead");
 	LOG_USER("xsvf processing file: \"%s\"", filename);
 
-	while (read(xsvf_fd, &opcode, 1) > 0) {
+	for (;;) {
+		int got = xsvf_read(&opcode, 1);
+
+		/* Run the deferred checks before anything that does more than
+		 * add to the JTAG queue, before a scan with retries, at the end
+		 * of the file, or when the batch is full. */
+		if (xsvf_num_deferred > 0 && (got <= 0 || !xsvf_opcode_deferrable(opcode)
+				|| ((opcode == XSDR || opcode == XSDRTDO) && xrepeat > 0)
+				|| xsvf_num_deferred == XSVF_MAX_DEFERRED)) {
+			result = xsvf_deferred_flush();
+			if (result == ERROR_OK && xsvf_deferred_failed >= 0) {
+				file_offset = xsvf_deferred[xsvf_deferred_failed].file_offset;
+				LOG_USER("XSDR mismatch");
+				result = ERROR_FAIL;
+			}
+			if (result != ERROR_OK) {
+				tdo_mismatch = 1;
+				result = svf_add_statemove(TAP_IDLE);
+				if (result == ERROR_OK)
+					jtag_execute_queue();
+				break;
+			}
+		}
+
+		if (got <= 0)
+			break;
+
 		/* record the position of this opcode within the file */
-		file_offset = lseek(xsvf_fd, 0, SEEK_CUR) - 1;
+		file_offset = xsvf_tell() - 1;
 
 		/* maybe collect another state for a pathmove();
 		 * or terminate a path.
@@ -296,7 +494,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 						break;
 					}
 
-					if (read(xsvf_fd, &uc, 1) < 0) {
+					if (xsvf_read(&uc, 1) <= 0) {
 						do_abort = 1;
 						break;
 					}
@@ -368,7 +566,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 			case XTDOMASK:
 				LOG_DEBUG("XTDOMASK");
 				if (dr_in_mask &&
-						(xsvf_read_buffer(xsdrsize, xsvf_fd, dr_in_mask) != ERROR_OK))
+						(xsvf_read_buffer(xsdrsize, dr_in_mask) != ERROR_OK))
 					do_abort = 1;
 				break;
 
@@ -376,7 +574,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 			{
 				uint8_t xruntest_buf[4];
 
-				if (read(xsvf_fd, xruntest_buf, 4) < 0) {
+				if (xsvf_read(xruntest_buf, 4) <= 0) {
 					do_abort = 1;
 					break;
 				}
@@ -390,7 +588,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 			{
 				uint8_t myrepeat;
 
-				if (read(xsvf_fd, &myrepeat, 1) < 0)
+				if (xsvf_read(&myrepeat, 1) <= 0)
 					do_abort = 1;
 				else {
 					xrepeat = myrepeat;
@@ -403,7 +601,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 			{
 				uint8_t xsdrsize_buf[4];
 
-				if (read(xsvf_fd, xsdrsize_buf, 4) < 0) {
+				if (xsvf_read(xsdrsize_buf, 4) <= 0) {
 					do_abort = 1;
 					break;
 				}
@@ -411,16 +609,14 @@ COMMAND_HANDLER(handle_xsvf_command)
 				xsdrsize = be_to_h_u32(xsdrsize_buf);
 				LOG_DEBUG("XSDRSIZE %d", xsdrsize);
 
-				if (dr_out_buf)
-					free(dr_out_buf);
-				if (dr_in_buf)
-					free(dr_in_buf);
-				if (dr_in_mask)
-					free(dr_in_mask);
-
-				dr_out_buf = malloc((xsdrsize + 7) / 8);
-				dr_in_buf = malloc((xsdrsize + 7) / 8);
-				dr_in_mask = malloc((xsdrsize + 7) / 8);
+				/* the buffers only grow, so they are reused by later
+				 * XSDRSIZE commands */
+				int num_bytes = (xsdrsize + 7) / 8;
+				if (xsvf_reserve(&dr_out_buf, &dr_out_size, num_bytes) != ERROR_OK
+						|| xsvf_reserve(&dr_in_buf, &dr_in_size, num_bytes) != ERROR_OK
+						|| xsvf_reserve(&dr_in_mask, &dr_mask_size, num_bytes) != ERROR_OK
+						|| xsvf_reserve(&dr_capture_buf, &dr_capture_size, num_bytes) != ERROR_OK)
+					do_abort = 1;
 			}
 			break;
 
@@ -433,14 +629,13 @@ COMMAND_HANDLER(handle_xsvf_command)
 
 				const char *op_name = (opcode == XSDR ? "XSDR" : "XSDRTDO");
 
-				if (xsvf_read_buffer(xsdrsize, xsvf_fd, dr_out_buf) != ERROR_OK) {
+				if (xsvf_read_buffer(xsdrsize, dr_out_buf) != ERROR_OK) {
 					do_abort = 1;
 					break;
 				}
 
 				if (opcode == XSDRTDO) {
-					if (xsvf_read_buffer(xsdrsize, xsvf_fd,
-						dr_in_buf)  != ERROR_OK) {
+					if (xsvf_read_buffer(xsdrsize, dr_in_buf) != ERROR_OK) {
 						do_abort = 1;
 						break;
 					}
@@ -451,7 +646,40 @@ COMMAND_HANDLER(handle_xsvf_command)
 
 				LOG_DEBUG("%s %d", op_name, xsdrsize);
 
-				for (attempt = 0; attempt < limit; ++attempt) {
+				if (deferred && xrepeat == 0) {
+					struct xsvf_deferred_check *check = &xsvf_deferred[xsvf_num_deferred];
+					int num_bytes = DIV_ROUND_UP(xsdrsize, 8);
+					struct scan_field field;
+
+					if (xsvf_deferred_reserve(check, num_bytes) != ERROR_OK) {
+						do_abort = 1;
+						break;
+					}
+
+					check->file_offset = file_offset;
+					check->xsdrsize = xsdrsize;
+					memcpy(check->expected, dr_in_buf, num_bytes);
+					memcpy(check->mask, dr_in_mask, num_bytes);
+
+					field.num_bits = xsdrsize;
+					field.out_value = dr_out_buf;
+					field.in_value = check->captured;
+
+					if (tap == NULL)
+						jtag_add_plain_dr_scan(field.num_bits,
+								field.out_value,
+								field.in_value,
+								TAP_DRPAUSE);
+					else
+						jtag_add_dr_scan(tap, 1, &field, TAP_DRPAUSE);
+
+					jtag_add_callback4(xsvf_deferred_check_callback,
+							(jtag_callback_data_t)xsvf_num_deferred, 0, 0, 0);
+					xsvf_num_deferred++;
+					matched = 1;
+				}
+
+				for (attempt = 0; !matched && attempt < limit; ++attempt) {
 					struct scan_field field;
 
 					if (attempt > 0) {
@@ -487,7 +715,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 
 					field.num_bits = xsdrsize;
 					field.out_value = dr_out_buf;
-					field.in_value = calloc(DIV_ROUND_UP(field.num_bits, 8), 1);
+					field.in_value = dr_capture_buf;
 
 					if (tap == NULL)
 						jtag_add_plain_dr_scan(field.num_bits,
@@ -499,8 +727,6 @@ COMMAND_HANDLER(handle_xsvf_command)
 
 					jtag_check_value_mask(&field, dr_in_buf, dr_in_mask);
 
-					free(field.in_value);
-
 					/* LOG_DEBUG("FLUSHING QUEUE"); */
 					result = jtag_execute_queue();
 					if (result == ERROR_OK) {
@@ -519,7 +745,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 				if (xruntest) {
 					result = svf_add_statemove(TAP_IDLE);
 					if (result != ERROR_OK)
-						return result;
+						goto free_all;
 
 					if (runtest_requires_tck)
 						jtag_add_clocks(xruntest);
@@ -529,7 +755,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 					/* we are already in TAP_DRPAUSE */
 					result = svf_add_statemove(xenddr);
 					if (result != ERROR_OK)
-						return result;
+						goto free_all;
 				}
 			}
 			break;
@@ -578,7 +804,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 			{
 				tap_state_t mystate;
 
-				if (read(xsvf_fd, &uc, 1) < 0) {
+				if (xsvf_read(&uc, 1) <= 0) {
 					do_abort = 1;
 					break;
 				}
@@ -621,7 +847,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 
 			case XENDIR:
 
-				if (read(xsvf_fd, &uc, 1) < 0) {
+				if (xsvf_read(&uc, 1) <= 0) {
 					do_abort = 1;
 					break;
 				}
@@ -642,7 +868,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 
 			case XENDDR:
 
-				if (read(xsvf_fd, &uc, 1) < 0) {
+				if (xsvf_read(&uc, 1) <= 0) {
 					do_abort = 1;
 					break;
 				}
@@ -665,20 +891,19 @@ COMMAND_HANDLER(handle_xsvf_command)
 			case XSIR2:
 			{
 				uint8_t short_buf[2];
-				uint8_t *ir_buf;
 				int bitcount;
 				tap_state_t my_end_state = xruntest ? TAP_IDLE : xendir;
 
 				if (opcode == XSIR) {
 					/* one byte bitcount */
-					if (read(xsvf_fd, short_buf, 1) < 0) {
+					if (xsvf_read(short_buf, 1) <= 0) {
 						do_abort = 1;
 						break;
 					}
 					bitcount = short_buf[0];
 					LOG_DEBUG("XSIR %d", bitcount);
 				} else {
-					if (read(xsvf_fd, short_buf, 2) < 0) {
+					if (xsvf_read(short_buf, 2) <= 0) {
 						do_abort = 1;
 						break;
 					}
@@ -686,9 +911,8 @@ COMMAND_HANDLER(handle_xsvf_command)
 					LOG_DEBUG("XSIR2 %d", bitcount);
 				}
 
-				ir_buf = malloc((bitcount + 7) / 8);
-
-				if (xsvf_read_buffer(bitcount, xsvf_fd, ir_buf) != ERROR_OK)
+				if (xsvf_reserve(&ir_buf, &ir_size, (bitcount + 7) / 8) != ERROR_OK
+						|| xsvf_read_buffer(bitcount, ir_buf) != ERROR_OK)
 					do_abort = 1;
 				else {
 					struct scan_field field;
@@ -716,12 +940,14 @@ COMMAND_HANDLER(handle_xsvf_command)
 					 * around the problem.
 					 */
 
-					/* LOG_DEBUG("FLUSHING QUEUE"); */
-					result = jtag_execute_queue();
-					if (result != ERROR_OK)
-						tdo_mismatch = 1;
+					/* in deferred mode the next flush reports errors */
+					if (!deferred) {
+						/* LOG_DEBUG("FLUSHING QUEUE"); */
+						result = jtag_execute_queue();
+						if (result != ERROR_OK)
+							tdo_mismatch = 1;
+					}
 				}
-				free(ir_buf);
 			}
 			break;
 
@@ -731,7 +957,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 				char comment[128];
 
 				do {
-					if (read(xsvf_fd, &uc, 1) < 0) {
+					if (xsvf_read(&uc, 1) <= 0) {
 						do_abort = 1;
 						break;
 					}
@@ -761,9 +987,9 @@ COMMAND_HANDLER(handle_xsvf_command)
 				tap_state_t end_state;
 				int delay;
 
-				if (read(xsvf_fd, &wait_local, 1) < 0
-					|| read(xsvf_fd, &end, 1) < 0
-					|| read(xsvf_fd, delay_buf, 4) < 0) {
+				if (xsvf_read(&wait_local, 1) <= 0
+					|| xsvf_read(&end, 1) <= 0
+					|| xsvf_read(delay_buf, 4) <= 0) {
 						do_abort = 1;
 						break;
 				}
@@ -781,11 +1007,11 @@ COMMAND_HANDLER(handle_xsvf_command)
 					/* FIXME handle statemove errors ... */
 					result = svf_add_statemove(wait_state);
 					if (result != ERROR_OK)
-						return result;
+						goto free_all;
 					jtag_add_sleep(delay);
 					result = svf_add_statemove(end_state);
 					if (result != ERROR_OK)
-						return result;
+						goto free_all;
 				}
 			}
 			break;
@@ -806,10 +1032,10 @@ COMMAND_HANDLER(handle_xsvf_command)
 				int clock_count;
 				int usecs;
 
-				if (read(xsvf_fd, &wait_local, 1) < 0
-						||  read(xsvf_fd, &end, 1) < 0
-						||  read(xsvf_fd, clock_buf, 4) < 0
-						||  read(xsvf_fd, usecs_buf, 4) < 0) {
+				if (xsvf_read(&wait_local, 1) <= 0
+						||  xsvf_read(&end, 1) <= 0
+						||  xsvf_read(clock_buf, 4) <= 0
+						||  xsvf_read(usecs_buf, 4) <= 0) {
 					do_abort = 1;
 					break;
 				}
@@ -840,14 +1066,14 @@ COMMAND_HANDLER(handle_xsvf_command)
 				/* FIXME handle statemove errors ... */
 				result = svf_add_statemove(wait_state);
 				if (result != ERROR_OK)
-					return result;
+					goto free_all;
 
 				jtag_add_clocks(clock_count);
 				jtag_add_sleep(usecs);
 
 				result = svf_add_statemove(end_state);
 				if (result != ERROR_OK)
-					return result;
+					goto free_all;
 			}
 			break;
 
@@ -858,7 +1084,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 				*/
 				uint8_t count_buf[4];
 
-				if (read(xsvf_fd, count_buf, 4) < 0) {
+				if (xsvf_read(count_buf, 4) <= 0) {
 					do_abort = 1;
 					break;
 				}
@@ -877,9 +1103,9 @@ COMMAND_HANDLER(handle_xsvf_command)
 				uint8_t clock_buf[4];
 				uint8_t usecs_buf[4];
 
-				if (read(xsvf_fd, &state, 1) < 0
-						|| read(xsvf_fd, clock_buf, 4) < 0
-						|| read(xsvf_fd, usecs_buf, 4) < 0) {
+				if (xsvf_read(&state, 1) <= 0
+						|| xsvf_read(clock_buf, 4) <= 0
+						|| xsvf_read(usecs_buf, 4) <= 0) {
 					do_abort = 1;
 					break;
 				}
@@ -905,8 +1131,8 @@ COMMAND_HANDLER(handle_xsvf_command)
 
 				LOG_DEBUG("LSDR");
 
-				if (xsvf_read_buffer(xsdrsize, xsvf_fd, dr_out_buf) != ERROR_OK
-						|| xsvf_read_buffer(xsdrsize, xsvf_fd, dr_in_buf) != ERROR_OK) {
+				if (xsvf_read_buffer(xsdrsize, dr_out_buf) != ERROR_OK
+						|| xsvf_read_buffer(xsdrsize, dr_in_buf) != ERROR_OK) {
 					do_abort = 1;
 					break;
 				}
@@ -919,13 +1145,13 @@ COMMAND_HANDLER(handle_xsvf_command)
 
 					result = svf_add_statemove(loop_state);
 					if (result != ERROR_OK)
-						return result;
+						goto free_all;
 					jtag_add_clocks(loop_clocks);
 					jtag_add_sleep(loop_usecs);
 
 					field.num_bits = xsdrsize;
 					field.out_value = dr_out_buf;
-					field.in_value = calloc(DIV_ROUND_UP(field.num_bits, 8), 1);
+					field.in_value = dr_capture_buf;
 
 					if (attempt > 0 && verbose)
 						LOG_USER("LSDR retry %d", attempt);
@@ -940,9 +1166,6 @@ COMMAND_HANDLER(handle_xsvf_command)
 
 					jtag_check_value_mask(&field, dr_in_buf, dr_in_mask);
 
-					free(field.in_value);
-
-
 					/* LOG_DEBUG("FLUSHING QUEUE"); */
 					result = jtag_execute_queue();
 					if (result == ERROR_OK) {
@@ -963,7 +1186,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 			{
 				uint8_t trst_mode;
 
-				if (read(xsvf_fd, &trst_mode, 1) < 0) {
+				if (xsvf_read(&trst_mode, 1) <= 0) {
 					do_abort = 1;
 					break;
 				}
@@ -996,49 +1219,42 @@ COMMAND_HANDLER(handle_xsvf_command)
 			/* upon error, return the TAPs to a reasonable state */
 			result = svf_add_statemove(TAP_IDLE);
 			if (result != ERROR_OK)
-				return result;
+				goto free_all;
 			result = jtag_execute_queue();
 			if (result != ERROR_OK)
-				return result;
+				goto free_all;
 			break;
 		}
 	}
 
+	result = ERROR_FAIL;
 	if (tdo_mismatch) {
 		command_print(CMD,
 			"TDO mismatch, somewhere near offset %lu in xsvf file, aborting",
 			file_offset);
-
-		return ERROR_FAIL;
-	}
-
-	if (unsupported) {
-		off_t offset = lseek(xsvf_fd, 0, SEEK_CUR) - 1;
+	} else if (unsupported) {
+		off_t offset = xsvf_tell() - 1;
 		command_print(CMD,
 			"unsupported xsvf command (0x%02X) at offset %jd, aborting",
 			uc, (intmax_t)offset);
-		return ERROR_FAIL;
-	}
-
-	if (do_abort) {
+	} else if (do_abort) {
 		command_print(CMD, "premature end of xsvf file detected, aborting");
-		return ERROR_FAIL;
+	} else {
+		command_print(CMD, "XSVF file programmed successfully");
+		result = ERROR_OK;
 	}
 
-	if (dr_out_buf)
-		free(dr_out_buf);
-
-	if (dr_in_buf)
-		free(dr_in_buf);
-
-	if (dr_in_mask)
-		free(dr_in_mask);
+free_all:
+	free(dr_out_buf);
+	free(dr_in_buf);
+	free(dr_in_mask);
+	free(dr_capture_buf);
+	free(ir_buf);
+	xsvf_deferred_free();
 
 	close(xsvf_fd);
 
-	command_print(CMD, "XSVF file programmed successfully");
-
-	return ERROR_OK;
+	return result;
 }
 
 static const struct command_registration xsvf_command_handlers[] = {
@@ -1049,8 +1265,10 @@ static const struct command_registration xsvf_command_handlers[] = {
 		.help = "Runs a XSVF file.  If 'virt2' is given, xruntest "
 			"counts are interpreted as TCK cycles rather than "
 			"as microseconds.  Without the 'quiet' option, all "
-			"comments, retries, and mismatches will be reported.",
-		.usage = "(tapname|'plain') filename ['virt2'] ['quiet']",
+			"comments, retries, and mismatches will be reported.  "
+			"With 'deferred', XSDR compares without retries are "
+			"batched and checked together.",
+		.usage = "(tapname|'plain') filename ['virt2'] ['quiet'] ['deferred']",
 	},
 	COMMAND_REGISTRATION_DONE
 };
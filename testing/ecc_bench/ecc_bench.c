@@ -0,0 +1,438 @@
+/*
+ * Host microbenchmark for the NAND software ECC code.
+ *
+ * Times nand_calculate_ecc() and nand_correct_data() against the byte
+ * loop they replaced, and the table-driven BCH encoder against a plain
+ * bit-serial LFSR encoder.  BCH decoding is timed with t bit errors
+ * injected per step.  Every result is cross-checked against the
+ * reference before it is timed, so the run doubles as a test.
+ *
+ * The driver sources are compiled into this file, which keeps their
+ * static helpers reachable.  From a configured build directory:
+ *
+ *   gcc -O2 -DHAVE_CONFIG_H -I. -I$(srcdir)/src -I$(srcdir)/src/helper \
+ *       -I$(srcdir)/jimtcl -Ijimtcl \
+ *       $(srcdir)/testing/ecc_bench/ecc_bench.c -o ecc_bench
+ *   ./ecc_bench [iterations]
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 or (at your option) any
+ * later version.
+ *
+ * This file is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../../src/flash/nand/ecc.c"
+#include "../../src/flash/nand/bch.c"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* the driver code only logs on bad BCH parameters */
+void log_printf_lf(enum log_levels level, const char *file, unsigned line,
+		const char *function, const char *format, ...)
+{
+	va_list args;
+
+	va_start(args, format);
+	vfprintf(stderr, format, args);
+	va_end(args);
+	fputc('\n', stderr);
+}
+
+#define BENCH_BLOCKS	64
+#define BCH_STEP	512
+#define BCH_ECC_BYTES	7
+
+/* nand_calculate_ecc() as it was before the 64-bit word rework */
+static int old_calculate_ecc(const uint8_t *dat, uint8_t *ecc_code)
+{
+	uint8_t idx, reg1, reg2, reg3, tmp1, tmp2;
+	int i;
+
+	reg1 = reg2 = reg3 = 0;
+
+	for (i = 0; i < 256; i++) {
+		idx = nand_ecc_precalc_table[*dat++];
+		reg1 ^= (idx & 0x3f);
+
+		if (idx & 0x40) {
+			reg3 ^= (uint8_t) i;
+			reg2 ^= ~((uint8_t) i);
+		}
+	}
+
+	tmp1  = (reg3 & 0x80) >> 0;
+	tmp1 |= (reg2 & 0x80) >> 1;
+	tmp1 |= (reg3 & 0x40) >> 1;
+	tmp1 |= (reg2 & 0x40) >> 2;
+	tmp1 |= (reg3 & 0x20) >> 2;
+	tmp1 |= (reg2 & 0x20) >> 3;
+	tmp1 |= (reg3 & 0x10) >> 3;
+	tmp1 |= (reg2 & 0x10) >> 4;
+
+	tmp2  = (reg3 & 0x08) << 4;
+	tmp2 |= (reg2 & 0x08) << 3;
+	tmp2 |= (reg3 & 0x04) << 3;
+	tmp2 |= (reg2 & 0x04) << 2;
+	tmp2 |= (reg3 & 0x02) << 2;
+	tmp2 |= (reg2 & 0x02) << 1;
+	tmp2 |= (reg3 & 0x01) << 1;
+	tmp2 |= (reg2 & 0x01) << 0;
+
+#ifdef NAND_ECC_SMC
+	ecc_code[0] = ~tmp2;
+	ecc_code[1] = ~tmp1;
+#else
+	ecc_code[0] = ~tmp1;
+	ecc_code[1] = ~tmp2;
+#endif
+	ecc_code[2] = ((~reg1) << 2) | 0x03;
+
+	return 0;
+}
+
+static inline int old_countbits(uint32_t b)
+{
+	int res = 0;
+
+	for (; b; b >>= 1)
+		res += b & 0x01;
+	return res;
+}
+
+/* nand_correct_data() with the old bit counting loop */
+static int old_correct_data(uint8_t *dat, const uint8_t *read_ecc,
+		const uint8_t *calc_ecc)
+{
+	uint8_t s0, s1, s2;
+
+#ifdef NAND_ECC_SMC
+	s0 = calc_ecc[0] ^ read_ecc[0];
+	s1 = calc_ecc[1] ^ read_ecc[1];
+	s2 = calc_ecc[2] ^ read_ecc[2];
+#else
+	s1 = calc_ecc[0] ^ read_ecc[0];
+	s0 = calc_ecc[1] ^ read_ecc[1];
+	s2 = calc_ecc[2] ^ read_ecc[2];
+#endif
+	if ((s0 | s1 | s2) == 0)
+		return 0;
+
+	if (((s0 ^ (s0 >> 1)) & 0x55) == 0x55 &&
+			((s1 ^ (s1 >> 1)) & 0x55) == 0x55 &&
+			((s2 ^ (s2 >> 1)) & 0x54) == 0x54) {
+		uint32_t byteoffs, bitnum;
+
+		byteoffs = (s1 << 0) & 0x80;
+		byteoffs |= (s1 << 1) & 0x40;
+		byteoffs |= (s1 << 2) & 0x20;
+		byteoffs |= (s1 << 3) & 0x10;
+
+		byteoffs |= (s0 >> 4) & 0x08;
+		byteoffs |= (s0 >> 3) & 0x04;
+		byteoffs |= (s0 >> 2) & 0x02;
+		byteoffs |= (s0 >> 1) & 0x01;
+
+		bitnum = (s2 >> 5) & 0x04;
+		bitnum |= (s2 >> 4) & 0x02;
+		bitnum |= (s2 >> 3) & 0x01;
+
+		dat[byteoffs] ^= (1 << bitnum);
+
+		return 1;
+	}
+
+	if (old_countbits(s0 | ((uint32_t)s1 << 8) | ((uint32_t)s2 << 16)) == 1)
+		return 1;
+
+	return -1;
+}
+
+/*
+ * Bit-serial BCH encoder: shift each message bit through an LFSR built
+ * from g(X), then apply the same erased-page mask as the driver.
+ */
+struct ref_bch {
+	struct nand_bch *bch;
+	uint32_t *g;	/* g(X) without its leading term, left aligned */
+	uint32_t *r;
+};
+
+static void ref_bch_free(struct ref_bch *ref)
+{
+	free(ref->g);
+	free(ref->r);
+}
+
+static int ref_bch_init(struct ref_bch *ref, struct nand_bch *bch)
+{
+	const unsigned l = bch->ecc_words;
+	uint32_t *genpoly;
+	unsigned i;
+
+	ref->bch = bch;
+	ref->g = calloc(l, sizeof(uint32_t));
+	ref->r = calloc(l, sizeof(uint32_t));
+	genpoly = calloc(l + 1, sizeof(uint32_t));
+	if (!ref->g || !ref->r || !genpoly
+			|| bch_build_generator(bch, genpoly) != ERROR_OK) {
+		free(genpoly);
+		ref_bch_free(ref);
+		return ERROR_FAIL;
+	}
+	for (i = 0; i < l; i++)
+		ref->g[i] = (genpoly[i] << 1) | (genpoly[i + 1] >> 31);
+
+	free(genpoly);
+	return ERROR_OK;
+}
+
+static void ref_bch_encode(struct ref_bch *ref, const uint8_t *dat, uint8_t *ecc)
+{
+	struct nand_bch *bch = ref->bch;
+	const unsigned l = bch->ecc_words;
+	uint32_t *r = ref->r;
+	unsigned i, j, bit, fb;
+
+	memset(r, 0, l * sizeof(uint32_t));
+
+	for (i = 0; i < bch->eccsize; i++) {
+		for (bit = 0x80; bit; bit >>= 1) {
+			fb = (r[0] >> 31) ^ !!(dat[i] & bit);
+			for (j = 0; j + 1 < l; j++)
+				r[j] = (r[j] << 1) | (r[j + 1] >> 31);
+			r[l - 1] <<= 1;
+			if (fb) {
+				for (j = 0; j < l; j++)
+					r[j] ^= ref->g[j];
+			}
+		}
+	}
+
+	for (i = 0; i < bch->eccbytes; i++)
+		ecc[i] = (r[i / 4] >> (24 - 8 * (i % 4))) ^ bch->eccmask[i];
+}
+
+static double bench_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench_report(const char *what, double secs, unsigned long bytes)
+{
+	printf("%-28s %9.3f ms %9.1f MB/s\n", what, secs * 1e3,
+			bytes / secs / 1e6);
+}
+
+static void fill_random(uint8_t *buf, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		buf[i] = rand();
+}
+
+static int check_hamming(uint8_t *data)
+{
+	uint8_t ecc_new[3], ecc_old[3], copy[256];
+	unsigned b, bit;
+
+	for (b = 0; b < BENCH_BLOCKS; b++) {
+		uint8_t *block = data + 256 * b;
+
+		nand_calculate_ecc(NULL, block, ecc_new);
+		old_calculate_ecc(block, ecc_old);
+		if (memcmp(ecc_new, ecc_old, 3)) {
+			fprintf(stderr, "hamming ECC mismatch in block %u\n", b);
+			return ERROR_FAIL;
+		}
+
+		/* a spread of single bit flips must be found and repaired */
+		for (bit = 0; bit < 256 * 8; bit += 37) {
+			memcpy(copy, block, 256);
+			copy[bit / 8] ^= 1 << (bit % 8);
+			nand_calculate_ecc(NULL, copy, ecc_new);
+			if (nand_correct_data(NULL, copy, ecc_old, ecc_new) != 1
+					|| memcmp(copy, block, 256)) {
+				fprintf(stderr, "hamming correction failed, block %u bit %u\n",
+						b, bit);
+				return ERROR_FAIL;
+			}
+		}
+	}
+
+	return ERROR_OK;
+}
+
+static void bench_hamming(uint8_t *data, unsigned iterations)
+{
+	uint8_t ecc[BENCH_BLOCKS][3], calc[3];
+	unsigned long bytes = 256UL * BENCH_BLOCKS * iterations;
+	unsigned i, b;
+	double t;
+	volatile int sink = 0;
+
+	t = bench_now();
+	for (i = 0; i < iterations; i++)
+		for (b = 0; b < BENCH_BLOCKS; b++)
+			old_calculate_ecc(data + 256 * b, ecc[b]);
+	bench_report("hamming calculate (old)", bench_now() - t, bytes);
+
+	t = bench_now();
+	for (i = 0; i < iterations; i++)
+		for (b = 0; b < BENCH_BLOCKS; b++)
+			nand_calculate_ecc(NULL, data + 256 * b, ecc[b]);
+	bench_report("hamming calculate (new)", bench_now() - t, bytes);
+
+	/* uncorrectable syndromes take the bit counting path */
+	calc[0] = 0x01;
+	calc[1] = 0x00;
+	calc[2] = 0x03;
+
+	t = bench_now();
+	for (i = 0; i < iterations; i++)
+		for (b = 0; b < BENCH_BLOCKS; b++)
+			sink += old_correct_data(data + 256 * b, ecc[b], calc);
+	bench_report("hamming correct (old)", bench_now() - t, bytes);
+
+	t = bench_now();
+	for (i = 0; i < iterations; i++)
+		for (b = 0; b < BENCH_BLOCKS; b++)
+			sink += nand_correct_data(NULL, data + 256 * b, ecc[b], calc);
+	bench_report("hamming correct (new)", bench_now() - t, bytes);
+}
+
+static int check_bch(struct nand_bch *bch, struct ref_bch *ref, uint8_t *data)
+{
+	uint8_t ecc_new[BCH_ECC_BYTES], ecc_ref[BCH_ECC_BYTES];
+	uint8_t copy[BCH_STEP];
+	unsigned b, e, bit;
+	unsigned steps = 256 * BENCH_BLOCKS / BCH_STEP;
+
+	for (b = 0; b < steps; b++) {
+		uint8_t *step = data + BCH_STEP * b;
+
+		nand_calculate_ecc_bch(bch, step, ecc_new);
+		ref_bch_encode(ref, step, ecc_ref);
+		if (memcmp(ecc_new, ecc_ref, BCH_ECC_BYTES)) {
+			fprintf(stderr, "BCH ECC mismatch in step %u\n", b);
+			return ERROR_FAIL;
+		}
+
+		memcpy(copy, step, BCH_STEP);
+		for (e = 0; e < bch->t; e++) {
+			bit = rand() % (8 * BCH_STEP);
+			copy[bit / 8] ^= 0x80 >> (bit % 8);
+		}
+		nand_calculate_ecc_bch(bch, copy, ecc_new);
+		if (nand_correct_data_bch(bch, copy, ecc_ref, ecc_new) < 0
+				|| memcmp(copy, step, BCH_STEP)) {
+			fprintf(stderr, "BCH correction failed in step %u\n", b);
+			return ERROR_FAIL;
+		}
+	}
+
+	return ERROR_OK;
+}
+
+static void bench_bch(struct nand_bch *bch, struct ref_bch *ref, uint8_t *data,
+		unsigned iterations)
+{
+	unsigned steps = 256 * BENCH_BLOCKS / BCH_STEP;
+	unsigned long bytes = (unsigned long)BCH_STEP * steps * iterations;
+	uint8_t ecc[256 * BENCH_BLOCKS / BCH_STEP][BCH_ECC_BYTES];
+	uint8_t calc[BCH_ECC_BYTES];
+	uint8_t *copy;
+	unsigned i, b, e, bit;
+	double t;
+	volatile int sink = 0;
+
+	t = bench_now();
+	for (i = 0; i < iterations; i++)
+		for (b = 0; b < steps; b++)
+			ref_bch_encode(ref, data + BCH_STEP * b, ecc[b]);
+	bench_report("bch encode (bit-serial)", bench_now() - t, bytes);
+
+	t = bench_now();
+	for (i = 0; i < iterations; i++)
+		for (b = 0; b < steps; b++)
+			nand_calculate_ecc_bch(bch, data + BCH_STEP * b, ecc[b]);
+	bench_report("bch encode (table)", bench_now() - t, bytes);
+
+	/* decode cost depends on the errors present; inject t per step */
+	copy = malloc(BCH_STEP * steps);
+	if (!copy)
+		return;
+	memcpy(copy, data, BCH_STEP * steps);
+	for (b = 0; b < steps; b++) {
+		for (e = 0; e < bch->t; e++) {
+			bit = rand() % (8 * BCH_STEP);
+			copy[BCH_STEP * b + bit / 8] ^= 0x80 >> (bit % 8);
+		}
+	}
+
+	t = bench_now();
+	for (i = 0; i < iterations; i++) {
+		for (b = 0; b < steps; b++) {
+			nand_calculate_ecc_bch(bch, copy + BCH_STEP * b, calc);
+			/* correct a scratch copy so each pass sees the same errors */
+			memcpy(data + BCH_STEP * b, copy + BCH_STEP * b, BCH_STEP);
+			sink += nand_correct_data_bch(bch, data + BCH_STEP * b,
+					ecc[b], calc);
+		}
+	}
+	bench_report("bch calculate+correct", bench_now() - t, bytes);
+
+	free(copy);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned iterations = 2000;
+	struct nand_bch *bch;
+	struct ref_bch ref;
+	uint8_t *data;
+	int retval = EXIT_FAILURE;
+
+	if (argc > 1)
+		iterations = strtoul(argv[1], NULL, 0);
+	if (iterations == 0)
+		iterations = 1;
+
+	srand(1);
+	data = malloc(256 * BENCH_BLOCKS);
+	bch = nand_bch_init(BCH_STEP, BCH_ECC_BYTES);
+	if (!data || !bch || ref_bch_init(&ref, bch) != ERROR_OK) {
+		fprintf(stderr, "setup failed\n");
+		goto out;
+	}
+	fill_random(data, 256 * BENCH_BLOCKS);
+
+	if (check_hamming(data) != ERROR_OK || check_bch(bch, &ref, data) != ERROR_OK)
+		goto out_ref;
+
+	printf("%u passes over %u bytes\n", iterations, 256 * BENCH_BLOCKS);
+	bench_hamming(data, iterations);
+	bench_bch(bch, &ref, data, iterations / 10 ? iterations / 10 : 1);
+	retval = EXIT_SUCCESS;
+
+out_ref:
+	ref_bch_free(&ref);
+out:
+	nand_bch_free(bch);
+	free(data);
+	return retval;
+}